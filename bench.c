@@ -0,0 +1,3016 @@
+/*
+ * Inventory Management System
+ * Headless benchmarks for the SQLite paths used by main.c
+ * Portable C without windows.h, so it also builds and runs on Linux; threads are pthreads
+ *
+ * Usage: bench [profiles [purchases]]
+ *        bench [statements [scale ...]]
+ *        bench [checkout [basket size ...]]
+ *        bench [groupcommit [window ms ...]]
+ *        bench [writer [producers ...]]
+ *        bench [rollup [scale ...]]
+ *        bench [readers [scanners ...]]
+ *        bench [import [rows ...]]
+ *        bench [columnar [scale ...]]
+ *        bench [mirror [scale ...]]
+ *        bench [parallel [threads ...]]
+ *        bench [cache [products ...]]
+ *        bench [firstpage [millions ...]]
+ *        bench [stmtcache [purchases]]
+ *        bench [search [products ...]]
+ *        bench [plans [scale]]
+ *        bench seed <database> <scale> [seed]
+ *        bench export <database> <csv> [from|- to|- [product id]]
+ *        bench snapshot <database> <file>
+ * Results are printed as one JSON object per line.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <sqlite3.h>
+#include "db_profiles.h"
+#include "db_schema.h"
+#include "db_queries.h"
+#include "workload.h"
+#include "product_import.h"
+#include "sales_export.h"
+#include "sales_snapshot.h"
+#include "sales_mirror.h"
+#include "sales_report.h"
+#include "product_cache.h"
+#include "stmt_cache.h"
+#include "db_worker.h"
+
+#define BENCH_DB_FILENAME "bench.db"
+#define BENCH_PRODUCTS 1000
+#define BENCH_DEFAULT_PURCHASES 2000
+#define BENCH_SEED 1
+#define BENCH_PROFILE "balanced"
+#define BENCH_CHECKOUT_BASKETS 200
+#define BENCH_GROUP_SECONDS 1.0
+#define BENCH_GROUP_MAX_PRODUCERS 64
+#define BENCH_GROUP_MAX_SAMPLES (1 << 20)
+
+// Same page sizes as the product and sales lists in main.c
+#define BENCH_PRODUCT_PAGE PRODUCT_PAGE_SIZE
+#define BENCH_SALES_PAGE 200
+
+typedef struct {
+    const char* name;
+    int (*run)(int argc, char** argv);
+} Benchmark;
+
+// Per-operation latencies of one benchmark case
+typedef struct {
+    double* samples;    // microseconds
+    int count;
+    int capacity;
+    double started;
+} LatencyLog;
+
+static double NowSeconds(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int CompareDoubles(const void* a, const void* b) {
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+// Nearest-rank percentile of an ascending array
+static double Percentile(const double* sorted, int count, double p) {
+    int index = (int)(p * count + 0.5) - 1;
+    if (index < 0) index = 0;
+    if (index >= count) index = count - 1;
+    return sorted[index];
+}
+
+static int LatencyLog_Start(LatencyLog* log, int capacity) {
+    log->samples = (double*)malloc(capacity * sizeof(double));
+    log->count = 0;
+    log->capacity = log->samples ? capacity : 0;
+    log->started = NowSeconds();
+    return log->samples != NULL;
+}
+
+static void LatencyLog_Add(LatencyLog* log, double startedAt) {
+    if (log->count < log->capacity) {
+        log->samples[log->count++] = (NowSeconds() - startedAt) * 1e6;
+    }
+}
+
+// Prints one result line; labels are extra JSON members identifying the run, e.g. "\"profile\":\"safe\""
+static void LatencyLog_Report(LatencyLog* log, const char* bench, const char* labels, const char* op) {
+    double elapsed = NowSeconds() - log->started;
+
+    if (log->count == 0) {
+        return;
+    }
+    qsort(log->samples, log->count, sizeof(double), CompareDoubles);
+    printf("{\"bench\":\"%s\",%s,\"op\":\"%s\",\"iterations\":%d,\"ops_per_sec\":%.1f,"
+           "\"p50_us\":%.1f,\"p99_us\":%.1f,\"p999_us\":%.1f}\n",
+           bench, labels, op, log->count, elapsed > 0 ? log->count / elapsed : 0.0,
+           Percentile(log->samples, log->count, 0.50),
+           Percentile(log->samples, log->count, 0.99),
+           Percentile(log->samples, log->count, 0.999));
+    fflush(stdout);
+}
+
+// Moves another log's samples into this one, as far as they fit
+static void LatencyLog_Append(LatencyLog* log, const LatencyLog* other) {
+    int count = other->count;
+    if (count > log->capacity - log->count) {
+        count = log->capacity - log->count;
+    }
+    memcpy(log->samples + log->count, other->samples, count * sizeof(double));
+    log->count += count;
+}
+
+static void LatencyLog_Free(LatencyLog* log) {
+    free(log->samples);
+    log->samples = NULL;
+}
+
+static void RemoveDatabase(const char* path) {
+    char sidecar[256];
+    remove(path);
+    snprintf(sidecar, sizeof(sidecar), "%s-wal", path);
+    remove(sidecar);
+    snprintf(sidecar, sizeof(sidecar), "%s-shm", path);
+    remove(sidecar);
+    snprintf(sidecar, sizeof(sidecar), "%s-journal", path);
+    remove(sidecar);
+}
+
+// Fresh database with the application's schema and the given profile applied
+static sqlite3* OpenBenchDatabase(const char* path, const PragmaProfile* profile) {
+    sqlite3* conn;
+
+    RemoveDatabase(path);
+    if (sqlite3_open(path, &conn) != SQLITE_OK) {
+        fprintf(stderr, "cannot open %s: %s\n", path, sqlite3_errmsg(conn));
+        sqlite3_close(conn);
+        return NULL;
+    }
+    if (ApplyPragmaProfile(conn, profile) != SQLITE_OK ||
+        sqlite3_exec(conn, SQL_CREATE_PRODUCTS SQL_CREATE_SALES SQL_CREATE_RECEIPTS SQL_CREATE_SALE_LINES,
+                     NULL, NULL, NULL) != SQLITE_OK ||
+        EnsureIndexes(conn) != SQLITE_OK) {
+        fprintf(stderr, "cannot prepare %s: %s\n", path, sqlite3_errmsg(conn));
+        sqlite3_close(conn);
+        return NULL;
+    }
+    return conn;
+}
+
+static int StepAll(sqlite3_stmt* stmt) {
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+    }
+    sqlite3_reset(stmt);
+    return rc == SQLITE_DONE;
+}
+
+// The worker's purchase: guarded stock update returning price and name, then the sale row.
+// commitStart, when given, receives the time COMMIT was issued.
+static int RunPurchaseTransaction(sqlite3_stmt* begin, sqlite3_stmt* update, sqlite3_stmt* insert,
+                                  sqlite3_stmt* commit, sqlite3_int64 productId, int quantity,
+                                  double* commitStart) {
+    int ok = StepAll(begin);
+
+    sqlite3_bind_int(update, 1, quantity);
+    sqlite3_bind_int64(update, 2, productId);
+    // No row back means the stock guard failed
+    if (ok && sqlite3_step(update) == SQLITE_ROW) {
+        sqlite3_bind_int64(insert, 1, productId);
+        sqlite3_bind_text(insert, 2, (const char*)sqlite3_column_text(update, 2), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_int(insert, 3, quantity);
+        sqlite3_bind_int64(insert, 4, sqlite3_column_int64(update, 1) * quantity);
+        ok = sqlite3_step(update) == SQLITE_DONE;
+    } else {
+        ok = 0;
+    }
+    sqlite3_reset(update);
+    ok = ok && StepAll(insert);
+
+    if (commitStart) {
+        *commitStart = NowSeconds();
+    }
+    ok = ok && StepAll(commit);
+    if (!ok) {
+        sqlite3_exec(sqlite3_db_handle(begin), "ROLLBACK", NULL, NULL, NULL);
+    }
+    return ok;
+}
+
+// Purchase commits: the same transaction the worker runs for each sale
+static int BenchProfiles(int argc, char** argv) {
+    int purchases = argc > 0 ? atoi(argv[0]) : BENCH_DEFAULT_PURCHASES;
+    int p;
+
+    if (purchases <= 0) {
+        fprintf(stderr, "purchase count must be positive\n");
+        return 0;
+    }
+
+    for (p = 0; p < PRAGMA_PROFILE_COUNT; p++) {
+        const PragmaProfile* profile = &g_pragmaProfiles[p];
+        sqlite3* conn = OpenBenchDatabase(BENCH_DB_FILENAME, profile);
+        sqlite3_stmt *begin = NULL, *update = NULL, *insert = NULL, *commit = NULL;
+        WorkloadSpec spec;
+        LatencyLog log = { NULL, 0, 0, 0.0 };
+        char labels[64];
+        int i, ok = conn != NULL;
+
+        Workload_Init(&spec, 1, BENCH_SEED);
+        spec.products = BENCH_PRODUCTS;
+        spec.sales = 0;
+
+        ok = ok && Workload_Generate(conn, &spec, NULL, NULL) == SQLITE_OK;
+        ok = ok && sqlite3_exec(conn, "UPDATE products SET quantity = 1000000", NULL, NULL, NULL) == SQLITE_OK;
+        ok = ok && sqlite3_prepare_v2(conn, "BEGIN IMMEDIATE", -1, &begin, NULL) == SQLITE_OK;
+        ok = ok && sqlite3_prepare_v2(conn, SQL_PURCHASE_UPDATE_STOCK, -1, &update, NULL) == SQLITE_OK;
+        ok = ok && sqlite3_prepare_v2(conn, SQL_PURCHASE_INSERT_SALE, -1, &insert, NULL) == SQLITE_OK;
+        ok = ok && sqlite3_prepare_v2(conn, "COMMIT", -1, &commit, NULL) == SQLITE_OK;
+        ok = ok && LatencyLog_Start(&log, purchases);
+
+        for (i = 0; ok && i < purchases; i++) {
+            double commitStart = 0;
+
+            ok = RunPurchaseTransaction(begin, update, insert, commit, i % BENCH_PRODUCTS + 1, 1, &commitStart);
+            LatencyLog_Add(&log, commitStart);
+        }
+
+        if (ok) {
+            snprintf(labels, sizeof(labels), "\"profile\":\"%s\"", profile->name);
+            LatencyLog_Report(&log, "profiles", labels, "purchase_commit");
+        } else {
+            fprintf(stderr, "profile %s failed: %s\n", profile->name, conn ? sqlite3_errmsg(conn) : "open");
+        }
+        LatencyLog_Free(&log);
+
+        sqlite3_finalize(begin);
+        sqlite3_finalize(update);
+        sqlite3_finalize(insert);
+        sqlite3_finalize(commit);
+        sqlite3_close(conn);
+        RemoveDatabase(BENCH_DB_FILENAME);
+        if (!ok) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/*
+ * Per-statement suite: every statement main.c runs, against workload databases of growing scale
+ */
+
+typedef struct {
+    sqlite3* conn;
+    sqlite3_int64 products;         // generated ids are 1..products
+    sqlite3_int64 sales;
+    unsigned long long rng;
+    sqlite3_int64 firstInserted;    // rows added by insert_product, removed by delete_product
+    int inserted;
+    sqlite3_stmt* begin;
+    sqlite3_stmt* commit;
+    sqlite3_stmt* saleInsert;
+} StatementBench;
+
+typedef struct {
+    const char* op;
+    const char* sql;
+    int iterations;
+    int (*run)(StatementBench* bench, sqlite3_stmt* stmt, int iteration);
+} StatementCase;
+
+// Search terms as the search box sends them: two letters go to LIKE, longer ones to the trigram index
+static const char* g_likeTerms[] = { "%HP%", "%Pr%", "%SS%", "%LG%", "%Mo%" };
+static const char* g_matchTerms[] = { "\"Laptop\"", "\"Mouse\"", "\"Cable\"", "\"Samsung Pro\"", "\"A12\"", "\"Charger\"" };
+
+#define LIKE_TERM_COUNT ((int)(sizeof(g_likeTerms) / sizeof(g_likeTerms[0])))
+#define MATCH_TERM_COUNT ((int)(sizeof(g_matchTerms) / sizeof(g_matchTerms[0])))
+
+static sqlite3_int64 RandomBelow(StatementBench* bench, sqlite3_int64 limit) {
+    bench->rng = bench->rng * 6364136223846793005ULL + 1442695040888963407ULL;
+    return (sqlite3_int64)((bench->rng >> 17) % (unsigned long long)limit);
+}
+
+static int RunProductIds(StatementBench* bench, sqlite3_stmt* stmt, int iteration) {
+    (void)bench;
+    (void)iteration;
+    return StepAll(stmt);
+}
+
+static int RunProductPage(StatementBench* bench, sqlite3_stmt* stmt, int iteration) {
+    (void)iteration;
+    sqlite3_bind_int64(stmt, 1, 1 + RandomBelow(bench, bench->products));
+    sqlite3_bind_int(stmt, 2, BENCH_PRODUCT_PAGE);
+    return StepAll(stmt);
+}
+
+static int RunProductById(StatementBench* bench, sqlite3_stmt* stmt, int iteration) {
+    (void)iteration;
+    sqlite3_bind_int64(stmt, 1, 1 + RandomBelow(bench, bench->products));
+    return StepAll(stmt);
+}
+
+static int RunSearchLike(StatementBench* bench, sqlite3_stmt* stmt, int iteration) {
+    (void)bench;
+    sqlite3_bind_text(stmt, 1, g_likeTerms[iteration % LIKE_TERM_COUNT], -1, SQLITE_STATIC);
+    return StepAll(stmt);
+}
+
+static int RunSearchMatch(StatementBench* bench, sqlite3_stmt* stmt, int iteration) {
+    (void)bench;
+    sqlite3_bind_text(stmt, 1, g_matchTerms[iteration % MATCH_TERM_COUNT], -1, SQLITE_STATIC);
+    return StepAll(stmt);
+}
+
+static int RunSearchPage(StatementBench* bench, sqlite3_stmt* stmt, int iteration) {
+    sqlite3_bind_text(stmt, 1, g_matchTerms[iteration % MATCH_TERM_COUNT], -1, SQLITE_STATIC);
+    sqlite3_bind_int64(stmt, 2, 1 + RandomBelow(bench, bench->products));
+    sqlite3_bind_int(stmt, 3, BENCH_PRODUCT_PAGE);
+    return StepAll(stmt);
+}
+
+static int RunSalesFirstPage(StatementBench* bench, sqlite3_stmt* stmt, int iteration) {
+    (void)bench;
+    (void)iteration;
+    sqlite3_bind_int(stmt, 1, BENCH_SALES_PAGE);
+    return StepAll(stmt);
+}
+
+static int RunSalesPage(StatementBench* bench, sqlite3_stmt* stmt, int iteration) {
+    (void)iteration;
+    sqlite3_bind_int64(stmt, 1, 1 + RandomBelow(bench, bench->sales));
+    sqlite3_bind_int(stmt, 2, BENCH_SALES_PAGE);
+    return StepAll(stmt);
+}
+
+static int RunSaleById(StatementBench* bench, sqlite3_stmt* stmt, int iteration) {
+    (void)iteration;
+    sqlite3_bind_int64(stmt, 1, 1 + RandomBelow(bench, bench->sales));
+    return StepAll(stmt);
+}
+
+static int RunInsertProduct(StatementBench* bench, sqlite3_stmt* stmt, int iteration) {
+    char name[64];
+    int ok;
+
+    snprintf(name, sizeof(name), "Bench Item %d", iteration);
+    sqlite3_bind_text(stmt, 1, name, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int(stmt, 2, 10);
+    sqlite3_bind_int64(stmt, 3, 2500);
+    ok = StepAll(stmt);
+    if (ok && bench->inserted++ == 0) {
+        bench->firstInserted = sqlite3_last_insert_rowid(bench->conn);
+    }
+    return ok;
+}
+
+static int RunUpdateProduct(StatementBench* bench, sqlite3_stmt* stmt, int iteration) {
+    char name[64];
+
+    snprintf(name, sizeof(name), "Bench Renamed %d", iteration);
+    sqlite3_bind_text(stmt, 1, name, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int(stmt, 2, 20);
+    sqlite3_bind_int64(stmt, 3, 3000);
+    sqlite3_bind_int64(stmt, 4, 1 + RandomBelow(bench, bench->products));
+    return StepAll(stmt);
+}
+
+static int RunDeleteProduct(StatementBench* bench, sqlite3_stmt* stmt, int iteration) {
+    if (iteration >= bench->inserted) {
+        return 1;
+    }
+    sqlite3_bind_int64(stmt, 1, bench->firstInserted + iteration);
+    return StepAll(stmt);
+}
+
+static int RunPurchase(StatementBench* bench, sqlite3_stmt* stmt, int iteration) {
+    (void)iteration;
+    // Restock when a shelf runs empty so the guarded update keeps succeeding
+    if (!RunPurchaseTransaction(bench->begin, stmt, bench->saleInsert, bench->commit,
+                                1 + RandomBelow(bench, bench->products), 1, NULL)) {
+        return sqlite3_exec(bench->conn, "UPDATE products SET quantity = 1000", NULL, NULL, NULL) == SQLITE_OK;
+    }
+    return 1;
+}
+
+// Full scans run fewer times than point lookups so every scale finishes in reasonable time
+static const StatementCase g_statementCases[] = {
+    { "product_scan",      SQL_PRODUCT_IDS,           10,    RunProductIds },
+    { "product_page",      SQL_PRODUCT_PAGE,          2000,  RunProductPage },
+    { "product_row",       SQL_PRODUCT_BY_ID,         20000, RunProductById },
+    { "search_like",       SQL_PRODUCT_IDS_LIKE,      10,    RunSearchLike },
+    { "search_match",      SQL_PRODUCT_IDS_MATCH,     60,    RunSearchMatch },
+    { "search_page",       SQL_PRODUCT_PAGE_MATCH,    600,   RunSearchPage },
+    { "sales_first_page",  SQL_SALES_PAGE_FIRST,      2000,  RunSalesFirstPage },
+    { "sales_page",        SQL_SALES_PAGE_BEFORE,     2000,  RunSalesPage },
+    { "sale_row",          SQL_SALE_BY_ID,            20000, RunSaleById },
+    { "insert_product",    SQL_INSERT_PRODUCT,        1000,  RunInsertProduct },
+    { "update_product",    SQL_UPDATE_PRODUCT,        1000,  RunUpdateProduct },
+    { "delete_product",    SQL_DELETE_PRODUCT,        1000,  RunDeleteProduct },
+    { "purchase",          SQL_PURCHASE_UPDATE_STOCK, 1000,  RunPurchase }
+};
+
+#define STATEMENT_CASE_COUNT ((int)(sizeof(g_statementCases) / sizeof(g_statementCases[0])))
+
+// Builds the workload at one scale, switches to the app's default profile and times every case
+static int RunStatementScale(int scale) {
+    StatementBench bench;
+    WorkloadSpec spec;
+    sqlite3* conn;
+    char labels[96];
+    int c, ok;
+
+    memset(&bench, 0, sizeof(bench));
+    Workload_Init(&spec, scale, BENCH_SEED);
+
+    conn = OpenBenchDatabase(BENCH_DB_FILENAME, FindPragmaProfile("bulk"));
+    ok = conn != NULL;
+    ok = ok && Workload_Generate(conn, &spec, NULL, NULL) == SQLITE_OK;
+    ok = ok && sqlite3_exec(conn, "BEGIN;" SQL_CREATE_PRODUCTS_FTS SQL_REBUILD_PRODUCTS_FTS ";"
+                            SQL_CREATE_PRODUCTS_FTS_TRIGGERS "COMMIT;", NULL, NULL, NULL) == SQLITE_OK;
+    ok = ok && ApplyPragmaProfile(conn, FindPragmaProfile(BENCH_PROFILE)) == SQLITE_OK;
+    if (!ok) {
+        fprintf(stderr, "cannot build scale %d database: %s\n", scale, conn ? sqlite3_errmsg(conn) : "open");
+        sqlite3_close(conn);
+        RemoveDatabase(BENCH_DB_FILENAME);
+        return 0;
+    }
+
+    bench.conn = conn;
+    bench.products = spec.products;
+    bench.sales = spec.sales;
+    bench.rng = BENCH_SEED;
+    ok = sqlite3_prepare_v2(conn, "BEGIN IMMEDIATE", -1, &bench.begin, NULL) == SQLITE_OK &&
+         sqlite3_prepare_v2(conn, "COMMIT", -1, &bench.commit, NULL) == SQLITE_OK &&
+         sqlite3_prepare_v2(conn, SQL_PURCHASE_INSERT_SALE, -1, &bench.saleInsert, NULL) == SQLITE_OK;
+
+    snprintf(labels, sizeof(labels), "\"profile\":\"%s\",\"products\":%lld,\"sales\":%lld",
+             BENCH_PROFILE, (long long)spec.products, (long long)spec.sales);
+
+    for (c = 0; ok && c < STATEMENT_CASE_COUNT; c++) {
+        const StatementCase* test = &g_statementCases[c];
+        sqlite3_stmt* stmt = NULL;
+        LatencyLog log;
+        int i;
+
+        if (sqlite3_prepare_v2(conn, test->sql, -1, &stmt, NULL) != SQLITE_OK || !LatencyLog_Start(&log, test->iterations)) {
+            fprintf(stderr, "%s: %s\n", test->op, sqlite3_errmsg(conn));
+            sqlite3_finalize(stmt);
+            ok = 0;
+            break;
+        }
+        for (i = 0; ok && i < test->iterations; i++) {
+            double started = NowSeconds();
+            ok = test->run(&bench, stmt, i);
+            LatencyLog_Add(&log, started);
+        }
+        if (ok) {
+            LatencyLog_Report(&log, "statements", labels, test->op);
+        } else {
+            fprintf(stderr, "%s failed: %s\n", test->op, sqlite3_errmsg(conn));
+        }
+        LatencyLog_Free(&log);
+        sqlite3_finalize(stmt);
+    }
+
+    sqlite3_finalize(bench.begin);
+    sqlite3_finalize(bench.commit);
+    sqlite3_finalize(bench.saleInsert);
+    sqlite3_close(conn);
+    RemoveDatabase(BENCH_DB_FILENAME);
+    return ok;
+}
+
+static int BenchStatements(int argc, char** argv) {
+    static const int defaultScales[] = { 1, 2, 4 };
+    int i;
+
+    if (argc == 0) {
+        for (i = 0; i < (int)(sizeof(defaultScales) / sizeof(defaultScales[0])); i++) {
+            if (!RunStatementScale(defaultScales[i])) {
+                return 0;
+            }
+        }
+        return 1;
+    }
+    for (i = 0; i < argc; i++) {
+        if (atoi(argv[i]) <= 0) {
+            fprintf(stderr, "scale must be a positive integer: %s\n", argv[i]);
+            return 0;
+        }
+        if (!RunStatementScale(atoi(argv[i]))) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/*
+ * Cart checkout: a whole basket in one transaction against one purchase transaction per line
+ */
+
+typedef struct {
+    sqlite3_stmt* begin;
+    sqlite3_stmt* update;
+    sqlite3_stmt* insertSale;
+    sqlite3_stmt* insertReceipt;
+    sqlite3_stmt* insertLine;
+    sqlite3_stmt* updateTotal;
+    sqlite3_stmt* commit;
+} CheckoutStatements;
+
+// The worker's checkout: receipt header, a sale and a sale line per product, the total, one COMMIT
+static int RunCheckoutTransaction(CheckoutStatements* st, sqlite3_int64 firstProduct, int lines) {
+    sqlite3* conn = sqlite3_db_handle(st->begin);
+    sqlite3_int64 receiptId;
+    sqlite3_int64 total = 0;
+    int i, ok = StepAll(st->begin);
+
+    sqlite3_bind_int(st->insertReceipt, 1, lines);
+    ok = ok && StepAll(st->insertReceipt);
+    receiptId = sqlite3_last_insert_rowid(conn);
+
+    for (i = 0; ok && i < lines; i++) {
+        sqlite3_int64 productId = (firstProduct + i) % BENCH_PRODUCTS + 1;
+        sqlite3_int64 unitPrice = 0;
+
+        sqlite3_bind_int(st->update, 1, 1);
+        sqlite3_bind_int64(st->update, 2, productId);
+        if (sqlite3_step(st->update) == SQLITE_ROW) {
+            unitPrice = sqlite3_column_int64(st->update, 1);
+            sqlite3_bind_int64(st->insertSale, 1, productId);
+            sqlite3_bind_text(st->insertSale, 2, (const char*)sqlite3_column_text(st->update, 2), -1, SQLITE_TRANSIENT);
+            sqlite3_bind_int(st->insertSale, 3, 1);
+            sqlite3_bind_int64(st->insertSale, 4, unitPrice);
+            ok = sqlite3_step(st->update) == SQLITE_DONE;
+        } else {
+            ok = 0;
+        }
+        sqlite3_reset(st->update);
+        ok = ok && StepAll(st->insertSale);
+        total += unitPrice;
+
+        sqlite3_bind_int64(st->insertLine, 1, receiptId);
+        sqlite3_bind_int(st->insertLine, 2, i + 1);
+        sqlite3_bind_int64(st->insertLine, 3, sqlite3_last_insert_rowid(conn));
+        sqlite3_bind_int64(st->insertLine, 4, unitPrice);
+        ok = ok && StepAll(st->insertLine);
+    }
+
+    sqlite3_bind_int64(st->updateTotal, 1, total);
+    sqlite3_bind_int64(st->updateTotal, 2, receiptId);
+    ok = ok && StepAll(st->updateTotal);
+    ok = ok && StepAll(st->commit);
+    if (!ok) {
+        sqlite3_exec(conn, "ROLLBACK", NULL, NULL, NULL);
+    }
+    return ok;
+}
+
+static int RunCheckoutSize(int lines) {
+    const PragmaProfile* profile = FindPragmaProfile(BENCH_PROFILE);
+    sqlite3* conn = OpenBenchDatabase(BENCH_DB_FILENAME, profile);
+    CheckoutStatements st = { NULL, NULL, NULL, NULL, NULL, NULL, NULL };
+    WorkloadSpec spec;
+    LatencyLog checkout = { NULL, 0, 0, 0.0 };
+    LatencyLog perLine = { NULL, 0, 0, 0.0 };
+    char labels[96];
+    int i, j, ok = conn != NULL;
+
+    Workload_Init(&spec, 1, BENCH_SEED);
+    spec.products = BENCH_PRODUCTS;
+    spec.sales = 0;
+
+    ok = ok && Workload_Generate(conn, &spec, NULL, NULL) == SQLITE_OK;
+    ok = ok && sqlite3_exec(conn, "UPDATE products SET quantity = 1000000", NULL, NULL, NULL) == SQLITE_OK;
+    ok = ok && sqlite3_prepare_v2(conn, "BEGIN IMMEDIATE", -1, &st.begin, NULL) == SQLITE_OK;
+    ok = ok && sqlite3_prepare_v2(conn, SQL_PURCHASE_UPDATE_STOCK, -1, &st.update, NULL) == SQLITE_OK;
+    ok = ok && sqlite3_prepare_v2(conn, SQL_PURCHASE_INSERT_SALE, -1, &st.insertSale, NULL) == SQLITE_OK;
+    ok = ok && sqlite3_prepare_v2(conn, SQL_INSERT_RECEIPT, -1, &st.insertReceipt, NULL) == SQLITE_OK;
+    ok = ok && sqlite3_prepare_v2(conn, SQL_INSERT_SALE_LINE, -1, &st.insertLine, NULL) == SQLITE_OK;
+    ok = ok && sqlite3_prepare_v2(conn, SQL_UPDATE_RECEIPT_TOTAL, -1, &st.updateTotal, NULL) == SQLITE_OK;
+    ok = ok && sqlite3_prepare_v2(conn, "COMMIT", -1, &st.commit, NULL) == SQLITE_OK;
+    ok = ok && LatencyLog_Start(&checkout, BENCH_CHECKOUT_BASKETS);
+    ok = ok && LatencyLog_Start(&perLine, BENCH_CHECKOUT_BASKETS);
+
+    snprintf(labels, sizeof(labels), "\"profile\":\"%s\",\"lines\":%d", profile->name, lines);
+
+    // Latency is per basket in both modes, from the first statement to the last commit
+    for (i = 0; ok && i < BENCH_CHECKOUT_BASKETS; i++) {
+        double started = NowSeconds();
+        ok = RunCheckoutTransaction(&st, (sqlite3_int64)i * lines, lines);
+        LatencyLog_Add(&checkout, started);
+    }
+    if (ok) {
+        LatencyLog_Report(&checkout, "checkout", labels, "one_transaction");
+    }
+
+    perLine.started = NowSeconds();
+    for (i = 0; ok && i < BENCH_CHECKOUT_BASKETS; i++) {
+        double started = NowSeconds();
+        for (j = 0; ok && j < lines; j++) {
+            ok = RunPurchaseTransaction(st.begin, st.update, st.insertSale, st.commit,
+                                        ((sqlite3_int64)i * lines + j) % BENCH_PRODUCTS + 1, 1, NULL);
+        }
+        LatencyLog_Add(&perLine, started);
+    }
+    if (ok) {
+        LatencyLog_Report(&perLine, "checkout", labels, "transaction_per_line");
+    } else {
+        fprintf(stderr, "checkout of %d lines failed: %s\n", lines, conn ? sqlite3_errmsg(conn) : "open");
+    }
+    LatencyLog_Free(&checkout);
+    LatencyLog_Free(&perLine);
+
+    sqlite3_finalize(st.begin);
+    sqlite3_finalize(st.update);
+    sqlite3_finalize(st.insertSale);
+    sqlite3_finalize(st.insertReceipt);
+    sqlite3_finalize(st.insertLine);
+    sqlite3_finalize(st.updateTotal);
+    sqlite3_finalize(st.commit);
+    sqlite3_close(conn);
+    RemoveDatabase(BENCH_DB_FILENAME);
+    return ok;
+}
+
+static int BenchCheckout(int argc, char** argv) {
+    static const int defaultSizes[] = { 1, 5, 10, 30, 100 };
+    int i;
+
+    if (argc == 0) {
+        for (i = 0; i < (int)(sizeof(defaultSizes) / sizeof(defaultSizes[0])); i++) {
+            if (!RunCheckoutSize(defaultSizes[i])) {
+                return 0;
+            }
+        }
+        return 1;
+    }
+    for (i = 0; i < argc; i++) {
+        if (atoi(argv[i]) <= 0) {
+            fprintf(stderr, "basket size must be a positive integer: %s\n", argv[i]);
+            return 0;
+        }
+        if (!RunCheckoutSize(atoi(argv[i]))) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/*
+ * Group commit: concurrent tills queue purchases on the DbWorker from db_worker.c, the worker
+ * main.c runs, and wait for the COMMIT that makes their sale durable
+ */
+
+struct GroupProducer;
+
+typedef struct {
+    DbWork work;                // first: the worker queues sales through it
+    sqlite3_int64 productId;
+    struct GroupProducer* producer;
+    int done;                   // the acknowledgement, set under the producer's lock after COMMIT
+} GroupSale;
+
+typedef struct GroupProducer {
+    DbWorker* worker;
+    pthread_mutex_t lock;
+    pthread_cond_t acked;
+    LatencyLog log;
+    double stopAt;
+    int index;
+    int ok;
+} GroupProducer;
+
+// One unit of a product as the worker's RecordSale buys it, inside the mutation's savepoint
+static int WorkerPurchase(DbWorker* worker, sqlite3_int64 productId) {
+    sqlite3_stmt* update = StmtCache_Acquire(&worker->stmts, SQL_PURCHASE_UPDATE_STOCK);
+    sqlite3_stmt* insert = StmtCache_Acquire(&worker->stmts, SQL_PURCHASE_INSERT_SALE);
+    int ok = 0;
+
+    if (update && insert) {
+        sqlite3_bind_int(update, 1, 1);
+        sqlite3_bind_int64(update, 2, productId);
+        if (sqlite3_step(update) == SQLITE_ROW) {
+            sqlite3_bind_int64(insert, 1, productId);
+            sqlite3_bind_text(insert, 2, (const char*)sqlite3_column_text(update, 2), -1, SQLITE_TRANSIENT);
+            sqlite3_bind_int(insert, 3, 1);
+            sqlite3_bind_int64(insert, 4, sqlite3_column_int64(update, 1));
+            ok = sqlite3_step(update) == SQLITE_DONE && sqlite3_step(insert) == SQLITE_DONE;
+        }
+    }
+    StmtCache_Release(&worker->stmts, update);
+    StmtCache_Release(&worker->stmts, insert);
+    return ok;
+}
+
+// The benchmarks queue mutations only
+static int WorkerRunNothing(DbWorker* worker, DbWork* work) {
+    (void)worker;
+    work->error = "not a mutation";
+    return 1;
+}
+
+static void GroupSale_Mutate(DbWorker* worker, DbWork* work) {
+    work->ok = WorkerPurchase(worker, ((GroupSale*)work)->productId);
+}
+
+static void GroupSale_Done(DbWork* work) {
+    GroupSale* sale = (GroupSale*)work;
+    GroupProducer* producer = sale->producer;
+
+    pthread_mutex_lock(&producer->lock);
+    sale->done = 1;
+    pthread_cond_signal(&producer->acked);
+    pthread_mutex_unlock(&producer->lock);
+}
+
+// A till: submit a sale, wait for its acknowledgement, repeat until time is up
+static void* GroupProducerThread(void* param) {
+    GroupProducer* producer = (GroupProducer*)param;
+    sqlite3_int64 next = producer->index;
+
+    producer->ok = 1;
+    while (producer->ok && producer->log.count < producer->log.capacity && NowSeconds() < producer->stopAt) {
+        GroupSale sale;
+        double started = NowSeconds();
+
+        memset(&sale, 0, sizeof(sale));
+        sale.work.mutation = 1;
+        sale.productId = next++ % BENCH_PRODUCTS + 1;
+        sale.producer = producer;
+        DbWorker_Submit(producer->worker, &sale.work);
+
+        pthread_mutex_lock(&producer->lock);
+        while (!sale.done) {
+            pthread_cond_wait(&producer->acked, &producer->lock);
+        }
+        pthread_mutex_unlock(&producer->lock);
+
+        producer->ok = sale.work.ok;
+        LatencyLog_Add(&producer->log, started);
+    }
+    return NULL;
+}
+
+static int RunGroupCommit(const PragmaProfile* profile, int windowMs, int producers) {
+    DbWorker worker;
+    GroupProducer workers[BENCH_GROUP_MAX_PRODUCERS];
+    pthread_t producerThreads[BENCH_GROUP_MAX_PRODUCERS];
+    LatencyLog log = { NULL, 0, 0, 0.0 };
+    double stopAt;
+    char labels[128];
+    int i, started = 0, ok;
+
+    memset(&worker, 0, sizeof(worker));
+    worker.mutate = GroupSale_Mutate;
+    worker.run = WorkerRunNothing;
+    worker.done = GroupSale_Done;
+    worker.groupCommitMs = windowMs;
+    worker.groupCommitBatch = GROUP_COMMIT_DEFAULT_BATCH;
+    ok = LatencyLog_Start(&log, BENCH_GROUP_MAX_SAMPLES);
+    ok = ok && DbWorker_Start(&worker, BENCH_DB_FILENAME, profile);
+
+    if (ok) {
+        stopAt = NowSeconds() + BENCH_GROUP_SECONDS;
+        log.started = NowSeconds();
+        for (i = 0; i < producers; i++) {
+            GroupProducer* producer = &workers[i];
+
+            producer->worker = &worker;
+            producer->stopAt = stopAt;
+            producer->index = i * (BENCH_PRODUCTS / producers);
+            pthread_mutex_init(&producer->lock, NULL);
+            pthread_cond_init(&producer->acked, NULL);
+            if (!LatencyLog_Start(&producer->log, BENCH_GROUP_MAX_SAMPLES / producers) ||
+                pthread_create(&producerThreads[i], NULL, GroupProducerThread, producer) != 0) {
+                LatencyLog_Free(&producer->log);
+                pthread_cond_destroy(&producer->acked);
+                pthread_mutex_destroy(&producer->lock);
+                ok = 0;
+                break;
+            }
+            started++;
+        }
+        for (i = 0; i < started; i++) {
+            pthread_join(producerThreads[i], NULL);
+            ok = ok && workers[i].ok;
+            LatencyLog_Append(&log, &workers[i].log);
+            LatencyLog_Free(&workers[i].log);
+            pthread_cond_destroy(&workers[i].acked);
+            pthread_mutex_destroy(&workers[i].lock);
+        }
+        DbWorker_Stop(&worker);
+    }
+
+    if (ok) {
+        snprintf(labels, sizeof(labels), "\"profile\":\"%s\",\"window_ms\":%d,\"producers\":%d,\"commits\":%ld",
+                 profile->name, windowMs, producers, worker.commits);
+        LatencyLog_Report(&log, "groupcommit", labels, "purchase_ack");
+    } else {
+        fprintf(stderr, "group commit with %d producers failed\n", producers);
+    }
+    LatencyLog_Free(&log);
+    return ok;
+}
+
+// Acknowledged purchases per second and ack latency by window and producer count. Uses the
+// "safe" profile: only with synchronous=FULL is an acknowledged sale durable.
+static int BenchGroupCommit(int argc, char** argv) {
+    static const int defaultWindows[] = { 0, 1, 2, 5, 10 };
+    const PragmaProfile* profile = FindPragmaProfile("safe");
+    int windows[16];
+    int windowCount = 0;
+    sqlite3* conn;
+    WorkloadSpec spec;
+    int i, producers, ok;
+
+    if (argc == 0) {
+        for (i = 0; i < (int)(sizeof(defaultWindows) / sizeof(defaultWindows[0])); i++) {
+            windows[windowCount++] = defaultWindows[i];
+        }
+    }
+    for (i = 0; i < argc && windowCount < (int)(sizeof(windows) / sizeof(windows[0])); i++) {
+        if (argv[i][0] < '0' || argv[i][0] > '9') {
+            fprintf(stderr, "window must be a non-negative integer: %s\n", argv[i]);
+            return 0;
+        }
+        windows[windowCount++] = atoi(argv[i]);
+    }
+
+    conn = OpenBenchDatabase(BENCH_DB_FILENAME, profile);
+    ok = conn != NULL;
+    Workload_Init(&spec, 1, BENCH_SEED);
+    spec.products = BENCH_PRODUCTS;
+    spec.sales = 0;
+    ok = ok && Workload_Generate(conn, &spec, NULL, NULL) == SQLITE_OK;
+    ok = ok && sqlite3_exec(conn, "UPDATE products SET quantity = 1000000000", NULL, NULL, NULL) == SQLITE_OK;
+
+    for (i = 0; ok && i < windowCount; i++) {
+        for (producers = 1; ok && producers <= BENCH_GROUP_MAX_PRODUCERS; producers *= 2) {
+            ok = RunGroupCommit(profile, windows[i], producers);
+        }
+    }
+
+    sqlite3_close(conn);
+    RemoveDatabase(BENCH_DB_FILENAME);
+    return ok;
+}
+
+/*
+ * Single writer: producer threads hand typed mutation records to the DbWorker from
+ * db_worker.c, through DbWorker_Submit and its lock-free queue as main.c does, and wait on
+ * each record's completion. The worker coalesces whatever is queued into one transaction.
+ */
+
+#define BENCH_WRITER_INFLIGHT 16    // records a producer may have queued before it waits
+#define BENCH_WRITER_ADD_EVERY 8    // every eighth mutation adds a product, the rest are purchases
+
+typedef enum {
+    MUTATION_PURCHASE,
+    MUTATION_ADD_PRODUCT
+} MutationType;
+
+struct WriterProducer;
+
+typedef struct {
+    DbWork work;                    // first: the worker queues records through it
+    MutationType type;
+    sqlite3_int64 productId;
+    char name[64];
+    double submittedAt;
+    struct WriterProducer* producer;
+    int done;                       // the completion, set under the producer's lock after COMMIT
+} WriterMutation;
+
+typedef struct {
+    DbWorker worker;
+    double stopAt;
+    LatencyLog queueLog;            // submitted to its savepoint, written by the worker only
+    LatencyLog ackLog;              // submitted to acknowledged, likewise
+} Writer;
+
+typedef struct WriterProducer {
+    Writer* writer;
+    pthread_mutex_t lock;
+    pthread_cond_t acked;
+    WriterMutation records[BENCH_WRITER_INFLIGHT];
+    int run;
+    int index;
+    int submitted;
+    int ok;
+} WriterProducer;
+
+static Writer g_writer;
+
+static void WriterMutation_Apply(DbWorker* worker, DbWork* work) {
+    WriterMutation* m = (WriterMutation*)work;
+    sqlite3_stmt* stmt;
+
+    LatencyLog_Add(&g_writer.queueLog, m->submittedAt);
+    if (m->type == MUTATION_PURCHASE) {
+        work->ok = WorkerPurchase(worker, m->productId);
+        return;
+    }
+
+    stmt = StmtCache_Acquire(&worker->stmts, SQL_INSERT_PRODUCT);
+    if (stmt) {
+        sqlite3_bind_text(stmt, 1, m->name, -1, SQLITE_STATIC);
+        sqlite3_bind_int(stmt, 2, 1000000);
+        sqlite3_bind_int64(stmt, 3, 1999);
+        work->ok = sqlite3_step(stmt) == SQLITE_DONE;
+    }
+    StmtCache_Release(&worker->stmts, stmt);
+}
+
+static void WriterMutation_Done(DbWork* work) {
+    WriterMutation* m = (WriterMutation*)work;
+    WriterProducer* producer = m->producer;
+
+    LatencyLog_Add(&g_writer.ackLog, m->submittedAt);
+    pthread_mutex_lock(&producer->lock);
+    m->done = 1;
+    pthread_cond_signal(&producer->acked);
+    pthread_mutex_unlock(&producer->lock);
+}
+
+// Waits for a record's completion; 0 if it failed
+static int WriterProducer_Wait(WriterProducer* producer, WriterMutation* m) {
+    pthread_mutex_lock(&producer->lock);
+    while (!m->done) {
+        pthread_cond_wait(&producer->acked, &producer->lock);
+    }
+    pthread_mutex_unlock(&producer->lock);
+    return m->work.ok;
+}
+
+// Keeps up to BENCH_WRITER_INFLIGHT records queued until time is up, then waits for the rest
+static void* WriterProducerThread(void* param) {
+    WriterProducer* producer = (WriterProducer*)param;
+    Writer* w = producer->writer;
+    int i;
+
+    producer->ok = 1;
+    while (producer->ok && NowSeconds() < w->stopAt) {
+        WriterMutation* m = &producer->records[producer->submitted % BENCH_WRITER_INFLIGHT];
+
+        producer->ok = WriterProducer_Wait(producer, m);
+        memset(&m->work, 0, sizeof(m->work));
+        m->work.mutation = 1;
+        if (producer->submitted % BENCH_WRITER_ADD_EVERY == 0) {
+            m->type = MUTATION_ADD_PRODUCT;
+            snprintf(m->name, sizeof(m->name), "Writer %d-%d-%d", producer->run, producer->index, producer->submitted);
+        } else {
+            m->type = MUTATION_PURCHASE;
+            m->productId = (producer->index * 7919 + producer->submitted) % BENCH_PRODUCTS + 1;
+        }
+        m->producer = producer;
+        m->done = 0;
+        m->submittedAt = NowSeconds();
+        DbWorker_Submit(&w->worker, &m->work);
+        producer->submitted++;
+    }
+    for (i = 0; i < BENCH_WRITER_INFLIGHT; i++) {
+        producer->ok = WriterProducer_Wait(producer, &producer->records[i]) && producer->ok;
+    }
+    return NULL;
+}
+
+static int RunWriter(const PragmaProfile* profile, int run, int producers) {
+    Writer* w = &g_writer;
+    WriterProducer* workers = (WriterProducer*)calloc(producers, sizeof(WriterProducer));
+    pthread_t producerThreads[BENCH_GROUP_MAX_PRODUCERS];
+    char labels[160];
+    int i, started = 0, ok;
+
+    memset(w, 0, sizeof(*w));
+    w->worker.mutate = WriterMutation_Apply;
+    w->worker.run = WorkerRunNothing;
+    w->worker.done = WriterMutation_Done;
+    w->worker.groupCommitMs = 0;
+    w->worker.groupCommitBatch = GROUP_COMMIT_DEFAULT_BATCH;
+
+    ok = workers != NULL;
+    ok = ok && LatencyLog_Start(&w->queueLog, BENCH_GROUP_MAX_SAMPLES);
+    ok = ok && LatencyLog_Start(&w->ackLog, BENCH_GROUP_MAX_SAMPLES);
+    ok = ok && DbWorker_Start(&w->worker, BENCH_DB_FILENAME, profile);
+
+    if (ok) {
+        w->stopAt = NowSeconds() + BENCH_GROUP_SECONDS;
+        w->queueLog.started = w->ackLog.started = NowSeconds();
+        for (i = 0; i < producers; i++) {
+            WriterProducer* producer = &workers[i];
+            int r;
+
+            producer->writer = w;
+            producer->run = run;
+            producer->index = i;
+            pthread_mutex_init(&producer->lock, NULL);
+            pthread_cond_init(&producer->acked, NULL);
+            for (r = 0; r < BENCH_WRITER_INFLIGHT; r++) {
+                producer->records[r].done = 1;
+                producer->records[r].work.ok = 1;
+            }
+            if (pthread_create(&producerThreads[i], NULL, WriterProducerThread, producer) != 0) {
+                ok = 0;
+                break;
+            }
+            started++;
+        }
+        for (i = 0; i < started; i++) {
+            pthread_join(producerThreads[i], NULL);
+            ok = ok && workers[i].ok;
+        }
+        DbWorker_Stop(&w->worker);
+
+        for (i = 0; i < producers; i++) {
+            pthread_cond_destroy(&workers[i].acked);
+            pthread_mutex_destroy(&workers[i].lock);
+        }
+    }
+
+    if (ok) {
+        snprintf(labels, sizeof(labels), "\"producers\":%d,\"commits\":%ld,\"avg_batch\":%.1f",
+                 producers, w->worker.commits,
+                 w->worker.commits > 0 ? (double)w->ackLog.count / w->worker.commits : 0.0);
+        LatencyLog_Report(&w->ackLog, "writer", labels, "mutation_ack");
+        LatencyLog_Report(&w->queueLog, "writer", labels, "queue_wait");
+    } else {
+        fprintf(stderr, "writer with %d producers failed\n", producers);
+    }
+    LatencyLog_Free(&w->queueLog);
+    LatencyLog_Free(&w->ackLog);
+    free(workers);
+    return ok;
+}
+
+// Mutations per second, queue wait and acknowledgement latency by producer count
+static int BenchWriter(int argc, char** argv) {
+    static const int defaultProducers[] = { 1, 4, 16, 64 };
+    const PragmaProfile* profile = FindPragmaProfile(BENCH_PROFILE);
+    int counts[16];
+    int countCount = 0;
+    sqlite3* conn;
+    WorkloadSpec spec;
+    int i, ok;
+
+    if (argc == 0) {
+        for (i = 0; i < (int)(sizeof(defaultProducers) / sizeof(defaultProducers[0])); i++) {
+            counts[countCount++] = defaultProducers[i];
+        }
+    }
+    for (i = 0; i < argc && countCount < (int)(sizeof(counts) / sizeof(counts[0])); i++) {
+        int producers = atoi(argv[i]);
+        if (producers < 1 || producers > BENCH_GROUP_MAX_PRODUCERS) {
+            fprintf(stderr, "producers must be between 1 and %d: %s\n", BENCH_GROUP_MAX_PRODUCERS, argv[i]);
+            return 0;
+        }
+        counts[countCount++] = producers;
+    }
+
+    conn = OpenBenchDatabase(BENCH_DB_FILENAME, profile);
+    ok = conn != NULL;
+    Workload_Init(&spec, 1, BENCH_SEED);
+    spec.products = BENCH_PRODUCTS;
+    spec.sales = 0;
+    ok = ok && Workload_Generate(conn, &spec, NULL, NULL) == SQLITE_OK;
+    ok = ok && sqlite3_exec(conn, "UPDATE products SET quantity = 1000000000", NULL, NULL, NULL) == SQLITE_OK;
+
+    for (i = 0; ok && i < countCount; i++) {
+        ok = RunWriter(profile, i, counts[i]);
+    }
+
+    sqlite3_close(conn);
+    RemoveDatabase(BENCH_DB_FILENAME);
+    return ok;
+}
+
+/*
+ * Sales totals: the sales_daily rollup against scanning sales, with the catalog fixed and sales growing
+ */
+
+typedef struct {
+    const char* op;
+    const char* sql;
+    int months;         // 1 for a calendar month of the workload year, 12 for the whole year
+    int iterations;
+} TotalsCase;
+
+static const TotalsCase g_totalsCases[] = {
+    { "month_rollup", SQL_SALES_TOTALS_ROLLUP, 1,  100 },
+    { "year_rollup",  SQL_SALES_TOTALS_ROLLUP, 12, 20 },
+    { "month_scan",   SQL_SALES_TOTALS_SCAN,   1,  3 },
+    { "year_scan",    SQL_SALES_TOTALS_SCAN,   12, 3 }
+};
+
+#define TOTALS_CASE_COUNT ((int)(sizeof(g_totalsCases) / sizeof(g_totalsCases[0])))
+
+// The workload's sales fall in 2024 (WORKLOAD_DEFAULT_END_TIME is 2025-01-01)
+#define BENCH_TOTALS_YEAR 2024
+
+static sqlite3_int64 QueryInt64(sqlite3* conn, const char* sql) {
+    sqlite3_stmt* stmt;
+    sqlite3_int64 value = -1;
+
+    if (sqlite3_prepare_v2(conn, sql, -1, &stmt, NULL) == SQLITE_OK && sqlite3_step(stmt) == SQLITE_ROW) {
+        value = sqlite3_column_int64(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+    return value;
+}
+
+// The iteration-th range of a totals case: successive calendar months, or the whole year
+static void TotalsRange(int months, int iteration, char from[32], char to[32]) {
+    int month = months == 12 ? 1 : iteration % 12 + 1;
+    int end = month + months;
+
+    snprintf(from, 32, "%04d-%02d-01", BENCH_TOTALS_YEAR, month);
+    snprintf(to, 32, "%04d-%02d-01", BENCH_TOTALS_YEAR + (end > 12), end > 12 ? end - 12 : end);
+}
+
+static int RunRollupScale(int scale) {
+    WorkloadSpec spec;
+    sqlite3* conn;
+    char labels[160];
+    double started, buildSeconds;
+    sqlite3_int64 rollupRows;
+    int c, ok;
+
+    Workload_Init(&spec, scale, BENCH_SEED);
+    spec.products = WORKLOAD_PRODUCTS_PER_SCALE;
+
+    conn = OpenBenchDatabase(BENCH_DB_FILENAME, FindPragmaProfile("bulk"));
+    ok = conn != NULL;
+    ok = ok && Workload_Generate(conn, &spec, NULL, NULL) == SQLITE_OK;
+
+    // Same one-off backfill the app runs on a database that predates the rollup
+    started = NowSeconds();
+    ok = ok && sqlite3_exec(conn, "BEGIN;" SQL_CREATE_SALES_DAILY SQL_REBUILD_SALES_DAILY
+                            SQL_CREATE_SALES_DAILY_TRIGGERS "COMMIT;", NULL, NULL, NULL) == SQLITE_OK;
+    buildSeconds = NowSeconds() - started;
+    ok = ok && ApplyPragmaProfile(conn, FindPragmaProfile(BENCH_PROFILE)) == SQLITE_OK;
+    if (!ok) {
+        fprintf(stderr, "cannot build scale %d database: %s\n", scale, conn ? sqlite3_errmsg(conn) : "open");
+        sqlite3_close(conn);
+        RemoveDatabase(BENCH_DB_FILENAME);
+        return 0;
+    }
+
+    rollupRows = QueryInt64(conn, "SELECT COUNT(*) FROM sales_daily") + QueryInt64(conn, "SELECT COUNT(*) FROM sales_daily_totals");
+    snprintf(labels, sizeof(labels), "\"profile\":\"%s\",\"products\":%lld,\"sales\":%lld,\"rollup_rows\":%lld",
+             BENCH_PROFILE, (long long)spec.products, (long long)spec.sales, (long long)rollupRows);
+    printf("{\"bench\":\"rollup\",%s,\"op\":\"build\",\"seconds\":%.2f}\n", labels, buildSeconds);
+
+    for (c = 0; ok && c < TOTALS_CASE_COUNT; c++) {
+        const TotalsCase* test = &g_totalsCases[c];
+        sqlite3_stmt* stmt = NULL;
+        LatencyLog log;
+        int i;
+
+        if (sqlite3_prepare_v2(conn, test->sql, -1, &stmt, NULL) != SQLITE_OK || !LatencyLog_Start(&log, test->iterations)) {
+            fprintf(stderr, "%s: %s\n", test->op, sqlite3_errmsg(conn));
+            sqlite3_finalize(stmt);
+            ok = 0;
+            break;
+        }
+        for (i = 0; ok && i < test->iterations; i++) {
+            char from[32], to[32];
+            double started = NowSeconds();
+
+            TotalsRange(test->months, i, from, to);
+            sqlite3_bind_text(stmt, 1, from, -1, SQLITE_TRANSIENT);
+            sqlite3_bind_text(stmt, 2, to, -1, SQLITE_TRANSIENT);
+            ok = StepAll(stmt);
+            LatencyLog_Add(&log, started);
+        }
+        if (ok) {
+            LatencyLog_Report(&log, "rollup", labels, test->op);
+        } else {
+            fprintf(stderr, "%s failed: %s\n", test->op, sqlite3_errmsg(conn));
+        }
+        LatencyLog_Free(&log);
+        sqlite3_finalize(stmt);
+    }
+
+    sqlite3_close(conn);
+    RemoveDatabase(BENCH_DB_FILENAME);
+    return ok;
+}
+
+// Scale multiplies the sales only: 1 is 1,000,000 sales and 100 is 100,000,000
+static int BenchRollup(int argc, char** argv) {
+    static const int defaultScales[] = { 1, 2, 4 };
+    int i;
+
+    if (argc == 0) {
+        for (i = 0; i < (int)(sizeof(defaultScales) / sizeof(defaultScales[0])); i++) {
+            if (!RunRollupScale(defaultScales[i])) {
+                return 0;
+            }
+        }
+        return 1;
+    }
+    for (i = 0; i < argc; i++) {
+        if (atoi(argv[i]) <= 0) {
+            fprintf(stderr, "scale must be a positive integer: %s\n", argv[i]);
+            return 0;
+        }
+        if (!RunRollupScale(atoi(argv[i]))) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/*
+ * Report readers: purchase latency while sales scans run, with the scans queued behind the
+ * purchases on the writer's connection, as the worker ran them, or each on its own read-only
+ * connection, as the DbReaders pool in db_worker.c runs them under WAL
+ */
+
+#define BENCH_READERS_MAX 16
+#define BENCH_READERS_SALES 200000
+
+typedef struct {
+    sqlite3* conn;              // writer's connection
+    pthread_mutex_t lock;       // shared mode: one statement at a time on conn
+    int shared;
+    double stopAt;
+} ReaderRun;
+
+typedef struct {
+    ReaderRun* run;
+    sqlite3* conn;              // pool mode: this scanner's read-only connection
+    int scans;
+    int ok;
+} ReaderScanner;
+
+static void* ReaderScannerThread(void* param) {
+    ReaderScanner* scanner = (ReaderScanner*)param;
+    ReaderRun* run = scanner->run;
+    sqlite3* conn = run->shared ? run->conn : scanner->conn;
+    sqlite3_stmt* stmt = NULL;
+    char from[32], to[32];
+
+    snprintf(from, sizeof(from), "%04d-01-01", BENCH_TOTALS_YEAR);
+    snprintf(to, sizeof(to), "%04d-01-01", BENCH_TOTALS_YEAR + 1);
+    if (run->shared) {
+        pthread_mutex_lock(&run->lock);
+    }
+    scanner->ok = sqlite3_prepare_v2(conn, SQL_SALES_TOTALS_SCAN, -1, &stmt, NULL) == SQLITE_OK;
+    if (run->shared) {
+        pthread_mutex_unlock(&run->lock);
+    }
+
+    while (scanner->ok && NowSeconds() < run->stopAt) {
+        if (run->shared) {
+            pthread_mutex_lock(&run->lock);
+        }
+        sqlite3_bind_text(stmt, 1, from, -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 2, to, -1, SQLITE_STATIC);
+        scanner->ok = StepAll(stmt);
+        if (run->shared) {
+            pthread_mutex_unlock(&run->lock);
+        }
+        scanner->scans++;
+    }
+    sqlite3_finalize(stmt);
+    return NULL;
+}
+
+static int RunReaders(ReaderRun* run, const PragmaProfile* profile, int scanners) {
+    ReaderScanner workers[BENCH_READERS_MAX];
+    pthread_t threads[BENCH_READERS_MAX];
+    sqlite3_stmt *begin = NULL, *update = NULL, *insert = NULL, *commit = NULL;
+    LatencyLog log;
+    char labels[128];
+    double started;
+    int i, startedCount = 0, scans = 0, purchases = 0;
+    int ok = LatencyLog_Start(&log, BENCH_GROUP_MAX_SAMPLES);
+
+    memset(workers, 0, sizeof(workers));
+    for (i = 0; ok && i < scanners; i++) {
+        workers[i].run = run;
+        if (!run->shared && OpenReadConnection(BENCH_DB_FILENAME, profile, &workers[i].conn) != SQLITE_OK) {
+            fprintf(stderr, "cannot open read connection %d\n", i);
+            ok = 0;
+        }
+    }
+    ok = ok && sqlite3_prepare_v2(run->conn, "BEGIN IMMEDIATE", -1, &begin, NULL) == SQLITE_OK;
+    ok = ok && sqlite3_prepare_v2(run->conn, SQL_PURCHASE_UPDATE_STOCK, -1, &update, NULL) == SQLITE_OK;
+    ok = ok && sqlite3_prepare_v2(run->conn, SQL_PURCHASE_INSERT_SALE, -1, &insert, NULL) == SQLITE_OK;
+    ok = ok && sqlite3_prepare_v2(run->conn, "COMMIT", -1, &commit, NULL) == SQLITE_OK;
+
+    run->stopAt = NowSeconds() + BENCH_GROUP_SECONDS;
+    for (i = 0; ok && i < scanners; i++) {
+        if (pthread_create(&threads[i], NULL, ReaderScannerThread, &workers[i]) != 0) {
+            ok = 0;
+            break;
+        }
+        startedCount++;
+    }
+
+    // The till: one purchase after another, each timed from the moment it was ready to run
+    log.started = NowSeconds();
+    while (ok && (started = NowSeconds()) < run->stopAt) {
+        if (run->shared) {
+            pthread_mutex_lock(&run->lock);
+        }
+        ok = RunPurchaseTransaction(begin, update, insert, commit, purchases % BENCH_PRODUCTS + 1, 1, NULL);
+        if (run->shared) {
+            pthread_mutex_unlock(&run->lock);
+        }
+        LatencyLog_Add(&log, started);
+        purchases++;
+    }
+
+    for (i = 0; i < startedCount; i++) {
+        pthread_join(threads[i], NULL);
+        ok = ok && workers[i].ok;
+        scans += workers[i].scans;
+    }
+
+    if (ok) {
+        double elapsed = NowSeconds() - log.started;
+
+        snprintf(labels, sizeof(labels), "\"mode\":\"%s\",\"scanners\":%d,\"scans_per_sec\":%.1f",
+                 run->shared ? "shared" : "pool", scanners, scans / elapsed);
+        LatencyLog_Report(&log, "readers", labels, "purchase");
+    } else {
+        fprintf(stderr, "readers with %d scanners failed: %s\n", scanners, sqlite3_errmsg(run->conn));
+    }
+    LatencyLog_Free(&log);
+
+    for (i = 0; i < scanners; i++) {
+        sqlite3_close(workers[i].conn);
+    }
+    sqlite3_finalize(begin);
+    sqlite3_finalize(update);
+    sqlite3_finalize(insert);
+    sqlite3_finalize(commit);
+    return ok;
+}
+
+// Purchase latency by number of concurrent year-long sales scans, 0-16, for scans sharing the
+// writer's connection and scans on a pool of read-only connections
+static int BenchReaders(int argc, char** argv) {
+    static const int defaultScanners[] = { 0, 1, 2, 4, 8 };
+    const PragmaProfile* profile = FindPragmaProfile(BENCH_PROFILE);
+    int counts[16];
+    int countCount = 0;
+    ReaderRun run;
+    WorkloadSpec spec;
+    int i, ok;
+
+    if (argc == 0) {
+        for (i = 0; i < (int)(sizeof(defaultScanners) / sizeof(defaultScanners[0])); i++) {
+            counts[countCount++] = defaultScanners[i];
+        }
+    }
+    for (i = 0; i < argc && countCount < (int)(sizeof(counts) / sizeof(counts[0])); i++) {
+        int scanners = atoi(argv[i]);
+        if (scanners < 0 || scanners > BENCH_READERS_MAX) {
+            fprintf(stderr, "scanners must be between 0 and %d: %s\n", BENCH_READERS_MAX, argv[i]);
+            return 0;
+        }
+        counts[countCount++] = scanners;
+    }
+
+    memset(&run, 0, sizeof(run));
+    pthread_mutex_init(&run.lock, NULL);
+    run.conn = OpenBenchDatabase(BENCH_DB_FILENAME, profile);
+    ok = run.conn != NULL;
+    Workload_Init(&spec, 1, BENCH_SEED);
+    spec.products = BENCH_PRODUCTS;
+    spec.sales = BENCH_READERS_SALES;
+    ok = ok && Workload_Generate(run.conn, &spec, NULL, NULL) == SQLITE_OK;
+    ok = ok && sqlite3_exec(run.conn, "UPDATE products SET quantity = 1000000000", NULL, NULL, NULL) == SQLITE_OK;
+
+    for (i = 0; ok && i < countCount; i++) {
+        for (run.shared = 1; ok && run.shared >= 0; run.shared--) {
+            ok = RunReaders(&run, profile, counts[i]);
+        }
+    }
+
+    sqlite3_close(run.conn);
+    pthread_mutex_destroy(&run.lock);
+    RemoveDatabase(BENCH_DB_FILENAME);
+    return ok;
+}
+
+/*
+ * CSV import: a supplier catalog streamed into products through one upsert, with the search
+ * index built once at the end or kept up by its trigger row by row
+ */
+
+#define BENCH_IMPORT_FILENAME "bench.csv"
+
+// Every tenth name is quoted and holds a comma, as spreadsheet exports write them
+static int WriteImportFile(const char* path, sqlite3_int64 rows) {
+    FILE* file = fopen(path, "wb");
+    sqlite3_int64 i;
+
+    if (!file) {
+        return 0;
+    }
+    fprintf(file, "name,quantity,price\r\n");
+    for (i = 0; i < rows; i++) {
+        unsigned long long mix = (unsigned long long)(i + 1) * 0x9E3779B97F4A7C15ULL;
+
+        if (i % 10 == 0) {
+            fprintf(file, "\"Supplier Cable, %lldm\",%u,%u.%02u\r\n", (long long)i,
+                    (unsigned)(mix >> 40) % 500, 1 + (unsigned)(mix >> 20) % 9999, (unsigned)(mix >> 8) % 100);
+        } else {
+            fprintf(file, "Supplier Item %lld,%u,%u.%02u\r\n", (long long)i,
+                    (unsigned)(mix >> 40) % 500, 1 + (unsigned)(mix >> 20) % 9999, (unsigned)(mix >> 8) % 100);
+        }
+    }
+    return fclose(file) == 0;
+}
+
+static int RunImport(sqlite3* conn, const char* labels, const char* op, int flags) {
+    ProductImportResult result;
+    double started = NowSeconds(), elapsed;
+    int rc = ProductImport_Run(conn, BENCH_IMPORT_FILENAME, flags, &result);
+
+    elapsed = NowSeconds() - started;
+    if (rc != SQLITE_OK || result.skipped) {
+        fprintf(stderr, "import failed: %s, %lld skipped\n", sqlite3_errmsg(conn), (long long)result.skipped);
+        return 0;
+    }
+    printf("{\"bench\":\"import\",%s,\"op\":\"%s\",\"rows\":%lld,\"added\":%lld,\"seconds\":%.2f,"
+           "\"rows_per_sec\":%.0f,\"mb_per_sec\":%.1f,\"peak_memory_kb\":%lld}\n",
+           labels, op, (long long)result.rows, (long long)result.added, elapsed,
+           result.rows / elapsed, result.bytes / elapsed / (1024 * 1024), (long long)(result.peakMemory / 1024));
+    return 1;
+}
+
+// Loads the file into a fresh catalog, then again so every line updates an existing product
+static int RunImportRows(sqlite3_int64 rows) {
+    int live, ok = WriteImportFile(BENCH_IMPORT_FILENAME, rows);
+
+    if (!ok) {
+        fprintf(stderr, "cannot write %s\n", BENCH_IMPORT_FILENAME);
+        return 0;
+    }
+    for (live = 0; ok && live <= 1; live++) {
+        sqlite3* conn = OpenBenchDatabase(BENCH_DB_FILENAME, FindPragmaProfile(BENCH_PROFILE));
+        char labels[128];
+        int searchIndex;
+
+        if (!conn) {
+            ok = 0;
+            break;
+        }
+        // Without FTS5 there is no index to defer, so one run covers it
+        searchIndex = sqlite3_exec(conn, SQL_CREATE_PRODUCTS_FTS SQL_CREATE_PRODUCTS_FTS_TRIGGERS,
+                                   NULL, NULL, NULL) == SQLITE_OK;
+        snprintf(labels, sizeof(labels), "\"profile\":\"%s\",\"search_index\":\"%s\"", BENCH_PROFILE,
+                 !searchIndex ? "none" : live ? "live" : "deferred");
+        ok = RunImport(conn, labels, "insert", live ? PRODUCT_IMPORT_LIVE_SEARCH_INDEX : 0) &&
+             RunImport(conn, labels, "upsert", live ? PRODUCT_IMPORT_LIVE_SEARCH_INDEX : 0);
+        sqlite3_close(conn);
+        RemoveDatabase(BENCH_DB_FILENAME);
+        if (!searchIndex) {
+            break;
+        }
+    }
+    remove(BENCH_IMPORT_FILENAME);
+    return ok;
+}
+
+// Rows per second and peak memory by file size; peak memory should stay flat
+static int BenchImport(int argc, char** argv) {
+    static const int defaultRows[] = { 10000, 100000, 500000 };
+    int i;
+
+    if (argc == 0) {
+        for (i = 0; i < (int)(sizeof(defaultRows) / sizeof(defaultRows[0])); i++) {
+            if (!RunImportRows(defaultRows[i])) {
+                return 0;
+            }
+        }
+        return 1;
+    }
+    for (i = 0; i < argc; i++) {
+        if (atoll(argv[i]) <= 0) {
+            fprintf(stderr, "row count must be a positive integer: %s\n", argv[i]);
+            return 0;
+        }
+        if (!RunImportRows(atoll(argv[i]))) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/*
+ * Columnar snapshot: size of a sales snapshot against the database it came from, and the
+ * sales totals read from the mapped snapshot against the same totals from SQLite. Both are
+ * warm: the database in SQLite's page cache, the snapshot in the OS's.
+ */
+
+#define BENCH_SNAPSHOT_FILENAME "bench.snap"
+#define BENCH_SOLD_PRODUCTS 16          // products the per-product cases cycle through
+
+typedef struct {
+    const char* op;
+    int months;         // as in TotalsCase
+    int perProduct;
+    int iterations;
+} SnapshotCase;
+
+static const SnapshotCase g_snapshotCases[] = {
+    { "month",         1,  0, 12 },
+    { "year",          12, 0, 3 },
+    { "product_month", 1,  1, 48 },
+    { "product_year",  12, 1, 16 }
+};
+
+#define SNAPSHOT_CASE_COUNT ((int)(sizeof(g_snapshotCases) / sizeof(g_snapshotCases[0])))
+
+// Unix seconds of a 'YYYY-MM-DD' day, converted as the snapshot converts sale_date
+static sqlite3_int64 DayToUnix(sqlite3* conn, const char* day) {
+    sqlite3_stmt* stmt;
+    sqlite3_int64 value = -1;
+
+    if (sqlite3_prepare_v2(conn, "SELECT CAST(strftime('%s', ?) AS INTEGER)", -1, &stmt, NULL) == SQLITE_OK) {
+        sqlite3_bind_text(stmt, 1, day, -1, SQLITE_STATIC);
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            value = sqlite3_column_int64(stmt, 0);
+        }
+    }
+    sqlite3_finalize(stmt);
+    return value;
+}
+
+// Products of sales spread evenly through the table, so popular products come up as often
+// as they sell
+static int PickSoldProducts(sqlite3* conn, sqlite3_int64 sales, sqlite3_int64* products) {
+    sqlite3_stmt* stmt;
+    int i, ok = sqlite3_prepare_v2(conn, "SELECT product_id FROM sales WHERE id = ?", -1, &stmt, NULL) == SQLITE_OK;
+
+    for (i = 0; ok && i < BENCH_SOLD_PRODUCTS; i++) {
+        sqlite3_bind_int64(stmt, 1, 1 + sales * i / BENCH_SOLD_PRODUCTS);
+        ok = sqlite3_step(stmt) == SQLITE_ROW;
+        products[i] = ok ? sqlite3_column_int64(stmt, 0) : 0;
+        sqlite3_reset(stmt);
+    }
+    sqlite3_finalize(stmt);
+    return ok;
+}
+
+static sqlite3_int64 DatabaseBytes(sqlite3* conn) {
+    return QueryInt64(conn, "PRAGMA page_count") * QueryInt64(conn, "PRAGMA page_size");
+}
+
+// Ranges and products of a case's iterations, in the forms SQLite and the snapshot take
+typedef struct {
+    char from[32];
+    char to[32];
+    sqlite3_int64 fromTime;
+    sqlite3_int64 toTime;
+    sqlite3_int64 product;
+    SalesSnapshotTotals expected;   // from SQLite
+} SnapshotQuery;
+
+// Each engine runs every iteration in turn, so the two logs time only their own queries
+static int RunSnapshotCase(sqlite3* conn, const SalesSnapshot* snapshot, const SnapshotCase* test,
+                           const char* labels, const sqlite3_int64* products) {
+    SnapshotQuery* queries = (SnapshotQuery*)calloc(test->iterations, sizeof(SnapshotQuery));
+    sqlite3_stmt* stmt = NULL;
+    LatencyLog log;
+    SalesSnapshotTotals totals;
+    sqlite3_int64 blocksScanned = 0;
+    char engineLabels[256];
+    int i, ok = queries != NULL;
+
+    memset(&log, 0, sizeof(log));
+    for (i = 0; ok && i < test->iterations; i++) {
+        TotalsRange(test->months, i, queries[i].from, queries[i].to);
+        queries[i].fromTime = DayToUnix(conn, queries[i].from);
+        queries[i].toTime = DayToUnix(conn, queries[i].to);
+        queries[i].product = test->perProduct ? products[i % BENCH_SOLD_PRODUCTS] : 0;
+    }
+
+    ok = ok && sqlite3_prepare_v2(conn, test->perProduct ? SQL_SALES_PRODUCT_TOTALS : SQL_SALES_TOTALS_SCAN,
+                                  -1, &stmt, NULL) == SQLITE_OK;
+    ok = ok && LatencyLog_Start(&log, test->iterations);
+    for (i = 0; ok && i < test->iterations; i++) {
+        double started = NowSeconds();
+
+        sqlite3_bind_text(stmt, 1, queries[i].from, -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 2, queries[i].to, -1, SQLITE_STATIC);
+        if (test->perProduct) {
+            sqlite3_bind_int64(stmt, 3, queries[i].product);
+        }
+        ok = sqlite3_step(stmt) == SQLITE_ROW;
+        queries[i].expected.transactions = sqlite3_column_int64(stmt, 0);
+        queries[i].expected.units = sqlite3_column_int64(stmt, 1);
+        queries[i].expected.revenue = sqlite3_column_int64(stmt, 2);
+        sqlite3_reset(stmt);
+        LatencyLog_Add(&log, started);
+    }
+    if (ok) {
+        snprintf(engineLabels, sizeof(engineLabels), "%s,\"engine\":\"sqlite\"", labels);
+        LatencyLog_Report(&log, "columnar", engineLabels, test->op);
+    } else {
+        fprintf(stderr, "%s failed: %s\n", test->op, sqlite3_errmsg(conn));
+    }
+    LatencyLog_Free(&log);
+
+    ok = ok && LatencyLog_Start(&log, test->iterations);
+    for (i = 0; ok && i < test->iterations; i++) {
+        double started = NowSeconds();
+
+        SalesSnapshot_Totals(snapshot, queries[i].fromTime, queries[i].toTime, queries[i].product, &totals);
+        LatencyLog_Add(&log, started);
+        blocksScanned += totals.blocksScanned;
+
+        if (totals.transactions != queries[i].expected.transactions || totals.units != queries[i].expected.units ||
+            totals.revenue != queries[i].expected.revenue) {
+            fprintf(stderr, "%s %s..%s product %lld: snapshot has %lld sales, %lld units, %lld ngwee; "
+                    "SQLite has %lld, %lld, %lld\n", test->op, queries[i].from, queries[i].to,
+                    (long long)queries[i].product, (long long)totals.transactions, (long long)totals.units,
+                    (long long)totals.revenue, (long long)queries[i].expected.transactions,
+                    (long long)queries[i].expected.units, (long long)queries[i].expected.revenue);
+            ok = 0;
+        }
+    }
+    if (ok) {
+        snprintf(engineLabels, sizeof(engineLabels), "%s,\"engine\":\"snapshot\",\"blocks_scanned\":%.1f",
+                 labels, (double)blocksScanned / test->iterations);
+        LatencyLog_Report(&log, "columnar", engineLabels, test->op);
+    }
+    LatencyLog_Free(&log);
+
+    sqlite3_finalize(stmt);
+    free(queries);
+    return ok;
+}
+
+static int RunSnapshotScale(int scale) {
+    WorkloadSpec spec;
+    SalesSnapshotResult written;
+    SalesSnapshot snapshot;
+    sqlite3_int64 products[BENCH_SOLD_PRODUCTS];
+    sqlite3* conn;
+    char labels[160];
+    double started, elapsed;
+    int c, ok;
+
+    memset(&snapshot, 0, sizeof(snapshot));
+    Workload_Init(&spec, scale, BENCH_SEED);
+    spec.products = WORKLOAD_PRODUCTS_PER_SCALE;
+
+    conn = OpenBenchDatabase(BENCH_DB_FILENAME, FindPragmaProfile("bulk"));
+    ok = conn != NULL;
+    ok = ok && Workload_Generate(conn, &spec, NULL, NULL) == SQLITE_OK;
+    ok = ok && sqlite3_wal_checkpoint_v2(conn, NULL, SQLITE_CHECKPOINT_TRUNCATE, NULL, NULL) == SQLITE_OK;
+    ok = ok && ApplyPragmaProfile(conn, FindPragmaProfile(BENCH_PROFILE)) == SQLITE_OK;
+    ok = ok && PickSoldProducts(conn, spec.sales, products);
+    if (!ok) {
+        fprintf(stderr, "cannot build scale %d database: %s\n", scale, conn ? sqlite3_errmsg(conn) : "open");
+        sqlite3_close(conn);
+        RemoveDatabase(BENCH_DB_FILENAME);
+        return 0;
+    }
+    snprintf(labels, sizeof(labels), "\"profile\":\"%s\",\"products\":%lld,\"sales\":%lld",
+             BENCH_PROFILE, (long long)spec.products, (long long)spec.sales);
+
+    started = NowSeconds();
+    ok = SalesSnapshot_Write(conn, BENCH_SNAPSHOT_FILENAME, &written) == SQLITE_OK;
+    elapsed = NowSeconds() - started;
+    if (ok) {
+        sqlite3_int64 databaseBytes = DatabaseBytes(conn);
+
+        printf("{\"bench\":\"columnar\",%s,\"op\":\"write\",\"seconds\":%.2f,\"rows_per_sec\":%.0f,"
+               "\"blocks\":%lld,\"database_bytes\":%lld,\"snapshot_bytes\":%lld,"
+               "\"database_bytes_per_sale\":%.1f,\"snapshot_bytes_per_sale\":%.2f}\n",
+               labels, elapsed, written.rows / elapsed, (long long)written.blocks,
+               (long long)databaseBytes, (long long)written.bytes,
+               (double)databaseBytes / written.rows, (double)written.bytes / written.rows);
+    } else {
+        fprintf(stderr, "cannot write %s: %s\n", BENCH_SNAPSHOT_FILENAME, sqlite3_errmsg(conn));
+    }
+
+    if (ok && !SalesSnapshot_Open(&snapshot, BENCH_SNAPSHOT_FILENAME)) {
+        fprintf(stderr, "cannot map %s\n", BENCH_SNAPSHOT_FILENAME);
+        ok = 0;
+    }
+    for (c = 0; ok && c < SNAPSHOT_CASE_COUNT; c++) {
+        ok = RunSnapshotCase(conn, &snapshot, &g_snapshotCases[c], labels, products);
+    }
+    if (snapshot.data) {
+        SalesSnapshot_Close(&snapshot);
+    }
+
+    sqlite3_close(conn);
+    RemoveDatabase(BENCH_DB_FILENAME);
+    remove(BENCH_SNAPSHOT_FILENAME);
+    return ok;
+}
+
+// Scale multiplies the sales only, as for rollup
+static int BenchColumnar(int argc, char** argv) {
+    static const int defaultScales[] = { 1, 4 };
+    int i;
+
+    if (argc == 0) {
+        for (i = 0; i < (int)(sizeof(defaultScales) / sizeof(defaultScales[0])); i++) {
+            if (!RunSnapshotScale(defaultScales[i])) {
+                return 0;
+            }
+        }
+        return 1;
+    }
+    for (i = 0; i < argc; i++) {
+        if (atoi(argv[i]) <= 0) {
+            fprintf(stderr, "scale must be a positive integer: %s\n", argv[i]);
+            return 0;
+        }
+        if (!RunSnapshotScale(atoi(argv[i]))) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/*
+ * Sales mirror: year totals and units by product from the in-memory columns against the
+ * same SQL, with the catalog fixed and sales growing. rows_per_sec counts every sale of the
+ * year examined, whichever engine answers.
+ */
+
+typedef struct {
+    const char* op;
+    int perProduct;     // totals of one product, cycling through BENCH_SOLD_PRODUCTS
+    int byProduct;      // SQL_SALES_BY_PRODUCT instead of totals
+    int iterations;
+} MirrorCase;
+
+static const MirrorCase g_mirrorCases[] = {
+    { "year_totals",  0, 0, 5 },
+    { "product_year", 1, 0, 16 },
+    { "by_product",   0, 1, 3 }
+};
+
+#define MIRROR_CASE_COUNT ((int)(sizeof(g_mirrorCases) / sizeof(g_mirrorCases[0])))
+
+static void ReportMirrorCase(LatencyLog* log, const char* labels, const char* engine, const char* op,
+                             sqlite3_int64 rows, double seconds) {
+    char engineLabels[256];
+
+    snprintf(engineLabels, sizeof(engineLabels), "%s,\"engine\":\"%s\",\"rows_per_sec\":%.0f",
+             labels, engine, seconds > 0 ? rows / seconds : 0.0);
+    LatencyLog_Report(log, "mirror", engineLabels, op);
+}
+
+// Whether the SQL_SALES_BY_PRODUCT rows stepped from stmt are exactly the products in byProduct
+static int SameByProduct(sqlite3_stmt* stmt, const SalesMirrorTotals* byProduct, int32_t maxProductId) {
+    sqlite3_int64 rows = 0, products = 0;
+    int32_t id;
+    int ok = 1;
+
+    while (ok && sqlite3_step(stmt) == SQLITE_ROW) {
+        sqlite3_int64 productId = sqlite3_column_int64(stmt, 0);
+
+        ok = productId >= 0 && productId <= maxProductId &&
+             byProduct[productId].transactions == sqlite3_column_int64(stmt, 1) &&
+             byProduct[productId].units == sqlite3_column_int64(stmt, 2) &&
+             byProduct[productId].revenue == sqlite3_column_int64(stmt, 3);
+        rows++;
+    }
+    sqlite3_reset(stmt);
+    for (id = 0; id <= maxProductId; id++) {
+        products += byProduct[id].transactions > 0;
+    }
+    return ok && rows == products;
+}
+
+static int RunMirrorCase(sqlite3* conn, const SalesMirror* mirror, const MirrorCase* test,
+                         const char* labels, const sqlite3_int64* products, sqlite3_int64 sales) {
+    SalesMirrorTotals* byProduct = (SalesMirrorTotals*)calloc((size_t)mirror->maxProductId + 1, sizeof(SalesMirrorTotals));
+    SalesMirrorTotals expected[BENCH_SOLD_PRODUCTS];
+    SalesMirrorTotals totals;
+    sqlite3_stmt* stmt = NULL;
+    LatencyLog log;
+    char from[32], to[32];
+    uint32_t fromTime, toTime;
+    double started;
+    int i, ok = byProduct != NULL;
+
+    memset(&log, 0, sizeof(log));
+    TotalsRange(12, 0, from, to);
+    fromTime = (uint32_t)DayToUnix(conn, from);
+    toTime = (uint32_t)DayToUnix(conn, to);
+
+    ok = ok && sqlite3_prepare_v2(conn, test->byProduct ? SQL_SALES_BY_PRODUCT : test->perProduct
+                                  ? SQL_SALES_PRODUCT_TOTALS : SQL_SALES_TOTALS_SCAN, -1, &stmt, NULL) == SQLITE_OK;
+    ok = ok && LatencyLog_Start(&log, test->iterations);
+    started = NowSeconds();
+    for (i = 0; ok && i < test->iterations; i++) {
+        double queryStarted = NowSeconds();
+
+        sqlite3_bind_text(stmt, 1, from, -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 2, to, -1, SQLITE_STATIC);
+        if (test->perProduct) {
+            sqlite3_bind_int64(stmt, 3, products[i % BENCH_SOLD_PRODUCTS]);
+        }
+        if (test->byProduct) {
+            ok = StepAll(stmt);
+        } else {
+            SalesMirrorTotals* row = &expected[i % BENCH_SOLD_PRODUCTS];
+
+            ok = sqlite3_step(stmt) == SQLITE_ROW;
+            row->transactions = sqlite3_column_int64(stmt, 0);
+            row->units = sqlite3_column_int64(stmt, 1);
+            row->revenue = sqlite3_column_int64(stmt, 2);
+            sqlite3_reset(stmt);
+        }
+        LatencyLog_Add(&log, queryStarted);
+    }
+    if (ok) {
+        ReportMirrorCase(&log, labels, "sqlite", test->op, sales * test->iterations, NowSeconds() - started);
+    } else {
+        fprintf(stderr, "%s failed: %s\n", test->op, sqlite3_errmsg(conn));
+    }
+    LatencyLog_Free(&log);
+
+    ok = ok && LatencyLog_Start(&log, test->iterations);
+    started = NowSeconds();
+    for (i = 0; ok && i < test->iterations; i++) {
+        double queryStarted = NowSeconds();
+
+        if (test->byProduct) {
+            memset(byProduct, 0, ((size_t)mirror->maxProductId + 1) * sizeof(SalesMirrorTotals));
+            SalesMirror_ByProduct(mirror, fromTime, toTime, byProduct);
+        } else {
+            SalesMirror_Totals(mirror, fromTime, toTime,
+                               test->perProduct ? (int32_t)products[i % BENCH_SOLD_PRODUCTS] : 0, &totals);
+        }
+        LatencyLog_Add(&log, queryStarted);
+
+        if (!test->byProduct && i < BENCH_SOLD_PRODUCTS &&
+            memcmp(&totals, &expected[i], sizeof(totals)) != 0) {
+            fprintf(stderr, "%s: mirror has %lld sales, %lld units, %lld ngwee; SQLite has %lld, %lld, %lld\n",
+                    test->op, (long long)totals.transactions, (long long)totals.units, (long long)totals.revenue,
+                    (long long)expected[i].transactions, (long long)expected[i].units,
+                    (long long)expected[i].revenue);
+            ok = 0;
+        }
+    }
+    if (ok) {
+        ReportMirrorCase(&log, labels, "mirror", test->op, mirror->count * test->iterations, NowSeconds() - started);
+    }
+    LatencyLog_Free(&log);
+
+    if (ok && test->byProduct) {
+        sqlite3_bind_text(stmt, 1, from, -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 2, to, -1, SQLITE_STATIC);
+        if (!SameByProduct(stmt, byProduct, mirror->maxProductId)) {
+            fprintf(stderr, "%s: mirror and SQLite disagree\n", test->op);
+            ok = 0;
+        }
+    }
+
+    sqlite3_finalize(stmt);
+    free(byProduct);
+    return ok;
+}
+
+static int RunMirrorScale(int scale) {
+    WorkloadSpec spec;
+    SalesMirror mirror;
+    sqlite3_int64 products[BENCH_SOLD_PRODUCTS];
+    sqlite3_stmt* afterId = NULL;
+    sqlite3* conn;
+    char labels[160];
+    double started, elapsed;
+    int c, ok;
+
+    memset(&mirror, 0, sizeof(mirror));
+    Workload_Init(&spec, scale, BENCH_SEED);
+    spec.products = WORKLOAD_PRODUCTS_PER_SCALE;
+
+    conn = OpenBenchDatabase(BENCH_DB_FILENAME, FindPragmaProfile("bulk"));
+    ok = conn != NULL;
+    ok = ok && Workload_Generate(conn, &spec, NULL, NULL) == SQLITE_OK;
+    ok = ok && ApplyPragmaProfile(conn, FindPragmaProfile(BENCH_PROFILE)) == SQLITE_OK;
+    ok = ok && PickSoldProducts(conn, spec.sales, products);
+    if (!ok) {
+        fprintf(stderr, "cannot build scale %d database: %s\n", scale, conn ? sqlite3_errmsg(conn) : "open");
+        sqlite3_close(conn);
+        RemoveDatabase(BENCH_DB_FILENAME);
+        return 0;
+    }
+    snprintf(labels, sizeof(labels), "\"profile\":\"%s\",\"products\":%lld,\"sales\":%lld",
+             BENCH_PROFILE, (long long)spec.products, (long long)spec.sales);
+
+    // The app's startup load: one catch-up from an empty mirror
+    started = NowSeconds();
+    ok = sqlite3_prepare_v2(conn, SQL_SALES_MIRROR_AFTER_ID, -1, &afterId, NULL) == SQLITE_OK &&
+         SalesMirror_CatchUp(&mirror, afterId) == SQLITE_OK;
+    elapsed = NowSeconds() - started;
+    if (ok) {
+        printf("{\"bench\":\"mirror\",%s,\"op\":\"load\",\"seconds\":%.2f,\"rows_per_sec\":%.0f,\"bytes\":%lld}\n",
+               labels, elapsed, mirror.count / elapsed, (long long)(mirror.count * SALES_MIRROR_BYTES_PER_SALE));
+    } else {
+        fprintf(stderr, "cannot load the mirror: %s\n", sqlite3_errmsg(conn));
+    }
+    sqlite3_finalize(afterId);
+
+    for (c = 0; ok && c < MIRROR_CASE_COUNT; c++) {
+        ok = RunMirrorCase(conn, &mirror, &g_mirrorCases[c], labels, products, spec.sales);
+    }
+
+    SalesMirror_Free(&mirror);
+    sqlite3_close(conn);
+    RemoveDatabase(BENCH_DB_FILENAME);
+    return ok;
+}
+
+// Scale multiplies the sales only, as for rollup
+static int BenchMirror(int argc, char** argv) {
+    static const int defaultScales[] = { 1, 4 };
+    int i;
+
+    if (argc == 0) {
+        for (i = 0; i < (int)(sizeof(defaultScales) / sizeof(defaultScales[0])); i++) {
+            if (!RunMirrorScale(defaultScales[i])) {
+                return 0;
+            }
+        }
+        return 1;
+    }
+    for (i = 0; i < argc; i++) {
+        if (atoi(argv[i]) <= 0) {
+            fprintf(stderr, "scale must be a positive integer: %s\n", argv[i]);
+            return 0;
+        }
+        if (!RunMirrorScale(atoi(argv[i]))) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/*
+ * Parallel reports: a year of revenue per product per day, and the top products, from one
+ * statement on one connection against the same statement cut into id ranges over 1 to N
+ * threads. The ranges run on read-only connections, so the database is in WAL mode.
+ */
+
+#define BENCH_PARALLEL_SCALE 1
+#define BENCH_PARALLEL_TOP 20
+
+typedef struct {
+    const char* op;
+    const char* sql;
+    int top;            // SalesReport_TopProducts instead of SalesReport_ProductDays
+    int iterations;
+} ParallelCase;
+
+static const ParallelCase g_parallelCases[] = {
+    { "product_days", SQL_SALES_RANGE_PRODUCT_DAYS, 0, 3 },
+    { "top_products", SQL_SALES_RANGE_PRODUCTS,     1, 3 }
+};
+
+#define PARALLEL_CASE_COUNT ((int)(sizeof(g_parallelCases) / sizeof(g_parallelCases[0])))
+
+static int CompareReportRows(const void* a, const void* b) {
+    const SalesReportRow* left = (const SalesReportRow*)a;
+    const SalesReportRow* right = (const SalesReportRow*)b;
+
+    if (left->productId != right->productId) {
+        return left->productId < right->productId ? -1 : 1;
+    }
+    return strcmp(left->day, right->day);
+}
+
+// The whole id range through one statement, rows sorted by product then day
+static int ReadSerialReport(sqlite3_stmt* stmt, const char* from, const char* to, SalesReport* report) {
+    sqlite3_int64 capacity = 0;
+    int rc;
+
+    SalesReport_Free(report);
+    sqlite3_bind_int64(stmt, 1, 0);
+    sqlite3_bind_int64(stmt, 2, INT64_MAX);
+    sqlite3_bind_text(stmt, 3, from, -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 4, to, -1, SQLITE_STATIC);
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        SalesReportRow* row;
+
+        if (report->count == capacity) {
+            SalesReportRow* rows;
+
+            capacity = capacity ? capacity * 2 : 4096;
+            rows = (SalesReportRow*)realloc(report->rows, (size_t)capacity * sizeof(SalesReportRow));
+            if (!rows) {
+                rc = SQLITE_NOMEM;
+                break;
+            }
+            report->rows = rows;
+        }
+        row = &report->rows[report->count++];
+        memset(row, 0, sizeof(*row));
+        row->productId = sqlite3_column_int64(stmt, 0);
+        snprintf(row->day, sizeof(row->day), "%s", (const char*)sqlite3_column_text(stmt, 1));
+        row->transactions = sqlite3_column_int64(stmt, 2);
+        row->units = sqlite3_column_int64(stmt, 3);
+        row->revenue = sqlite3_column_int64(stmt, 4);
+    }
+    sqlite3_reset(stmt);
+    qsort(report->rows, (size_t)report->count, sizeof(SalesReportRow), CompareReportRows);
+    return rc == SQLITE_DONE;
+}
+
+// Whether every row of the parallel report is the serial one, and none is missing: all of
+// them for product days, or the top products, with nothing outside them earning more
+static int SameReport(const SalesReport* serial, const SalesReport* parallel, int top) {
+    sqlite3_int64 i;
+
+    if (parallel->count != (top && serial->count > BENCH_PARALLEL_TOP ? BENCH_PARALLEL_TOP : serial->count)) {
+        return 0;
+    }
+    for (i = 0; i < parallel->count; i++) {
+        const SalesReportRow* row = &parallel->rows[i];
+        const SalesReportRow* expected = (const SalesReportRow*)bsearch(row, serial->rows, (size_t)serial->count,
+                                                                        sizeof(SalesReportRow), CompareReportRows);
+
+        if (!expected || expected->transactions != row->transactions || expected->units != row->units ||
+            expected->revenue != row->revenue) {
+            return 0;
+        }
+    }
+    for (i = 0; top && parallel->count > 0 && i < serial->count; i++) {
+        const SalesReportRow* last = &parallel->rows[parallel->count - 1];
+
+        if (serial->rows[i].revenue > last->revenue &&
+            !bsearch(&serial->rows[i], parallel->rows, (size_t)parallel->count, sizeof(SalesReportRow), CompareReportRows)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int RunParallelCase(sqlite3* conn, const ParallelCase* test, const char* labels,
+                           const int* threadCounts, int threadCountCount) {
+    const PragmaProfile* profile = FindPragmaProfile(BENCH_PROFILE);
+    SalesReport serial, parallel, sorted;
+    sqlite3_stmt* stmt = NULL;
+    LatencyLog log;
+    char from[32], to[32], runLabels[320];
+    double started, serialSeconds = 0;
+    int i, t, rc = SQLITE_OK, ok;
+
+    memset(&serial, 0, sizeof(serial));
+    memset(&parallel, 0, sizeof(parallel));
+    memset(&sorted, 0, sizeof(sorted));
+    memset(&log, 0, sizeof(log));
+    TotalsRange(12, 0, from, to);
+
+    ok = sqlite3_prepare_v2(conn, test->sql, -1, &stmt, NULL) == SQLITE_OK;
+    ok = ok && LatencyLog_Start(&log, test->iterations);
+    started = NowSeconds();
+    for (i = 0; ok && i < test->iterations; i++) {
+        double queryStarted = NowSeconds();
+
+        ok = ReadSerialReport(stmt, from, to, &serial);
+        LatencyLog_Add(&log, queryStarted);
+    }
+    if (ok) {
+        serialSeconds = (NowSeconds() - started) / test->iterations;
+        snprintf(runLabels, sizeof(runLabels), "%s,\"engine\":\"sqlite\",\"threads\":1,\"rows\":%lld",
+                 labels, (long long)serial.count);
+        LatencyLog_Report(&log, "parallel", runLabels, test->op);
+    } else {
+        fprintf(stderr, "%s failed: %s\n", test->op, sqlite3_errmsg(conn));
+    }
+    LatencyLog_Free(&log);
+    sqlite3_finalize(stmt);
+
+    for (t = 0; ok && t < threadCountCount; t++) {
+        double seconds;
+
+        ok = LatencyLog_Start(&log, test->iterations);
+        started = NowSeconds();
+        for (i = 0; ok && i < test->iterations; i++) {
+            double queryStarted = NowSeconds();
+
+            SalesReport_Free(&parallel);
+            rc = test->top ? SalesReport_TopProducts(BENCH_DB_FILENAME, profile, threadCounts[t], from, to,
+                                                     BENCH_PARALLEL_TOP, &parallel)
+                           : SalesReport_ProductDays(BENCH_DB_FILENAME, profile, threadCounts[t], from, to, &parallel);
+            ok = rc == SQLITE_OK;
+            LatencyLog_Add(&log, queryStarted);
+        }
+        seconds = (NowSeconds() - started) / test->iterations;
+        if (!ok) {
+            fprintf(stderr, "%s on %d threads failed: %s\n", test->op, threadCounts[t], sqlite3_errstr(rc));
+            LatencyLog_Free(&log);
+            break;
+        }
+
+        snprintf(runLabels, sizeof(runLabels),
+                 "%s,\"engine\":\"parallel\",\"threads\":%d,\"ranges\":%d,\"stolen\":%d,\"rows\":%lld,\"speedup\":%.2f",
+                 labels, parallel.threads, parallel.ranges, parallel.stolen, (long long)parallel.count,
+                 seconds > 0 ? serialSeconds / seconds : 0.0);
+        LatencyLog_Report(&log, "parallel", runLabels, test->op);
+        LatencyLog_Free(&log);
+
+        // Top products are checked in their own order; bsearch needs them by product
+        sorted.rows = (SalesReportRow*)malloc((size_t)(parallel.count ? parallel.count : 1) * sizeof(SalesReportRow));
+        ok = sorted.rows != NULL;
+        if (ok) {
+            memcpy(sorted.rows, parallel.rows, (size_t)parallel.count * sizeof(SalesReportRow));
+            sorted.count = parallel.count;
+            qsort(sorted.rows, (size_t)sorted.count, sizeof(SalesReportRow), CompareReportRows);
+            ok = SameReport(&serial, &sorted, test->top);
+            if (!ok) {
+                fprintf(stderr, "%s on %d threads disagrees with one statement\n", test->op, threadCounts[t]);
+            }
+        }
+        SalesReport_Free(&sorted);
+    }
+
+    SalesReport_Free(&serial);
+    SalesReport_Free(&parallel);
+    return ok;
+}
+
+// Thread counts are the arguments, 1 to SALES_REPORT_MAX_THREADS
+static int BenchParallel(int argc, char** argv) {
+    static const int defaultThreads[] = { 1, 2, 4, 8, 16 };
+    int counts[16];
+    int countCount = 0;
+    WorkloadSpec spec;
+    sqlite3* conn;
+    char labels[160];
+    int i, ok;
+
+    if (argc == 0) {
+        for (i = 0; i < (int)(sizeof(defaultThreads) / sizeof(defaultThreads[0])); i++) {
+            counts[countCount++] = defaultThreads[i];
+        }
+    }
+    for (i = 0; i < argc && countCount < (int)(sizeof(counts) / sizeof(counts[0])); i++) {
+        int threads = atoi(argv[i]);
+        if (threads < 1 || threads > SALES_REPORT_MAX_THREADS) {
+            fprintf(stderr, "threads must be between 1 and %d: %s\n", SALES_REPORT_MAX_THREADS, argv[i]);
+            return 0;
+        }
+        counts[countCount++] = threads;
+    }
+
+    Workload_Init(&spec, BENCH_PARALLEL_SCALE, BENCH_SEED);
+    spec.products = WORKLOAD_PRODUCTS_PER_SCALE;
+    conn = OpenBenchDatabase(BENCH_DB_FILENAME, FindPragmaProfile("bulk"));
+    ok = conn != NULL;
+    ok = ok && Workload_Generate(conn, &spec, NULL, NULL) == SQLITE_OK;
+    ok = ok && ApplyPragmaProfile(conn, FindPragmaProfile(BENCH_PROFILE)) == SQLITE_OK;
+    if (!ok) {
+        fprintf(stderr, "cannot build the database: %s\n", conn ? sqlite3_errmsg(conn) : "open");
+    }
+    snprintf(labels, sizeof(labels), "\"profile\":\"%s\",\"products\":%lld,\"sales\":%lld",
+             BENCH_PROFILE, (long long)spec.products, (long long)spec.sales);
+
+    for (i = 0; ok && i < PARALLEL_CASE_COUNT; i++) {
+        ok = RunParallelCase(conn, &g_parallelCases[i], labels, counts, countCount);
+    }
+
+    sqlite3_close(conn);
+    RemoveDatabase(BENCH_DB_FILENAME);
+    return ok;
+}
+
+/*
+ * Product row cache: what filling the product list costs, and what it holds per product.
+ * A fill is the id scan ProductCache_Reset runs at startup and after each search; a page
+ * load is the seek behind a screen of rows the list has not shown yet.
+ */
+
+#define BENCH_CACHE_FILLS 20
+#define BENCH_CACHE_PAGE_LOADS 200
+
+static int RunCacheScale(sqlite3_int64 products) {
+    static ProductRowCache cache;
+    WorkloadSpec spec;
+    LatencyLog log;
+    sqlite3* conn;
+    char labels[160];
+    int i, ok;
+
+    Workload_Init(&spec, 1, BENCH_SEED);
+    spec.products = products;
+    spec.sales = 0;
+
+    conn = OpenBenchDatabase(BENCH_DB_FILENAME, FindPragmaProfile("bulk"));
+    ok = conn != NULL;
+    ok = ok && Workload_Generate(conn, &spec, NULL, NULL) == SQLITE_OK;
+    ok = ok && ApplyPragmaProfile(conn, FindPragmaProfile(BENCH_PROFILE)) == SQLITE_OK;
+    if (!ok) {
+        fprintf(stderr, "cannot build a %lld product database: %s\n", (long long)products,
+                conn ? sqlite3_errmsg(conn) : "open");
+        sqlite3_close(conn);
+        RemoveDatabase(BENCH_DB_FILENAME);
+        return 0;
+    }
+    ProductCache_Init(&cache, conn, 0);
+
+    ok = LatencyLog_Start(&log, BENCH_CACHE_FILLS);
+    for (i = 0; ok && i < BENCH_CACHE_FILLS; i++) {
+        double started = NowSeconds();
+        ok = ProductCache_Reset(&cache, NULL, NULL) && cache.totalRows == products;
+        LatencyLog_Add(&log, started);
+    }
+    if (ok) {
+        size_t tableBytes = ProductCache_Bytes(&cache) - sizeof(cache);
+
+        snprintf(labels, sizeof(labels),
+                 "\"profile\":\"%s\",\"products\":%lld,\"table_bytes_per_row\":%.3f,\"cache_bytes\":%lld",
+                 BENCH_PROFILE, (long long)products, (double)tableBytes / products,
+                 (long long)ProductCache_Bytes(&cache));
+        LatencyLog_Report(&log, "cache", labels, "fill");
+    }
+    LatencyLog_Free(&log);
+
+    // Pages spread over the whole list, so every one misses the slots
+    ok = ok && LatencyLog_Start(&log, BENCH_CACHE_PAGE_LOADS);
+    for (i = 0; ok && i < BENCH_CACHE_PAGE_LOADS; i++) {
+        int index = (int)((sqlite3_int64)i * 7919 * PRODUCT_PAGE_SIZE % products);
+        double started = NowSeconds();
+        ok = ProductCache_GetRow(&cache, index) != NULL;
+        LatencyLog_Add(&log, started);
+    }
+    if (ok) {
+        LatencyLog_Report(&log, "cache", labels, "page_load");
+    } else {
+        fprintf(stderr, "product cache at %lld products failed: %s\n", (long long)products, sqlite3_errmsg(conn));
+    }
+    LatencyLog_Free(&log);
+
+    ProductCache_Free(&cache);
+    sqlite3_close(conn);
+    RemoveDatabase(BENCH_DB_FILENAME);
+    return ok;
+}
+
+// Catalog sizes in products, 10k to 1M by default
+static int BenchCache(int argc, char** argv) {
+    static const sqlite3_int64 defaultProducts[] = { 10000, 100000, 1000000 };
+    int i;
+
+    if (argc == 0) {
+        for (i = 0; i < (int)(sizeof(defaultProducts) / sizeof(defaultProducts[0])); i++) {
+            if (!RunCacheScale(defaultProducts[i])) {
+                return 0;
+            }
+        }
+        return 1;
+    }
+    for (i = 0; i < argc; i++) {
+        if (atoll(argv[i]) <= 0 || atoll(argv[i]) > 100000000) {
+            fprintf(stderr, "products must be between 1 and 100000000: %s\n", argv[i]);
+            return 0;
+        }
+        if (!RunCacheScale(atoll(argv[i]))) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/*
+ * Sales Report first page: what opening the report costs, the newest page by keyset and then
+ * the page the prefetch reads after it, against reading every sale as LoadSales did before
+ * paging. Scale is millions of sales over the usual 10,000 products.
+ */
+
+#define BENCH_FIRST_PAGE_ITERATIONS 200
+#define BENCH_FULL_READS 3
+// LoadSales before paging: every sale, newest first
+#define BENCH_SQL_SALES_ALL \
+    "SELECT id, product_name, quantity_sold, total_cents, sale_date FROM sales ORDER BY id DESC"
+
+// Reads a page the way the list copies it, every column of every row; returns the rows read
+// and leaves the oldest id in lastId for the next page
+static sqlite3_int64 ReadSalesRows(sqlite3_stmt* stmt, sqlite3_int64* lastId) {
+    sqlite3_int64 rows = 0;
+    int rc;
+
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        *lastId = sqlite3_column_int64(stmt, 0);
+        sqlite3_column_text(stmt, 1);
+        sqlite3_column_int(stmt, 2);
+        sqlite3_column_int64(stmt, 3);
+        sqlite3_column_text(stmt, 4);
+        rows++;
+    }
+    sqlite3_reset(stmt);
+    return rc == SQLITE_DONE ? rows : -1;
+}
+
+static int RunFirstPageScale(int millions) {
+    sqlite3_stmt *first = NULL, *before = NULL, *all = NULL;
+    WorkloadSpec spec;
+    LatencyLog firstLog, prefetchLog, fullLog;
+    sqlite3* conn;
+    char labels[128];
+    int i, ok;
+
+    Workload_Init(&spec, millions, BENCH_SEED);
+    spec.products = WORKLOAD_PRODUCTS_PER_SCALE;
+
+    conn = OpenBenchDatabase(BENCH_DB_FILENAME, FindPragmaProfile("bulk"));
+    ok = conn != NULL;
+    ok = ok && Workload_Generate(conn, &spec, NULL, NULL) == SQLITE_OK;
+    ok = ok && ApplyPragmaProfile(conn, FindPragmaProfile(BENCH_PROFILE)) == SQLITE_OK;
+    ok = ok && sqlite3_prepare_v2(conn, SQL_SALES_PAGE_FIRST, -1, &first, NULL) == SQLITE_OK;
+    ok = ok && sqlite3_prepare_v2(conn, SQL_SALES_PAGE_BEFORE, -1, &before, NULL) == SQLITE_OK;
+    ok = ok && sqlite3_prepare_v2(conn, BENCH_SQL_SALES_ALL, -1, &all, NULL) == SQLITE_OK;
+    if (!ok) {
+        fprintf(stderr, "cannot build a %dM sale database: %s\n", millions, conn ? sqlite3_errmsg(conn) : "open");
+        sqlite3_finalize(first);
+        sqlite3_finalize(before);
+        sqlite3_finalize(all);
+        sqlite3_close(conn);
+        RemoveDatabase(BENCH_DB_FILENAME);
+        return 0;
+    }
+    snprintf(labels, sizeof(labels), "\"profile\":\"%s\",\"products\":%lld,\"sales\":%lld",
+             BENCH_PROFILE, (long long)spec.products, (long long)spec.sales);
+
+    // The report opening: the first page, then, timed on its own and together, the prefetch
+    ok = LatencyLog_Start(&firstLog, BENCH_FIRST_PAGE_ITERATIONS) &&
+         LatencyLog_Start(&prefetchLog, BENCH_FIRST_PAGE_ITERATIONS);
+    for (i = 0; ok && i < BENCH_FIRST_PAGE_ITERATIONS; i++) {
+        sqlite3_int64 lastId = 0;
+        double started = NowSeconds();
+
+        sqlite3_bind_int(first, 1, BENCH_SALES_PAGE);
+        ok = ReadSalesRows(first, &lastId) == BENCH_SALES_PAGE;
+        LatencyLog_Add(&firstLog, started);
+
+        sqlite3_bind_int64(before, 1, lastId);
+        sqlite3_bind_int(before, 2, BENCH_SALES_PAGE);
+        ok = ok && ReadSalesRows(before, &lastId) == BENCH_SALES_PAGE;
+        LatencyLog_Add(&prefetchLog, started);
+    }
+    if (ok) {
+        LatencyLog_Report(&firstLog, "firstpage", labels, "first_page");
+        LatencyLog_Report(&prefetchLog, "firstpage", labels, "first_page_prefetch");
+    }
+    LatencyLog_Free(&firstLog);
+    LatencyLog_Free(&prefetchLog);
+
+    ok = ok && LatencyLog_Start(&fullLog, BENCH_FULL_READS);
+    for (i = 0; ok && i < BENCH_FULL_READS; i++) {
+        sqlite3_int64 lastId = 0;
+        double started = NowSeconds();
+
+        ok = ReadSalesRows(all, &lastId) == spec.sales;
+        LatencyLog_Add(&fullLog, started);
+    }
+    if (ok) {
+        LatencyLog_Report(&fullLog, "firstpage", labels, "full_read");
+    } else {
+        fprintf(stderr, "first page at %dM sales failed: %s\n", millions, sqlite3_errmsg(conn));
+    }
+    LatencyLog_Free(&fullLog);
+
+    sqlite3_finalize(first);
+    sqlite3_finalize(before);
+    sqlite3_finalize(all);
+    sqlite3_close(conn);
+    RemoveDatabase(BENCH_DB_FILENAME);
+    return ok;
+}
+
+// Millions of sales, 1 and 50 by default; 50M sales take about 7 GB of disk
+static int BenchFirstPage(int argc, char** argv) {
+    static const int defaultMillions[] = { 1, 50 };
+    int i;
+
+    if (argc == 0) {
+        for (i = 0; i < (int)(sizeof(defaultMillions) / sizeof(defaultMillions[0])); i++) {
+            if (!RunFirstPageScale(defaultMillions[i])) {
+                return 0;
+            }
+        }
+        return 1;
+    }
+    for (i = 0; i < argc; i++) {
+        if (atoi(argv[i]) <= 0) {
+            fprintf(stderr, "millions of sales must be a positive integer: %s\n", argv[i]);
+            return 0;
+        }
+        if (!RunFirstPageScale(atoi(argv[i]))) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/*
+ * Statement cache: purchase latency with every statement prepared and finalized per purchase,
+ * as main.c ran them before the cache, and borrowed from a StatementCache as the worker does
+ */
+
+// One purchase in either mode, counting prepares in the cache's counters; the transaction
+// itself is RunPurchaseTransaction both ways
+static int PreparedPurchase(StatementCache* cache, int cached, sqlite3_int64 productId) {
+    sqlite3_stmt *begin = NULL, *update = NULL, *insert = NULL, *commit = NULL;
+    int ok;
+
+    if (cached) {
+        begin = StmtCache_Acquire(cache, "BEGIN IMMEDIATE");
+        update = StmtCache_Acquire(cache, SQL_PURCHASE_UPDATE_STOCK);
+        insert = StmtCache_Acquire(cache, SQL_PURCHASE_INSERT_SALE);
+        commit = StmtCache_Acquire(cache, "COMMIT");
+    } else {
+        sqlite3_prepare_v2(cache->conn, "BEGIN IMMEDIATE", -1, &begin, NULL);
+        sqlite3_prepare_v2(cache->conn, SQL_PURCHASE_UPDATE_STOCK, -1, &update, NULL);
+        sqlite3_prepare_v2(cache->conn, SQL_PURCHASE_INSERT_SALE, -1, &insert, NULL);
+        sqlite3_prepare_v2(cache->conn, "COMMIT", -1, &commit, NULL);
+        cache->prepares += 4;
+    }
+    ok = begin && update && insert && commit &&
+         RunPurchaseTransaction(begin, update, insert, commit, productId, 1, NULL);
+
+    if (cached) {
+        StmtCache_Release(cache, begin);
+        StmtCache_Release(cache, update);
+        StmtCache_Release(cache, insert);
+        StmtCache_Release(cache, commit);
+    } else {
+        sqlite3_finalize(begin);
+        sqlite3_finalize(update);
+        sqlite3_finalize(insert);
+        sqlite3_finalize(commit);
+    }
+    return ok;
+}
+
+static int BenchStmtCache(int argc, char** argv) {
+    static const char* const modes[] = { "prepare", "cached" };
+    int purchases = argc > 0 ? atoi(argv[0]) : BENCH_DEFAULT_PURCHASES;
+    WorkloadSpec spec;
+    sqlite3* conn;
+    int m, ok;
+
+    if (purchases <= 0) {
+        fprintf(stderr, "purchase count must be positive\n");
+        return 0;
+    }
+
+    Workload_Init(&spec, 1, BENCH_SEED);
+    spec.products = BENCH_PRODUCTS;
+    spec.sales = 0;
+    conn = OpenBenchDatabase(BENCH_DB_FILENAME, FindPragmaProfile(BENCH_PROFILE));
+    ok = conn != NULL;
+    ok = ok && Workload_Generate(conn, &spec, NULL, NULL) == SQLITE_OK;
+    ok = ok && sqlite3_exec(conn, "UPDATE products SET quantity = 1000000", NULL, NULL, NULL) == SQLITE_OK;
+    if (!ok) {
+        fprintf(stderr, "cannot build the purchase database: %s\n", conn ? sqlite3_errmsg(conn) : "open");
+    }
+
+    for (m = 0; ok && m < (int)(sizeof(modes) / sizeof(modes[0])); m++) {
+        StatementCache cache;
+        LatencyLog log;
+        char labels[160];
+        int i;
+
+        memset(&cache, 0, sizeof(cache));
+        cache.conn = conn;
+        ok = LatencyLog_Start(&log, purchases);
+        for (i = 0; ok && i < purchases; i++) {
+            double started = NowSeconds();
+            ok = PreparedPurchase(&cache, m == 1, i % BENCH_PRODUCTS + 1);
+            LatencyLog_Add(&log, started);
+        }
+
+        if (ok) {
+            snprintf(labels, sizeof(labels), "\"profile\":\"%s\",\"mode\":\"%s\",\"prepares\":%ld,\"reuses\":%ld",
+                     BENCH_PROFILE, modes[m], cache.prepares, cache.reuses);
+            LatencyLog_Report(&log, "stmtcache", labels, "purchase");
+        } else {
+            fprintf(stderr, "%s purchases failed: %s\n", modes[m], sqlite3_errmsg(conn));
+        }
+        LatencyLog_Free(&log);
+        StmtCache_Finalize(&cache);
+    }
+
+    sqlite3_close(conn);
+    RemoveDatabase(BENCH_DB_FILENAME);
+    return ok;
+}
+
+/*
+ * Product search: the search box's id scan with name LIKE '%term%', which reads every
+ * product, against the trigram index MATCH the app uses for terms of three characters or
+ * more. Both return the same ids, which is checked for every term.
+ */
+
+static const char* g_searchTerms[] = { "Laptop", "Mouse", "Samsung Pro", "Projector", "A12" };
+
+#define SEARCH_TERM_COUNT ((int)(sizeof(g_searchTerms) / sizeof(g_searchTerms[0])))
+
+// Ids read by one search, summed so both statements can be compared cheaply
+static int RunSearchScan(sqlite3_stmt* stmt, const char* pattern, sqlite3_int64* rows, sqlite3_int64* idSum) {
+    int rc;
+
+    *rows = 0;
+    *idSum = 0;
+    sqlite3_bind_text(stmt, 1, pattern, -1, SQLITE_TRANSIENT);
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        (*rows)++;
+        *idSum += sqlite3_column_int64(stmt, 0);
+    }
+    sqlite3_reset(stmt);
+    return rc == SQLITE_DONE;
+}
+
+static int RunSearchScale(sqlite3_int64 products) {
+    sqlite3_stmt *like = NULL, *match = NULL;
+    WorkloadSpec spec;
+    sqlite3* conn;
+    // A LIKE scan reads every product, so large catalogs run each term fewer times
+    int iterations = products <= 100000 ? 20 : products <= 1000000 ? 5 : 1;
+    int t, ok;
+
+    Workload_Init(&spec, 1, BENCH_SEED);
+    spec.products = products;
+    spec.sales = 0;
+
+    conn = OpenBenchDatabase(BENCH_DB_FILENAME, FindPragmaProfile("bulk"));
+    ok = conn != NULL;
+    ok = ok && Workload_Generate(conn, &spec, NULL, NULL) == SQLITE_OK;
+    ok = ok && sqlite3_exec(conn, "BEGIN;" SQL_CREATE_PRODUCTS_FTS SQL_REBUILD_PRODUCTS_FTS ";COMMIT;",
+                            NULL, NULL, NULL) == SQLITE_OK;
+    ok = ok && ApplyPragmaProfile(conn, FindPragmaProfile(BENCH_PROFILE)) == SQLITE_OK;
+    ok = ok && sqlite3_prepare_v2(conn, SQL_PRODUCT_IDS_LIKE, -1, &like, NULL) == SQLITE_OK;
+    ok = ok && sqlite3_prepare_v2(conn, SQL_PRODUCT_IDS_MATCH, -1, &match, NULL) == SQLITE_OK;
+    if (!ok) {
+        fprintf(stderr, "cannot build a %lld product database: %s\n", (long long)products,
+                conn ? sqlite3_errmsg(conn) : "open");
+    }
+
+    for (t = 0; ok && t < SEARCH_TERM_COUNT; t++) {
+        sqlite3_int64 likeRows = 0, likeSum = 0, matchRows = 0, matchSum = 0;
+        LatencyLog likeLog, matchLog;
+        char pattern[64], phrase[64], labels[160];
+        int i;
+
+        snprintf(pattern, sizeof(pattern), "%%%s%%", g_searchTerms[t]);
+        snprintf(phrase, sizeof(phrase), "\"%s\"", g_searchTerms[t]);
+        ok = LatencyLog_Start(&likeLog, iterations) && LatencyLog_Start(&matchLog, iterations);
+        for (i = 0; ok && i < iterations; i++) {
+            double started = NowSeconds();
+            ok = RunSearchScan(like, pattern, &likeRows, &likeSum);
+            LatencyLog_Add(&likeLog, started);
+        }
+        matchLog.started = NowSeconds();
+        for (i = 0; ok && i < iterations; i++) {
+            double started = NowSeconds();
+            ok = RunSearchScan(match, phrase, &matchRows, &matchSum);
+            LatencyLog_Add(&matchLog, started);
+        }
+
+        if (ok && (likeRows != matchRows || likeSum != matchSum)) {
+            fprintf(stderr, "%s: LIKE found %lld products, MATCH %lld\n", g_searchTerms[t],
+                    (long long)likeRows, (long long)matchRows);
+            ok = 0;
+        }
+        if (ok) {
+            snprintf(labels, sizeof(labels), "\"profile\":\"%s\",\"products\":%lld,\"term\":\"%s\",\"rows\":%lld",
+                     BENCH_PROFILE, (long long)products, g_searchTerms[t], (long long)likeRows);
+            LatencyLog_Report(&likeLog, "search", labels, "like");
+            LatencyLog_Report(&matchLog, "search", labels, "match");
+        } else {
+            fprintf(stderr, "search for %s failed: %s\n", g_searchTerms[t], sqlite3_errmsg(conn));
+        }
+        LatencyLog_Free(&likeLog);
+        LatencyLog_Free(&matchLog);
+    }
+
+    sqlite3_finalize(like);
+    sqlite3_finalize(match);
+    sqlite3_close(conn);
+    RemoveDatabase(BENCH_DB_FILENAME);
+    return ok;
+}
+
+// Catalog sizes in products, 10k, 1M and 10M by default
+static int BenchSearch(int argc, char** argv) {
+    static const sqlite3_int64 defaultProducts[] = { 10000, 1000000, 10000000 };
+    int i;
+
+    if (argc == 0) {
+        for (i = 0; i < (int)(sizeof(defaultProducts) / sizeof(defaultProducts[0])); i++) {
+            if (!RunSearchScale(defaultProducts[i])) {
+                return 0;
+            }
+        }
+        return 1;
+    }
+    for (i = 0; i < argc; i++) {
+        if (atoll(argv[i]) <= 0 || atoll(argv[i]) > 100000000) {
+            fprintf(stderr, "products must be between 1 and 100000000: %s\n", argv[i]);
+            return 0;
+        }
+        if (!RunSearchScale(atoll(argv[i]))) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/*
+ * Query plan check: EXPLAIN QUERY PLAN for every statement in db_queries.h on a scaled
+ * database with the app's schema and indexes. A SCAN of a table the statement is not
+ * expected to scan fails the check.
+ */
+
+typedef struct {
+    const char* name;
+    const char* sql;
+    const char* scans;      // tables the statement may read from end to end, space separated
+} PlanCheck;
+
+#define PLAN_CHECK(sql, scans) { #sql, sql, scans }
+
+static const PlanCheck g_planChecks[] = {
+    // Page anchors are built from every id, and substring LIKE cannot use an index
+    PLAN_CHECK(SQL_PRODUCT_IDS, "products"),
+    PLAN_CHECK(SQL_PRODUCT_IDS_LIKE, "products"),
+    PLAN_CHECK(SQL_PRODUCT_IDS_MATCH, ""),
+    PLAN_CHECK(SQL_PRODUCT_PAGE, ""),
+    PLAN_CHECK(SQL_PRODUCT_PAGE_LIKE, ""),
+    PLAN_CHECK(SQL_PRODUCT_PAGE_MATCH, ""),
+    PLAN_CHECK(SQL_PRODUCT_BY_ID, ""),
+    PLAN_CHECK(SQL_PRODUCT_NAMES_BY_IDS, ""),
+    // Newest rows in key order, stopped by the LIMIT
+    PLAN_CHECK(SQL_SALES_PAGE_FIRST, "sales"),
+    PLAN_CHECK(SQL_SALES_PAGE_BEFORE, ""),
+    PLAN_CHECK(SQL_SALE_BY_ID, ""),
+    PLAN_CHECK(SQL_SALES_AFTER_ID, ""),
+    PLAN_CHECK(SQL_SALES_MAX_ID, ""),
+    // An export of every sale reads the table in key order
+    PLAN_CHECK(SQL_SALES_EXPORT, "sales"),
+    PLAN_CHECK(SQL_SALES_EXPORT_DATES, ""),
+    PLAN_CHECK(SQL_SALES_EXPORT_PRODUCT, ""),
+    PLAN_CHECK(SQL_SALES_DAILY_SUMMARY, "sales_daily_totals"),
+    PLAN_CHECK(SQL_SALES_DAILY_FOR_SALE, ""),
+    PLAN_CHECK(SQL_SALES_TOTALS_ROLLUP, ""),
+    PLAN_CHECK(SQL_SALES_TOTALS_SCAN, ""),
+    PLAN_CHECK(SQL_SALES_PRODUCT_TOTALS, ""),
+    PLAN_CHECK(SQL_SALES_BY_PRODUCT, ""),
+    PLAN_CHECK(SQL_SALES_MIRROR_AFTER_ID, ""),
+    PLAN_CHECK(SQL_SALES_ID_BOUNDS, ""),
+    PLAN_CHECK(SQL_SALES_RANGE_PRODUCT_DAYS, ""),
+    PLAN_CHECK(SQL_SALES_RANGE_PRODUCTS, ""),
+    // The snapshot reads every sale in key order, and every product id from idx_sales_product
+    PLAN_CHECK(SQL_SALES_SNAPSHOT_PRODUCTS, "sales"),
+    PLAN_CHECK(SQL_SALES_SNAPSHOT, "sales"),
+    PLAN_CHECK(SQL_INSERT_PRODUCT, ""),
+    PLAN_CHECK(SQL_UPDATE_PRODUCT, ""),
+    PLAN_CHECK(SQL_DELETE_PRODUCT, ""),
+    PLAN_CHECK(SQL_UPSERT_PRODUCT, ""),
+    PLAN_CHECK(SQL_PURCHASE_UPDATE_STOCK, ""),
+    PLAN_CHECK(SQL_PURCHASE_INSERT_SALE, ""),
+    PLAN_CHECK(SQL_INSERT_RECEIPT, ""),
+    PLAN_CHECK(SQL_INSERT_SALE_LINE, ""),
+    PLAN_CHECK(SQL_UPDATE_RECEIPT_TOTAL, "")
+};
+
+#define PLAN_CHECK_COUNT ((int)(sizeof(g_planChecks) / sizeof(g_planChecks[0])))
+
+// Is table one of the space separated names in list?
+static int ListContains(const char* list, const char* table, size_t length) {
+    while (*list) {
+        size_t n = strcspn(list, " ");
+        if (n == length && strncmp(list, table, length) == 0) {
+            return 1;
+        }
+        list += n;
+        list += strspn(list, " ");
+    }
+    return 0;
+}
+
+// Prints the plan as one JSON line; returns 1 if it has no unexpected full scan
+static int CheckPlan(sqlite3* conn, const PlanCheck* check) {
+    sqlite3_str* plan = sqlite3_str_new(conn);
+    sqlite3_str* sql = sqlite3_str_new(conn);
+    sqlite3_stmt* stmt = NULL;
+    const char* failure = NULL;
+    char* text;
+    int rows = 0;
+
+    sqlite3_str_appendf(sql, "EXPLAIN QUERY PLAN %s", check->sql);
+    text = sqlite3_str_finish(sql);
+    if (!text || sqlite3_prepare_v2(conn, text, -1, &stmt, NULL) != SQLITE_OK) {
+        failure = sqlite3_errmsg(conn);
+    }
+    sqlite3_free(text);
+
+    while (!failure && sqlite3_step(stmt) == SQLITE_ROW) {
+        const char* detail = (const char*)sqlite3_column_text(stmt, 3);
+
+        sqlite3_str_appendf(plan, "%s%s", rows++ ? "; " : "", detail);
+        // Virtual tables report SCAN even when their own index answers the query
+        if (strncmp(detail, "SCAN ", 5) == 0 && !strstr(detail, "VIRTUAL TABLE")) {
+            const char* table = detail + 5;
+            if (!ListContains(check->scans, table, strcspn(table, " "))) {
+                failure = "unexpected full scan";
+            }
+        }
+    }
+    sqlite3_finalize(stmt);
+
+    text = sqlite3_str_finish(plan);
+    printf("{\"bench\":\"plans\",\"statement\":\"%s\",\"ok\":%s,\"plan\":\"%s\"%s%s%s}\n",
+           check->name, failure ? "false" : "true", text ? text : "",
+           failure ? ",\"error\":\"" : "", failure ? failure : "", failure ? "\"" : "");
+    sqlite3_free(text);
+    return failure == NULL;
+}
+
+static int BenchPlans(int argc, char** argv) {
+    int scale = argc > 0 ? atoi(argv[0]) : 1;
+    WorkloadSpec spec;
+    sqlite3* conn;
+    int i, ok;
+
+    if (scale <= 0) {
+        fprintf(stderr, "scale must be a positive integer: %s\n", argv[0]);
+        return 0;
+    }
+    Workload_Init(&spec, scale, BENCH_SEED);
+
+    conn = OpenBenchDatabase(BENCH_DB_FILENAME, FindPragmaProfile("bulk"));
+    ok = conn != NULL;
+    ok = ok && Workload_Generate(conn, &spec, NULL, NULL) == SQLITE_OK;
+    ok = ok && sqlite3_exec(conn, "BEGIN;" SQL_CREATE_PRODUCTS_FTS SQL_REBUILD_PRODUCTS_FTS ";"
+                            SQL_CREATE_PRODUCTS_FTS_TRIGGERS SQL_CREATE_SALES_DAILY SQL_REBUILD_SALES_DAILY
+                            SQL_CREATE_SALES_DAILY_TRIGGERS "COMMIT;", NULL, NULL, NULL) == SQLITE_OK;
+    if (!ok) {
+        fprintf(stderr, "cannot build scale %d database: %s\n", scale, conn ? sqlite3_errmsg(conn) : "open");
+        sqlite3_close(conn);
+        RemoveDatabase(BENCH_DB_FILENAME);
+        return 0;
+    }
+
+    for (i = 0; i < PLAN_CHECK_COUNT; i++) {
+        ok = CheckPlan(conn, &g_planChecks[i]) && ok;
+    }
+
+    sqlite3_close(conn);
+    RemoveDatabase(BENCH_DB_FILENAME);
+    return ok;
+}
+
+static void ReportSeedProgress(void* context, sqlite3_int64 done, sqlite3_int64 total) {
+    (void)context;
+    fprintf(stderr, "\rseeded %lld of %lld rows", (long long)done, (long long)total);
+    if (done == total) {
+        fputc('\n', stderr);
+    }
+}
+
+// Appends the synthetic workload to a database, creating it if needed
+static int SeedDatabase(int argc, char** argv) {
+    WorkloadSpec spec;
+    sqlite3* conn;
+    double started, elapsed;
+    int rollupExists;
+    int rc;
+
+    if (argc < 2 || atoi(argv[1]) <= 0) {
+        fprintf(stderr, "usage: bench seed <database> <scale> [seed]\n");
+        return 0;
+    }
+    Workload_Init(&spec, atoi(argv[1]), argc > 2 ? strtoull(argv[2], NULL, 10) : BENCH_SEED);
+
+    if (sqlite3_open(argv[0], &conn) != SQLITE_OK) {
+        fprintf(stderr, "cannot open %s: %s\n", argv[0], sqlite3_errmsg(conn));
+        sqlite3_close(conn);
+        return 0;
+    }
+    rc = ApplyPragmaProfile(conn, FindPragmaProfile("bulk"));
+    if (rc == SQLITE_OK) {
+        // All of the app's tables, since EnsureIndexes also indexes sale_lines
+        rc = sqlite3_exec(conn, SQL_CREATE_PRODUCTS SQL_CREATE_SALES SQL_CREATE_RECEIPTS SQL_CREATE_SALE_LINES,
+                          NULL, NULL, NULL);
+    }
+
+    started = NowSeconds();
+    // An existing rollup is kept current by its triggers; otherwise build it once after loading
+    rollupExists = QueryInt64(conn, "SELECT COUNT(*) FROM sqlite_master WHERE name = 'sales_daily'") > 0;
+    if (rc == SQLITE_OK) {
+        rc = Workload_Generate(conn, &spec, ReportSeedProgress, NULL);
+    }
+    if (rc == SQLITE_OK && !rollupExists) {
+        rc = sqlite3_exec(conn, "BEGIN;" SQL_CREATE_SALES_DAILY SQL_REBUILD_SALES_DAILY
+                          SQL_CREATE_SALES_DAILY_TRIGGERS "COMMIT;", NULL, NULL, NULL);
+    }
+    // Indexing after the load is faster than maintaining the indexes row by row
+    if (rc == SQLITE_OK) {
+        rc = EnsureIndexes(conn);
+    }
+    // Fold the WAL back so the result is a single self-contained file
+    if (rc == SQLITE_OK) {
+        rc = sqlite3_wal_checkpoint_v2(conn, NULL, SQLITE_CHECKPOINT_TRUNCATE, NULL, NULL);
+    }
+    elapsed = NowSeconds() - started;
+
+    if (rc != SQLITE_OK) {
+        fprintf(stderr, "seeding %s failed: %s\n", argv[0], sqlite3_errmsg(conn));
+    } else {
+        printf("{\"bench\":\"seed\",\"products\":%lld,\"sales\":%lld,\"seed\":%llu,"
+               "\"seconds\":%.2f,\"rows_per_sec\":%.0f}\n",
+               (long long)spec.products, (long long)spec.sales, spec.seed,
+               elapsed, (spec.products + spec.sales) / elapsed);
+    }
+    sqlite3_close(conn);
+    return rc == SQLITE_OK;
+}
+
+static void ReportExportProgress(void* context, sqlite3_int64 rows) {
+    (void)context;
+    fprintf(stderr, "\rexported %lld rows", (long long)rows);
+}
+
+// Seconds to write bytes of one repeated buffer to path: the disk's sequential rate,
+// which the export is measured against
+static double TimeRawWrite(const char* path, sqlite3_int64 bytes) {
+    char* buffer = (char*)calloc(1, SALES_EXPORT_BUFFER);
+    FILE* file = buffer ? fopen(path, "wb") : NULL;
+    double started = NowSeconds(), elapsed = -1;
+    int ok = file != NULL;
+
+    while (ok && bytes > 0) {
+        size_t chunk = bytes < SALES_EXPORT_BUFFER ? (size_t)bytes : SALES_EXPORT_BUFFER;
+        ok = fwrite(buffer, 1, chunk, file) == chunk;
+        bytes -= (sqlite3_int64)chunk;
+    }
+    if (file) {
+        ok = fclose(file) == 0 && ok;
+        elapsed = NowSeconds() - started;
+        remove(path);
+    }
+    free(buffer);
+    return ok ? elapsed : -1;
+}
+
+// Writes sales from a database, e.g. one built by bench seed, to CSV. "-" leaves that end of
+// the date range open.
+static int ExportSales(int argc, char** argv) {
+    SalesExportFilter filter = { NULL, NULL, 0 };
+    SalesExportResult result;
+    char rawPath[256];
+    sqlite3* conn;
+    double started, elapsed, rawSeconds;
+    int rc;
+
+    if (argc != 2 && argc != 4 && argc != 5) {
+        fprintf(stderr, "usage: bench export <database> <csv> [from|- to|- [product id]]\n");
+        return 0;
+    }
+    if (argc >= 4) {
+        filter.from = strcmp(argv[2], "-") ? argv[2] : NULL;
+        filter.to = strcmp(argv[3], "-") ? argv[3] : NULL;
+    }
+    if (argc == 5 && (filter.productId = atoll(argv[4])) <= 0) {
+        fprintf(stderr, "product id must be a positive integer: %s\n", argv[4]);
+        return 0;
+    }
+
+    if (sqlite3_open_v2(argv[0], &conn, SQLITE_OPEN_READONLY, NULL) != SQLITE_OK) {
+        fprintf(stderr, "cannot open %s: %s\n", argv[0], sqlite3_errmsg(conn));
+        sqlite3_close(conn);
+        return 0;
+    }
+
+    started = NowSeconds();
+    rc = SalesExport_Run(conn, argv[1], &filter, ReportExportProgress, NULL, &result);
+    elapsed = NowSeconds() - started;
+    if (result.rows >= SALES_EXPORT_PROGRESS_ROWS) {
+        fputc('\n', stderr);
+    }
+
+    if (rc != SQLITE_OK) {
+        fprintf(stderr, "exporting %s failed: %s\n", argv[0], rc == SQLITE_IOERR || rc == SQLITE_CANTOPEN
+                ? "cannot write the file" : sqlite3_errmsg(conn));
+    } else {
+        snprintf(rawPath, sizeof(rawPath), "%s.raw", argv[1]);
+        rawSeconds = TimeRawWrite(rawPath, result.bytes);
+        printf("{\"bench\":\"export\",\"rows\":%lld,\"bytes\":%lld,\"seconds\":%.2f,"
+               "\"rows_per_sec\":%.0f,\"mb_per_sec\":%.1f,\"raw_write_mb_per_sec\":%.1f,\"peak_memory_kb\":%lld}\n",
+               (long long)result.rows, (long long)result.bytes, elapsed, result.rows / elapsed,
+               result.bytes / elapsed / (1024 * 1024),
+               rawSeconds > 0 ? result.bytes / rawSeconds / (1024 * 1024) : 0.0,
+               (long long)(result.peakMemory / 1024));
+    }
+    sqlite3_close(conn);
+    return rc == SQLITE_OK;
+}
+
+// Writes the columnar snapshot of a database, e.g. one built by bench seed
+static int WriteSnapshot(int argc, char** argv) {
+    SalesSnapshotResult result;
+    sqlite3* conn;
+    double started, elapsed;
+    int rc;
+
+    if (argc != 2) {
+        fprintf(stderr, "usage: bench snapshot <database> <file>\n");
+        return 0;
+    }
+    if (sqlite3_open_v2(argv[0], &conn, SQLITE_OPEN_READONLY, NULL) != SQLITE_OK) {
+        fprintf(stderr, "cannot open %s: %s\n", argv[0], sqlite3_errmsg(conn));
+        sqlite3_close(conn);
+        return 0;
+    }
+
+    started = NowSeconds();
+    rc = SalesSnapshot_Write(conn, argv[1], &result);
+    elapsed = NowSeconds() - started;
+
+    if (rc != SQLITE_OK) {
+        fprintf(stderr, "writing a snapshot of %s failed: %s\n", argv[0], rc == SQLITE_IOERR || rc == SQLITE_CANTOPEN
+                ? "cannot write the file" : sqlite3_errmsg(conn));
+    } else {
+        sqlite3_int64 databaseBytes = DatabaseBytes(conn);
+
+        printf("{\"bench\":\"snapshot\",\"rows\":%lld,\"blocks\":%lld,\"products\":%lld,\"seconds\":%.2f,"
+               "\"rows_per_sec\":%.0f,\"database_bytes\":%lld,\"snapshot_bytes\":%lld}\n",
+               (long long)result.rows, (long long)result.blocks, (long long)result.products, elapsed,
+               result.rows / elapsed, (long long)databaseBytes, (long long)result.bytes);
+    }
+    sqlite3_close(conn);
+    return rc == SQLITE_OK;
+}
+
+static const Benchmark g_benchmarks[] = {
+    { "profiles", BenchProfiles },
+    { "statements", BenchStatements },
+    { "checkout", BenchCheckout },
+    { "groupcommit", BenchGroupCommit },
+    { "writer", BenchWriter },
+    { "rollup", BenchRollup },
+    { "readers", BenchReaders },
+    { "import", BenchImport },
+    { "columnar", BenchColumnar },
+    { "mirror", BenchMirror },
+    { "parallel", BenchParallel },
+    { "cache", BenchCache },
+    { "firstpage", BenchFirstPage },
+    { "stmtcache", BenchStmtCache },
+    { "search", BenchSearch },
+    { "plans", BenchPlans }
+};
+
+#define BENCHMARK_COUNT ((int)(sizeof(g_benchmarks) / sizeof(g_benchmarks[0])))
+
+int main(int argc, char** argv) {
+    int i;
+    int ok = 1;
+
+    if (argc >= 2 && strcmp(argv[1], "seed") == 0) {
+        return SeedDatabase(argc - 2, argv + 2) ? 0 : 1;
+    }
+    if (argc >= 2 && strcmp(argv[1], "export") == 0) {
+        return ExportSales(argc - 2, argv + 2) ? 0 : 1;
+    }
+    if (argc >= 2 && strcmp(argv[1], "snapshot") == 0) {
+        return WriteSnapshot(argc - 2, argv + 2) ? 0 : 1;
+    }
+
+    for (i = 0; i < BENCHMARK_COUNT; i++) {
+        if (argc < 2 || strcmp(argv[1], g_benchmarks[i].name) == 0) {
+            ok = g_benchmarks[i].run(argc > 2 ? argc - 2 : 0, argv + 2) && ok;
+            if (argc >= 2) {
+                return ok ? 0 : 1;
+            }
+        }
+    }
+    if (argc >= 2) {
+        fprintf(stderr, "unknown benchmark: %s\n", argv[1]);
+        return 2;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,42 @@
+/*
+ * Rows touched by the last mutation, see change_log.h
+ */
+
+#include <string.h>
+#include "change_log.h"
+
+// sqlite3_update_hook callback: remember which product and sales rows changed
+static void OnDatabaseUpdate(void* arg, int op, const char* dbName, const char* table, sqlite3_int64 rowid) {
+    ChangeLog* log = (ChangeLog*)arg;
+    int isSales;
+    (void)dbName;
+    if (strcmp(table, "products") == 0) {
+        isSales = 0;
+    } else if (strcmp(table, "sales") == 0) {
+        isSales = 1;
+    } else {
+        return;
+    }
+
+    if (log->count == MAX_PENDING_CHANGES) {
+        log->overflow = 1;
+        return;
+    }
+
+    RowChange* change = &log->changes[log->count++];
+    change->op = op;
+    change->isSales = isSales;
+    change->rowid = rowid;
+}
+
+// Rolled back changes never reached the table, forget them
+static void OnDatabaseRollback(void* arg) {
+    ChangeLog* log = (ChangeLog*)arg;
+    log->count = 0;
+    log->overflow = 0;
+}
+
+void InstallChangeHooks(sqlite3* conn, ChangeLog* log) {
+    sqlite3_update_hook(conn, OnDatabaseUpdate, log);
+    sqlite3_rollback_hook(conn, OnDatabaseRollback, log);
+}
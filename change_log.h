@@ -0,0 +1,37 @@
+/*
+ * Rows touched by the last mutation, collected by sqlite3_update_hook so the
+ * lists can be patched row by row instead of reloaded
+ */
+
+#ifndef CHANGE_LOG_H
+#define CHANGE_LOG_H
+
+#include <sqlite3.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MAX_PENDING_CHANGES 64
+
+typedef struct {
+    int op;                 // SQLITE_INSERT, SQLITE_UPDATE or SQLITE_DELETE
+    int isSales;            // 0 for products, 1 for sales
+    sqlite3_int64 rowid;
+} RowChange;
+
+typedef struct {
+    RowChange changes[MAX_PENDING_CHANGES];
+    int count;
+    int overflow;           // too many changes to patch, reload instead
+} ChangeLog;
+
+// Record product and sales changes made on conn into log; a rollback empties it.
+// The caller empties it once the changes are applied.
+void InstallChangeHooks(sqlite3* conn, ChangeLog* log);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,120 @@
+/*
+ * SQLite tuning profiles
+ * Shared by the GUI and the headless benchmark, so it must not depend on windows.h
+ */
+
+#ifndef DB_PROFILES_H
+#define DB_PROFILES_H
+
+#include <stdio.h>
+#include <string.h>
+#include <sqlite3.h>
+
+#define DB_DEFAULT_PROFILE "balanced"
+// How long a connection retries a locked database before giving up with SQLITE_BUSY
+#define DB_BUSY_TIMEOUT_MS 5000
+
+typedef struct {
+    const char* name;
+    const char* journalMode;    // DELETE or WAL
+    const char* synchronous;    // OFF, NORMAL or FULL
+    int cacheSize;              // pages, or KiB when negative
+    sqlite3_int64 mmapSize;     // bytes, 0 disables memory mapping
+    const char* tempStore;      // DEFAULT, FILE or MEMORY
+    int walAutocheckpoint;      // pages
+} PragmaProfile;
+
+static const PragmaProfile g_pragmaProfiles[] = {
+    // SQLite defaults: rollback journal, fsync on every commit
+    { "legacy",     "DELETE", "FULL",   -2000,  0,                      "DEFAULT", 1000 },
+    // WAL but still fsyncs the log on every commit
+    { "safe",       "WAL",    "FULL",   -8000,  64LL * 1024 * 1024,     "MEMORY",  1000 },
+    // WAL with fsync only at checkpoints; a power cut can lose the last commits, never corrupt
+    { "balanced",   "WAL",    "NORMAL", -16000, 256LL * 1024 * 1024,    "MEMORY",  1000 },
+    // Larger cache and fewer, longer checkpoints for busy tills
+    { "throughput", "WAL",    "NORMAL", -65536, 1024LL * 1024 * 1024,   "MEMORY",  10000 },
+    // No fsync at all; only for rebuilding a database that can be regenerated
+    { "bulk",       "WAL",    "OFF",    -262144, 1024LL * 1024 * 1024,  "MEMORY",  100000 }
+};
+
+#define PRAGMA_PROFILE_COUNT ((int)(sizeof(g_pragmaProfiles) / sizeof(g_pragmaProfiles[0])))
+
+static inline const PragmaProfile* FindPragmaProfile(const char* name) {
+    int i;
+    for (i = 0; i < PRAGMA_PROFILE_COUNT; i++) {
+        if (strcmp(g_pragmaProfiles[i].name, name) == 0) {
+            return &g_pragmaProfiles[i];
+        }
+    }
+    return NULL;
+}
+
+// journal_mode is stored in the database file; the rest only last for this connection.
+// Returns SQLITE_OK, or an error code if a pragma failed or WAL could not be enabled.
+static inline int ApplyPragmaProfile(sqlite3* conn, const PragmaProfile* profile) {
+    char sql[256];
+    sqlite3_stmt* stmt;
+    int rc;
+
+    snprintf(sql, sizeof(sql), "PRAGMA journal_mode=%s", profile->journalMode);
+    rc = sqlite3_prepare_v2(conn, sql, -1, &stmt, NULL);
+    if (rc != SQLITE_OK) {
+        return rc;
+    }
+    // The pragma reports the mode actually in effect, which stays DELETE if WAL is unsupported
+    rc = sqlite3_step(stmt);
+    if (rc == SQLITE_ROW) {
+        const char* mode = (const char*)sqlite3_column_text(stmt, 0);
+        rc = mode && sqlite3_stricmp(mode, profile->journalMode) == 0 ? SQLITE_OK : SQLITE_CANTOPEN;
+    }
+    sqlite3_finalize(stmt);
+    if (rc != SQLITE_OK) {
+        return rc;
+    }
+
+    snprintf(sql, sizeof(sql),
+             "PRAGMA synchronous=%s;"
+             "PRAGMA cache_size=%d;"
+             "PRAGMA mmap_size=%lld;"
+             "PRAGMA temp_store=%s;"
+             "PRAGMA wal_autocheckpoint=%d;",
+             profile->synchronous, profile->cacheSize, (long long)profile->mmapSize,
+             profile->tempStore, profile->walAutocheckpoint);
+    return sqlite3_exec(conn, sql, NULL, NULL, NULL);
+}
+
+// Opens a read-only connection for reports. It only pays off under WAL, where a reader works
+// from a snapshot and never blocks the writer; with a rollback journal the shared lock it
+// holds during a scan would stall every COMMIT, so that is refused with SQLITE_CANTOPEN.
+static inline int OpenReadConnection(const char* path, const PragmaProfile* profile, sqlite3** conn) {
+    char sql[160];
+    sqlite3_stmt* stmt;
+    int rc = sqlite3_open_v2(path, conn, SQLITE_OPEN_READONLY, NULL);
+
+    if (rc == SQLITE_OK) {
+        // Even under WAL a reader can find the database locked, while another connection
+        // recovers the log or a checkpoint resets it; it waits like the writer does
+        sqlite3_busy_timeout(*conn, DB_BUSY_TIMEOUT_MS);
+        rc = sqlite3_prepare_v2(*conn, "PRAGMA journal_mode", -1, &stmt, NULL);
+        if (rc == SQLITE_OK) {
+            rc = sqlite3_step(stmt) == SQLITE_ROW &&
+                 sqlite3_stricmp((const char*)sqlite3_column_text(stmt, 0), "wal") == 0 ? SQLITE_OK : SQLITE_CANTOPEN;
+        }
+        sqlite3_finalize(stmt);
+    }
+    if (rc == SQLITE_OK) {
+        snprintf(sql, sizeof(sql),
+                 "PRAGMA cache_size=%d;"
+                 "PRAGMA mmap_size=%lld;"
+                 "PRAGMA temp_store=%s;",
+                 profile->cacheSize, (long long)profile->mmapSize, profile->tempStore);
+        rc = sqlite3_exec(*conn, sql, NULL, NULL, NULL);
+    }
+    if (rc != SQLITE_OK) {
+        sqlite3_close(*conn);
+        *conn = NULL;
+    }
+    return rc;
+}
+
+#endif
@@ -0,0 +1,140 @@
+/*
+ * Statements the application runs, shared with the benchmarks so both measure the same SQL
+ * Money parameters are integer ngwee; the legacy REAL columns are written alongside
+ */
+
+#ifndef DB_QUERIES_H
+#define DB_QUERIES_H
+
+// Product list: full id scans that build the page anchors, one per filter mode
+#define SQL_PRODUCT_IDS \
+    "SELECT id FROM products ORDER BY id"
+#define SQL_PRODUCT_IDS_LIKE \
+    "SELECT id, name FROM products WHERE name LIKE ? ORDER BY id"
+#define SQL_PRODUCT_IDS_MATCH \
+    "SELECT rowid, name FROM products_fts WHERE products_fts MATCH ? ORDER BY rowid"
+
+// Product list: one page from an anchor id, one per filter mode
+#define SQL_PRODUCT_PAGE \
+    "SELECT id, name, quantity, price_cents, created_at FROM products " \
+    "WHERE id >= ? ORDER BY id LIMIT ?"
+#define SQL_PRODUCT_PAGE_LIKE \
+    "SELECT id, name, quantity, price_cents, created_at FROM products " \
+    "WHERE name LIKE ? AND id >= ? ORDER BY id LIMIT ?"
+#define SQL_PRODUCT_PAGE_MATCH \
+    "SELECT p.id, p.name, p.quantity, p.price_cents, p.created_at " \
+    "FROM products_fts f JOIN products p ON p.id = f.rowid " \
+    "WHERE products_fts MATCH ? AND f.rowid >= ? ORDER BY f.rowid LIMIT ?"
+
+#define SQL_PRODUCT_BY_ID \
+    "SELECT id, name, quantity, price_cents, created_at FROM products WHERE id = ?"
+// Sales Report by product: the names of the ids in ?1, a JSON array, each with its position
+// in it. One seek per id; a deleted product has no row.
+#define SQL_PRODUCT_NAMES_BY_IDS \
+    "SELECT ids.key, products.name FROM json_each(?1) AS ids JOIN products ON products.id = ids.value"
+
+// Sales report: newest page, then keyset pages going back
+#define SQL_SALES_PAGE_FIRST \
+    "SELECT id, product_name, quantity_sold, total_cents, sale_date FROM sales " \
+    "ORDER BY id DESC LIMIT ?"
+#define SQL_SALES_PAGE_BEFORE \
+    "SELECT id, product_name, quantity_sold, total_cents, sale_date FROM sales " \
+    "WHERE id < ? ORDER BY id DESC LIMIT ?"
+
+#define SQL_SALE_BY_ID \
+    "SELECT id, product_name, quantity_sold, total_cents, sale_date FROM sales WHERE id = ?"
+// Sales committed after a report's snapshot was taken, oldest first
+#define SQL_SALES_AFTER_ID \
+    "SELECT id FROM sales WHERE id > ? ORDER BY id"
+#define SQL_SALES_MAX_ID \
+    "SELECT MAX(id) FROM sales"
+
+// CSV export, oldest first: every sale, or those in days [?1, ?2) as 'YYYY-MM-DD', optionally
+// of product ?3 only. Each order is the index order, so nothing is sorted before the first row.
+#define SQL_SALES_EXPORT \
+    "SELECT id, sale_date, product_id, product_name, quantity_sold, total_cents FROM sales ORDER BY id"
+#define SQL_SALES_EXPORT_DATES \
+    "SELECT id, sale_date, product_id, product_name, quantity_sold, total_cents FROM sales " \
+    "WHERE sale_date >= ?1 AND sale_date < ?2 ORDER BY sale_date"
+#define SQL_SALES_EXPORT_PRODUCT \
+    "SELECT id, sale_date, product_id, product_name, quantity_sold, total_cents FROM sales " \
+    "WHERE product_id = ?3 AND sale_date >= ?1 AND sale_date < ?2 ORDER BY sale_date"
+
+// Sales Report summary mode: per-day totals from the rollup, newest day first
+#define SQL_SALES_DAILY_SUMMARY \
+    "SELECT day, transactions, units, revenue_cents FROM sales_daily_totals ORDER BY day DESC LIMIT ?"
+#define SQL_SALES_DAILY_FOR_SALE \
+    "SELECT day, transactions, units, revenue_cents FROM sales_daily_totals " \
+    "WHERE day = (SELECT date(sale_date) FROM sales WHERE id = ?)"
+
+// Totals over [?1, ?2) as 'YYYY-MM-DD' days: from the rollup, and from every sale in the range
+// (through idx_sales_date), which the rollup replaces
+#define SQL_SALES_TOTALS_ROLLUP \
+    "SELECT SUM(transactions), SUM(units), SUM(revenue_cents) FROM sales_daily_totals WHERE day >= ?1 AND day < ?2"
+#define SQL_SALES_TOTALS_SCAN \
+    "SELECT COUNT(*), SUM(quantity_sold), SUM(total_cents) FROM sales WHERE sale_date >= ?1 AND sale_date < ?2"
+// The same for one product, ?3, through idx_sales_product
+#define SQL_SALES_PRODUCT_TOTALS \
+    "SELECT COUNT(*), SUM(quantity_sold), SUM(total_cents) FROM sales " \
+    "WHERE product_id = ?3 AND sale_date >= ?1 AND sale_date < ?2"
+
+// Units and revenue of each product sold over [?1, ?2), which the sales mirror answers in memory
+#define SQL_SALES_BY_PRODUCT \
+    "SELECT product_id, COUNT(*), SUM(quantity_sold), SUM(total_cents) FROM sales " \
+    "WHERE sale_date >= ?1 AND sale_date < ?2 GROUP BY product_id"
+
+// Sales mirror: the sales after ?, oldest first, as the columns it holds
+#define SQL_SALES_MIRROR_AFTER_ID \
+    "SELECT id, product_id, quantity_sold, COALESCE(total_cents, 0), CAST(strftime('%s', sale_date) AS INTEGER) " \
+    "FROM sales WHERE id > ? ORDER BY id"
+
+// Columnar snapshot: the product dictionary, then every sale in key order with sale_date as
+// Unix seconds and a missing total as 0, which is what SUM(total_cents) counts it as
+#define SQL_SALES_SNAPSHOT_PRODUCTS \
+    "SELECT DISTINCT product_id FROM sales ORDER BY product_id"
+#define SQL_SALES_SNAPSHOT \
+    "SELECT id, CAST(strftime('%s', sale_date) AS INTEGER), product_id, quantity_sold, COALESCE(total_cents, 0) " \
+    "FROM sales ORDER BY id"
+
+// Parallel reports: the ids the ranges are cut from, then one range's aggregate over sales
+// ids ?1 to ?2 and days [?3, ?4). The whole table is the range from the first id to the last.
+#define SQL_SALES_ID_BOUNDS \
+    "SELECT MIN(id), (SELECT MAX(id) FROM sales) FROM sales"
+#define SQL_SALES_RANGE_PRODUCT_DAYS \
+    "SELECT product_id, date(sale_date) AS day, COUNT(*), SUM(quantity_sold), SUM(total_cents) FROM sales " \
+    "WHERE id BETWEEN ?1 AND ?2 AND sale_date >= ?3 AND sale_date < ?4 GROUP BY product_id, day"
+#define SQL_SALES_RANGE_PRODUCTS \
+    "SELECT product_id, '', COUNT(*), SUM(quantity_sold), SUM(total_cents) FROM sales " \
+    "WHERE id BETWEEN ?1 AND ?2 AND sale_date >= ?3 AND sale_date < ?4 GROUP BY product_id"
+
+// Mutations: ?1 name, ?2 quantity, ?3 price, ?4 id
+#define SQL_INSERT_PRODUCT \
+    "INSERT INTO products (name, quantity, price, price_cents) VALUES (?1, ?2, ?3 / 100.0, ?3)"
+#define SQL_UPDATE_PRODUCT \
+    "UPDATE products SET name = ?1, quantity = ?2, price = ?3 / 100.0, price_cents = ?3 WHERE id = ?4"
+#define SQL_DELETE_PRODUCT \
+    "DELETE FROM products WHERE id = ?"
+// CSV import: a name already listed keeps its id and takes the new quantity and price.
+// The name is not rewritten, so the search index trigger on name updates never fires.
+#define SQL_UPSERT_PRODUCT \
+    "INSERT INTO products (name, quantity, price, price_cents) VALUES (?1, ?2, ?3 / 100.0, ?3) " \
+    "ON CONFLICT (name) DO UPDATE SET quantity = excluded.quantity, " \
+    "price = excluded.price, price_cents = excluded.price_cents"
+
+// Purchase transaction: ?1 quantity, ?2 product id. No row comes back when stock is short,
+// otherwise the sale is built from the returned row: ?1 product id, ?2 name, ?3 quantity, ?4 total
+#define SQL_PURCHASE_UPDATE_STOCK \
+    "UPDATE products SET quantity = quantity - ?1 WHERE id = ?2 AND quantity >= ?1 " \
+    "RETURNING quantity, price_cents, name"
+#define SQL_PURCHASE_INSERT_SALE \
+    "INSERT INTO sales (product_id, product_name, quantity_sold, total_amount, total_cents) VALUES (?1, ?2, ?3, ?4 / 100.0, ?4)"
+
+// Checkout: the receipt header first, one line per cart entry after each sale, then the total
+#define SQL_INSERT_RECEIPT \
+    "INSERT INTO receipts (line_count) VALUES (?)"
+#define SQL_INSERT_SALE_LINE \
+    "INSERT INTO sale_lines (receipt_id, line_no, sale_id, unit_cents) VALUES (?1, ?2, ?3, ?4)"
+#define SQL_UPDATE_RECEIPT_TOTAL \
+    "UPDATE receipts SET total_cents = ?1 WHERE id = ?2"
+
+#endif
@@ -0,0 +1,217 @@
+/*
+ * Table definitions shared by the GUI, the benchmarks and the workload generator
+ */
+
+#ifndef DB_SCHEMA_H
+#define DB_SCHEMA_H
+
+#include <string.h>
+#include <sqlite3.h>
+
+#define SQL_CREATE_PRODUCTS \
+    "CREATE TABLE IF NOT EXISTS products (" \
+    "id INTEGER PRIMARY KEY AUTOINCREMENT," \
+    "name TEXT NOT NULL UNIQUE," \
+    "quantity INTEGER NOT NULL DEFAULT 0," \
+    "price REAL NOT NULL," \
+    "created_at DATETIME DEFAULT CURRENT_TIMESTAMP," \
+    "price_cents INTEGER);"
+
+#define SQL_CREATE_SALES \
+    "CREATE TABLE IF NOT EXISTS sales (" \
+    "id INTEGER PRIMARY KEY AUTOINCREMENT," \
+    "product_id INTEGER NOT NULL," \
+    "product_name TEXT NOT NULL," \
+    "quantity_sold INTEGER NOT NULL," \
+    "total_amount REAL NOT NULL," \
+    "sale_date DATETIME DEFAULT CURRENT_TIMESTAMP," \
+    "total_cents INTEGER," \
+    "FOREIGN KEY (product_id) REFERENCES products(id));"
+
+// Cart checkouts: one receipt per basket, each line pointing at the sales row it recorded
+#define SQL_CREATE_RECEIPTS \
+    "CREATE TABLE IF NOT EXISTS receipts (" \
+    "id INTEGER PRIMARY KEY AUTOINCREMENT," \
+    "line_count INTEGER NOT NULL," \
+    "total_cents INTEGER NOT NULL DEFAULT 0," \
+    "sale_date DATETIME DEFAULT CURRENT_TIMESTAMP);"
+
+#define SQL_CREATE_SALE_LINES \
+    "CREATE TABLE IF NOT EXISTS sale_lines (" \
+    "receipt_id INTEGER NOT NULL," \
+    "line_no INTEGER NOT NULL," \
+    "sale_id INTEGER NOT NULL," \
+    "unit_cents INTEGER NOT NULL," \
+    "PRIMARY KEY (receipt_id, line_no)," \
+    "FOREIGN KEY (receipt_id) REFERENCES receipts(id)," \
+    "FOREIGN KEY (sale_id) REFERENCES sales(id)) WITHOUT ROWID;"
+
+// Daily rollups of sales, so totals never scan the sales table: per product, and
+// across all products so a month or a year is at most 31 or 366 rows
+#define SQL_CREATE_SALES_DAILY \
+    "CREATE TABLE IF NOT EXISTS sales_daily (" \
+    "day TEXT NOT NULL," \
+    "product_id INTEGER NOT NULL," \
+    "units INTEGER NOT NULL DEFAULT 0," \
+    "revenue_cents INTEGER NOT NULL DEFAULT 0," \
+    "transactions INTEGER NOT NULL DEFAULT 0," \
+    "PRIMARY KEY (day, product_id)) WITHOUT ROWID;" \
+    "CREATE TABLE IF NOT EXISTS sales_daily_totals (" \
+    "day TEXT PRIMARY KEY," \
+    "units INTEGER NOT NULL DEFAULT 0," \
+    "revenue_cents INTEGER NOT NULL DEFAULT 0," \
+    "transactions INTEGER NOT NULL DEFAULT 0) WITHOUT ROWID;"
+
+#define SQL_REBUILD_SALES_DAILY \
+    "DELETE FROM sales_daily;" \
+    "INSERT INTO sales_daily (day, product_id, units, revenue_cents, transactions) " \
+    "SELECT date(sale_date), product_id, SUM(quantity_sold), SUM(total_cents), COUNT(*) " \
+    "FROM sales GROUP BY date(sale_date), product_id;" \
+    "DELETE FROM sales_daily_totals;" \
+    "INSERT INTO sales_daily_totals (day, units, revenue_cents, transactions) " \
+    "SELECT day, SUM(units), SUM(revenue_cents), SUM(transactions) FROM sales_daily GROUP BY day;"
+
+#define SQL_SALES_DAILY_ADD(row) \
+    "INSERT INTO sales_daily (day, product_id, units, revenue_cents, transactions) " \
+    "VALUES (date(" row ".sale_date), " row ".product_id, " row ".quantity_sold, " row ".total_cents, 1) " \
+    "ON CONFLICT (day, product_id) DO UPDATE SET " \
+    "units = units + excluded.units, " \
+    "revenue_cents = revenue_cents + excluded.revenue_cents, " \
+    "transactions = transactions + 1; " \
+    "INSERT INTO sales_daily_totals (day, units, revenue_cents, transactions) " \
+    "VALUES (date(" row ".sale_date), " row ".quantity_sold, " row ".total_cents, 1) " \
+    "ON CONFLICT (day) DO UPDATE SET " \
+    "units = units + excluded.units, " \
+    "revenue_cents = revenue_cents + excluded.revenue_cents, " \
+    "transactions = transactions + 1; "
+
+// A day or a product-day left with no sales loses its row, so the report never lists it as zero
+#define SQL_SALES_DAILY_SUBTRACT(row) \
+    "UPDATE sales_daily SET " \
+    "units = units - " row ".quantity_sold, " \
+    "revenue_cents = revenue_cents - " row ".total_cents, " \
+    "transactions = transactions - 1 " \
+    "WHERE day = date(" row ".sale_date) AND product_id = " row ".product_id; " \
+    "UPDATE sales_daily_totals SET " \
+    "units = units - " row ".quantity_sold, " \
+    "revenue_cents = revenue_cents - " row ".total_cents, " \
+    "transactions = transactions - 1 " \
+    "WHERE day = date(" row ".sale_date); " \
+    "DELETE FROM sales_daily WHERE day = date(" row ".sale_date) AND product_id = " row ".product_id " \
+    "AND transactions = 0; " \
+    "DELETE FROM sales_daily_totals WHERE day = date(" row ".sale_date) AND transactions = 0; "
+
+#define SQL_CREATE_SALES_DAILY_TRIGGERS \
+    "CREATE TRIGGER IF NOT EXISTS sales_daily_ai AFTER INSERT ON sales BEGIN " \
+    SQL_SALES_DAILY_ADD("new") \
+    "END;" \
+    "CREATE TRIGGER IF NOT EXISTS sales_daily_ad AFTER DELETE ON sales BEGIN " \
+    SQL_SALES_DAILY_SUBTRACT("old") \
+    "END;" \
+    "CREATE TRIGGER IF NOT EXISTS sales_daily_au " \
+    "AFTER UPDATE OF product_id, quantity_sold, total_cents, sale_date ON sales BEGIN " \
+    SQL_SALES_DAILY_SUBTRACT("old") \
+    SQL_SALES_DAILY_ADD("new") \
+    "END;"
+
+// Triggers from before zero rows were removed, and the rows they left behind
+#define SQL_DROP_SALES_DAILY_TRIGGERS \
+    "DROP TRIGGER IF EXISTS sales_daily_ai;" \
+    "DROP TRIGGER IF EXISTS sales_daily_ad;" \
+    "DROP TRIGGER IF EXISTS sales_daily_au;"
+#define SQL_PRUNE_SALES_DAILY \
+    "DELETE FROM sales_daily WHERE transactions = 0;" \
+    "DELETE FROM sales_daily_totals WHERE transactions = 0;"
+
+// External-content trigram index over products.name, kept in sync by triggers
+#define SQL_CREATE_PRODUCTS_FTS \
+    "CREATE VIRTUAL TABLE products_fts USING fts5(" \
+    "name, content='products', content_rowid='id', tokenize='trigram');"
+
+#define SQL_REBUILD_PRODUCTS_FTS \
+    "INSERT INTO products_fts(products_fts) VALUES ('rebuild')"
+
+#define SQL_CREATE_PRODUCTS_FTS_TRIGGERS \
+    "CREATE TRIGGER IF NOT EXISTS products_fts_ai AFTER INSERT ON products BEGIN " \
+    "  INSERT INTO products_fts(rowid, name) VALUES (new.id, new.name); " \
+    "END;" \
+    "CREATE TRIGGER IF NOT EXISTS products_fts_ad AFTER DELETE ON products BEGIN " \
+    "  INSERT INTO products_fts(products_fts, rowid, name) VALUES ('delete', old.id, old.name); " \
+    "END;" \
+    "CREATE TRIGGER IF NOT EXISTS products_fts_au AFTER UPDATE OF name ON products BEGIN " \
+    "  INSERT INTO products_fts(products_fts, rowid, name) VALUES ('delete', old.id, old.name); " \
+    "  INSERT INTO products_fts(rowid, name) VALUES (new.id, new.name); " \
+    "END;"
+
+// Secondary indexes. Each definition is compared with the one stored in the database,
+// so editing it here rebuilds the index at the next start, and any idx_ index no longer
+// listed is dropped. Write them exactly as SQLite stores them: CREATE INDEX without IF NOT EXISTS.
+typedef struct {
+    const char* name;
+    const char* sql;
+} IndexDefinition;
+
+static const IndexDefinition g_indexes[] = {
+    // sales.product_id foreign key, and one product's sales in date order
+    { "idx_sales_product", "CREATE INDEX idx_sales_product ON sales (product_id, sale_date)" },
+    // Date range totals read from the index alone
+    { "idx_sales_date", "CREATE INDEX idx_sales_date ON sales (sale_date, quantity_sold, total_cents)" },
+    // sale_lines.sale_id foreign key: the receipt a sale belongs to
+    { "idx_sale_lines_sale", "CREATE INDEX idx_sale_lines_sale ON sale_lines (sale_id)" }
+};
+
+#define INDEX_COUNT ((int)(sizeof(g_indexes) / sizeof(g_indexes[0])))
+
+// Creates missing indexes, rebuilds changed ones and drops retired ones in one transaction.
+// Returns SQLITE_OK or the first error.
+static inline int EnsureIndexes(sqlite3* conn) {
+    sqlite3_str* ddl = sqlite3_str_new(conn);
+    sqlite3_stmt* stmt;
+    int current[INDEX_COUNT];
+    char* sql;
+    int i, rc;
+
+    memset(current, 0, sizeof(current));
+    rc = sqlite3_prepare_v2(conn, "SELECT name, sql FROM sqlite_master "
+                            "WHERE type = 'index' AND name LIKE 'idx\\_%' ESCAPE '\\'", -1, &stmt, NULL);
+    while (rc == SQLITE_OK && sqlite3_step(stmt) == SQLITE_ROW) {
+        const char* name = (const char*)sqlite3_column_text(stmt, 0);
+        const char* text = (const char*)sqlite3_column_text(stmt, 1);
+
+        for (i = 0; i < INDEX_COUNT; i++) {
+            if (strcmp(name, g_indexes[i].name) == 0) {
+                break;
+            }
+        }
+        if (i < INDEX_COUNT && text && strcmp(text, g_indexes[i].sql) == 0) {
+            current[i] = 1;
+        } else {
+            sqlite3_str_appendf(ddl, "DROP INDEX \"%w\";", name);
+        }
+    }
+    sqlite3_finalize(stmt);
+
+    for (i = 0; i < INDEX_COUNT; i++) {
+        if (!current[i]) {
+            sqlite3_str_appendf(ddl, "%s;", g_indexes[i].sql);
+        }
+    }
+
+    sql = sqlite3_str_finish(ddl);
+    if (rc == SQLITE_OK && sql) {
+        rc = sqlite3_exec(conn, "BEGIN", NULL, NULL, NULL);
+        if (rc == SQLITE_OK) {
+            rc = sqlite3_exec(conn, sql, NULL, NULL, NULL);
+            if (rc == SQLITE_OK) {
+                rc = sqlite3_exec(conn, "COMMIT", NULL, NULL, NULL);
+            }
+            if (rc != SQLITE_OK) {
+                sqlite3_exec(conn, "ROLLBACK", NULL, NULL, NULL);
+            }
+        }
+    }
+    sqlite3_free(sql);
+    return rc;
+}
+
+#endif
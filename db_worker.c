@@ -0,0 +1,309 @@
+/*
+ * Database worker and report readers, see db_worker.h
+ */
+
+#include <stdlib.h>
+#include "db_worker.h"
+
+// The next work item in submission order, waiting up to timeoutMs for one to arrive. NULL on
+// timeout, on a spurious wake, or once stopping with the queue drained.
+static DbWork* DbWorker_Next(DbWorker* worker, int timeoutMs) {
+    DbWork* work = worker->carried;
+    MpscNode* node;
+
+    if (work) {
+        worker->carried = NULL;
+        return work;
+    }
+
+    node = MpscQueue_Pop(&worker->queue);
+    if (!node && timeoutMs != 0 && !__atomic_load_n(&worker->stopping, __ATOMIC_SEQ_CST)) {
+        // Announce the sleep before the last look, so a producer it misses signals
+        MpscQueue_Sleep(&worker->queue);
+        node = MpscQueue_Pop(&worker->queue);
+        if (!node) {
+            ShimMonitor_Enter(worker->wake);
+            if (!worker->signaled && !worker->stopping) {
+                ShimMonitor_Wait(worker->wake, timeoutMs);
+            }
+            worker->signaled = 0;
+            ShimMonitor_Leave(worker->wake);
+            node = MpscQueue_Pop(&worker->queue);
+        }
+        MpscQueue_Awake(&worker->queue);
+    }
+    return (DbWork*)node;
+}
+
+// After popping a mutation: gather the mutations already queued behind it and those that
+// arrive within the group commit window, up to the batch size. Anything else ends the batch
+// and runs next, so work still runs in the order it was submitted.
+static int DbWorker_CollectMutations(DbWorker* worker, DbWork** batch) {
+    int count = 1;
+    unsigned long long deadline = Shim_NowMs() + worker->groupCommitMs;
+
+    while (count < worker->groupCommitBatch) {
+        unsigned long long now = Shim_NowMs();
+        DbWork* work = DbWorker_Next(worker, now < deadline ? (int)(deadline - now) : 0);
+
+        if (!work) {
+            break;
+        }
+        if (!work->mutation) {
+            worker->carried = work;
+            break;
+        }
+        batch[count++] = work;
+    }
+    return count;
+}
+
+static void ClearChanges(ChangeLog* log) {
+    log->count = 0;
+    log->overflow = 0;
+}
+
+// Queued mutations share one write transaction and one COMMIT; each runs under its own savepoint
+// so one that fails, a duplicate name or a sale short of stock, fails alone. None is acknowledged
+// before the COMMIT.
+static void DbWorker_RunBatch(DbWorker* worker, DbWork** batch, int count) {
+    int i;
+
+    // IMMEDIATE takes the write lock up front, so a second terminal waits here rather than failing at COMMIT
+    if (StmtCache_Exec(&worker->stmts, "BEGIN IMMEDIATE") != SQLITE_OK) {
+        for (i = 0; i < count; i++) {
+            batch[i]->error = "Failed to update inventory.";
+        }
+        return;
+    }
+
+    for (i = 0; i < count; i++) {
+        DbWork* work = batch[i];
+
+        ClearChanges(&worker->changes);
+        if (StmtCache_Exec(&worker->stmts, "SAVEPOINT mutation") == SQLITE_OK) {
+            worker->mutate(worker, work);
+            if (!work->ok) {
+                StmtCache_Exec(&worker->stmts, "ROLLBACK TO mutation");
+            }
+            StmtCache_Exec(&worker->stmts, "RELEASE mutation");
+        } else {
+            work->ok = 0;
+            work->error = "Failed to update inventory.";
+        }
+        if (work->ok) {
+            work->changes = worker->changes;
+        }
+    }
+    ClearChanges(&worker->changes);
+
+    if (StmtCache_Exec(&worker->stmts, "COMMIT") != SQLITE_OK) {
+        StmtCache_Exec(&worker->stmts, "ROLLBACK");
+        for (i = 0; i < count; i++) {
+            batch[i]->ok = 0;
+            batch[i]->error = "Failed to save changes.";
+            ClearChanges(&batch[i]->changes);
+        }
+        return;
+    }
+    worker->commits++;
+}
+
+static void DbWorker_Main(void* param) {
+    DbWorker* worker = (DbWorker*)param;
+    DbWork* batch[GROUP_COMMIT_MAX_BATCH];
+
+    for (;;) {
+        int count = 1;
+
+        // Drain the queue before honouring a stop so no commit is lost
+        DbWork* work = DbWorker_Next(worker, SHIM_WAIT_FOREVER);
+        if (!work) {
+            if (__atomic_load_n(&worker->stopping, __ATOMIC_SEQ_CST)) {
+                break;
+            }
+            continue;
+        }
+
+        batch[0] = work;
+        if (work->mutation) {
+            count = DbWorker_CollectMutations(worker, batch);
+            DbWorker_RunBatch(worker, batch, count);
+        } else {
+            ClearChanges(&worker->changes);
+            if (!worker->run(worker, work)) {
+                continue;
+            }
+            work->changes = worker->changes;
+        }
+
+        for (int i = 0; i < count; i++) {
+            worker->done(batch[i]);
+        }
+    }
+}
+
+int DbWorker_Start(DbWorker* worker, const char* path, const PragmaProfile* profile) {
+    if (sqlite3_open_v2(path, &worker->conn, SQLITE_OPEN_READWRITE, NULL) != SQLITE_OK) {
+        sqlite3_close(worker->conn);
+        worker->conn = NULL;
+        return 0;
+    }
+    sqlite3_busy_timeout(worker->conn, DB_BUSY_TIMEOUT_MS);
+    ApplyPragmaProfile(worker->conn, profile);
+    worker->stmts.conn = worker->conn;
+    InstallChangeHooks(worker->conn, &worker->changes);
+    if (worker->groupCommitBatch < 1) {
+        worker->groupCommitBatch = GROUP_COMMIT_DEFAULT_BATCH;
+    } else if (worker->groupCommitBatch > GROUP_COMMIT_MAX_BATCH) {
+        worker->groupCommitBatch = GROUP_COMMIT_MAX_BATCH;
+    }
+
+    MpscQueue_Init(&worker->queue);
+    worker->carried = NULL;
+    worker->signaled = 0;
+    worker->stopping = 0;
+    worker->commits = 0;
+
+    worker->wake = ShimMonitor_Create();
+    worker->thread = worker->wake ? ShimThread_Start(DbWorker_Main, worker) : NULL;
+    if (!worker->thread) {
+        ShimMonitor_Free(worker->wake);
+        worker->wake = NULL;
+        StmtCache_Finalize(&worker->stmts);
+        sqlite3_close(worker->conn);
+        worker->conn = NULL;
+        return 0;
+    }
+    return 1;
+}
+
+// Sets wake for a worker that is asleep or about to be
+static void DbWorker_Signal(DbWorker* worker) {
+    ShimMonitor_Enter(worker->wake);
+    worker->signaled = 1;
+    ShimMonitor_Wake(worker->wake);
+    ShimMonitor_Leave(worker->wake);
+}
+
+void DbWorker_Submit(DbWorker* worker, DbWork* work) {
+    if (MpscQueue_Push(&worker->queue, &work->node)) {
+        DbWorker_Signal(worker);
+    }
+}
+
+void DbWorker_Stop(DbWorker* worker) {
+    if (!worker->thread) {
+        return;
+    }
+
+    __atomic_store_n(&worker->stopping, 1, __ATOMIC_SEQ_CST);
+    DbWorker_Signal(worker);
+
+    ShimThread_Join(worker->thread);
+    worker->thread = NULL;
+
+    ShimMonitor_Free(worker->wake);
+    worker->wake = NULL;
+    StmtCache_Finalize(&worker->stmts);
+    sqlite3_close(worker->conn);
+    worker->conn = NULL;
+}
+
+static void DbReader_Main(void* param) {
+    DbReader* reader = (DbReader*)param;
+    DbReaderPool* pool = reader->pool;
+
+    for (;;) {
+        DbWork* work;
+
+        ShimMonitor_Enter(pool->wake);
+        while (!pool->head && !pool->stopping) {
+            ShimMonitor_Wait(pool->wake, SHIM_WAIT_FOREVER);
+        }
+        work = pool->head;
+        if (work) {
+            pool->head = work->next;
+            if (!pool->head) {
+                pool->tail = NULL;
+            }
+        }
+        ShimMonitor_Leave(pool->wake);
+
+        if (!work) {
+            break;
+        }
+        pool->read(reader, work);
+        pool->done(work);
+    }
+}
+
+int DbReaders_Start(DbReaderPool* pool, const char* path, const PragmaProfile* profile, int count) {
+    pool->head = pool->tail = NULL;
+    pool->stopping = 0;
+    pool->count = 0;
+    pool->wake = ShimMonitor_Create();
+    if (!pool->wake) {
+        return 0;
+    }
+
+    while (pool->count < count && pool->count < DB_MAX_READERS) {
+        DbReader* reader = &pool->readers[pool->count];
+
+        if (OpenReadConnection(path, profile, &reader->conn) != SQLITE_OK) {
+            break;
+        }
+        reader->pool = pool;
+        reader->stmts.conn = reader->conn;
+        reader->thread = ShimThread_Start(DbReader_Main, reader);
+        if (!reader->thread) {
+            sqlite3_close(reader->conn);
+            reader->conn = NULL;
+            break;
+        }
+        pool->count++;
+    }
+    return pool->count;
+}
+
+int DbReaders_Submit(DbReaderPool* pool, DbWork* work) {
+    if (pool->count == 0) {
+        return 0;
+    }
+
+    work->next = NULL;
+    ShimMonitor_Enter(pool->wake);
+    if (pool->tail) {
+        pool->tail->next = work;
+    } else {
+        pool->head = work;
+    }
+    pool->tail = work;
+    ShimMonitor_Wake(pool->wake);
+    ShimMonitor_Leave(pool->wake);
+    return 1;
+}
+
+void DbReaders_Stop(DbReaderPool* pool) {
+    if (!pool->wake) {
+        return;
+    }
+
+    ShimMonitor_Enter(pool->wake);
+    pool->stopping = 1;
+    ShimMonitor_WakeAll(pool->wake);
+    ShimMonitor_Leave(pool->wake);
+
+    for (int i = 0; i < pool->count; i++) {
+        DbReader* reader = &pool->readers[i];
+
+        ShimThread_Join(reader->thread);
+        reader->thread = NULL;
+        StmtCache_Finalize(&reader->stmts);
+        sqlite3_close(reader->conn);
+        reader->conn = NULL;
+    }
+    pool->count = 0;
+    ShimMonitor_Free(pool->wake);
+    pool->wake = NULL;
+}
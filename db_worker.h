@@ -0,0 +1,107 @@
+/*
+ * Database worker: the only writer, and the pool of report readers
+ * The worker owns the write connection and runs queued work on its own thread. Work arrives
+ * through the lock-free queue in mpsc_queue.h, so any thread can submit without blocking.
+ * Mutations queued together share one transaction and one COMMIT, each under its own
+ * savepoint; finished work is handed back through a callback once its COMMIT is done.
+ * What the work does is up to the callbacks, so the GUI, the tests and the benchmarks all
+ * run the same queue, batching and commit logic. Threads come from thread_shim.h.
+ */
+
+#ifndef DB_WORKER_H
+#define DB_WORKER_H
+
+#include <sqlite3.h>
+#include "mpsc_queue.h"
+#include "change_log.h"
+#include "stmt_cache.h"
+#include "db_profiles.h"
+#include "thread_shim.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define GROUP_COMMIT_MAX_BATCH 256
+#define GROUP_COMMIT_DEFAULT_BATCH 64
+
+#define DB_MAX_READERS 8
+
+// Header of every queued request; the caller's request type starts with it
+typedef struct DbWork {
+    MpscNode node;          // first: the queue links work through it
+    struct DbWork* next;    // DbReaderPool queue
+    int mutation;           // batched with the mutations queued next to it
+    int ok;
+    const char* error;
+    ChangeLog changes;      // rows the work committed
+} DbWork;
+
+typedef struct DbWorker DbWorker;
+
+struct DbWorker {
+    // Set before DbWorker_Start. mutate runs one mutation inside its savepoint and sets
+    // work->ok; run runs anything else and returns 0 if it kept the work, to finish it
+    // elsewhere; done gets each finished work item on the worker thread.
+    void (*mutate)(DbWorker* worker, DbWork* work);
+    int (*run)(DbWorker* worker, DbWork* work);
+    void (*done)(DbWork* work);
+    int groupCommitMs;      // 0 batches only what is already queued
+    int groupCommitBatch;   // mutations per commit at most, 0 for GROUP_COMMIT_DEFAULT_BATCH
+
+    ShimThread* thread;
+    ShimMonitor* wake;
+    int signaled;           // a producer saw the worker going to sleep, under wake
+    MpscQueue queue;
+    DbWork* carried;        // popped while collecting a batch, runs next
+    int stopping;
+    sqlite3* conn;
+    StatementCache stmts;
+    ChangeLog changes;      // filled by the update hook while work runs
+    long commits;           // mutation batches committed
+};
+
+// Opens the write connection on path with profile and starts the thread. Returns 0 on failure.
+int DbWorker_Start(DbWorker* worker, const char* path, const PragmaProfile* profile);
+// Safe from any thread and never blocks. Completion is the done callback, after the COMMIT.
+void DbWorker_Submit(DbWorker* worker, DbWork* work);
+// Runs everything already queued, then stops the thread and closes the connection
+void DbWorker_Stop(DbWorker* worker);
+
+// Report reads: read-only connections, each on its own thread. Under WAL a reader works
+// from a snapshot, so a long report neither waits for the worker's commits nor holds them up.
+struct DbReaderPool;
+
+typedef struct {
+    struct DbReaderPool* pool;
+    ShimThread* thread;
+    sqlite3* conn;
+    StatementCache stmts;
+} DbReader;
+
+typedef struct DbReaderPool {
+    // Set before DbReaders_Start: read runs one work item on a reader's connection and sets
+    // work->ok, then done gets it on that reader's thread
+    void (*read)(DbReader* reader, DbWork* work);
+    void (*done)(DbWork* work);
+
+    ShimMonitor* wake;
+    DbWork* head;
+    DbWork* tail;
+    int stopping;
+    int count;              // 0 when reports are read on the worker's connection
+    DbReader readers[DB_MAX_READERS];
+} DbReaderPool;
+
+// Opens up to count read-only connections. Returns how many readers are running, 0 when
+// the database is not in WAL mode; reports then stay on the worker's connection.
+int DbReaders_Start(DbReaderPool* pool, const char* path, const PragmaProfile* profile, int count);
+// Queues a report read. Returns 0 if there are no readers, so the caller reads it itself.
+int DbReaders_Submit(DbReaderPool* pool, DbWork* work);
+void DbReaders_Stop(DbReaderPool* pool);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -7,12 +7,25 @@
 
 #include <windows.h>
 #include <commctrl.h>
+#include <commdlg.h>
 #include <sqlite3.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "db_profiles.h"
+#include "db_schema.h"
+#include "db_queries.h"
+#include "workload.h"
+#include "money.h"
+#include "product_import.h"
+#include "sales_mirror.h"
+#include "product_cache.h"
+#include "change_log.h"
+#include "stmt_cache.h"
+#include "db_worker.h"
 
 #pragma comment(lib, "comctl32.lib")
+#pragma comment(lib, "comdlg32.lib")
 
 // Control IDs
 #define ID_LISTVIEW_PRODUCTS 1001
@@ -26,6 +39,30 @@
 #define ID_BTN_SEARCH 1009
 #define ID_EDIT_SEARCH 1010
 #define ID_TAB_CONTROL 1011
+#define ID_LISTVIEW_CART 1012
+#define ID_BTN_ADD_TO_CART 1013
+#define ID_BTN_CART_REMOVE 1014
+#define ID_BTN_CART_CLEAR 1015
+#define ID_BTN_CHECKOUT 1016
+#define ID_LISTVIEW_SALES_SUMMARY 1017
+#define ID_CHK_SALES_SUMMARY 1018
+#define ID_BTN_IMPORT 1019
+#define ID_LISTVIEW_SALES_BY_PRODUCT 1020
+#define ID_CHK_SALES_BY_PRODUCT 1021
+
+// Timers
+#define IDT_SEARCH_DEBOUNCE 1
+#define SEARCH_DEBOUNCE_MS 150
+#define IDT_SALES_BY_PRODUCT 2
+#define SALES_BY_PRODUCT_REFRESH_MS 1000
+
+// Application messages
+#define WM_APP_DB_RESULT (WM_APP + 1)
+
+#define DB_FILENAME "inventory.db"
+#define DB_CONFIG_FILENAME "inventory.ini"
+// Stored in PRAGMA user_version; bump it together with a new entry in g_migrations
+#define DB_SCHEMA_VERSION 6
 
 // Dialog control IDs
 #define IDC_EDIT_NAME 2001
@@ -37,9 +74,16 @@
 
 // Global variables
 HWND hListViewProducts, hListViewSales, hTabControl;
-HWND hEditSearch;
+HWND hEditSearch, hStatusBar, hBtnImport;
+HWND hListViewCart, hCartTotal, hBtnCartRemove, hBtnCartClear, hBtnCheckout;
+HWND hListViewSalesSummary, hChkSalesSummary;
+HWND hListViewSalesByProduct, hChkSalesByProduct;
 sqlite3 *db;
 HINSTANCE hInst;
+HWND g_hMainWnd = NULL;
+int g_ftsAvailable = 0;
+ULONGLONG g_startupMs = 0;
+const PragmaProfile* g_pragmaProfile = NULL;
 HWND g_hCurrentDialog = NULL;
 int g_dialogResult = 0;
 HWND g_hEditName = NULL;
@@ -74,20 +118,192 @@ LRESULT CALLBACK DialogProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
 typedef struct {
     char name[256];
     int quantity;
-    double price;
+    Money price;
     int productId;
     int isUpdate;
 } ProductDialogData;
 
 typedef struct {
     int quantity;
-    double price;
+    Money price;
     char productName[256];
 } PurchaseDialogData;
 
 ProductDialogData g_productData = {0};
 PurchaseDialogData g_purchaseData = {0};
 
+// Owner-data product list and the last search, see product_cache.h
+ProductRowCache g_productCache = {0};
+SearchResults g_searchResults = {0};
+
+// Sales Report paging: newest first, keyset on sales.id. Pages are read on
+// the database worker and the next one is read ahead of the scroll position.
+#define SALES_PAGE_SIZE 200
+
+typedef struct {
+    int id;
+    int quantitySold;
+    Money totalAmount;
+    char productName[256];
+    char saleDate[32];
+} SalesRow;
+
+typedef struct {
+    int generation;         // LoadSales() call this page belongs to
+    sqlite3_int64 beforeId; // 0 for the first page
+    int dataVersion;        // worker connection's data_version before the read
+    int count;
+    SalesRow rows[SALES_PAGE_SIZE];
+} SalesPage;
+
+typedef struct {
+    int generation;
+    sqlite3_int64 lastSeenId;
+    int exhausted;
+    int loaded;             // the newest page is on screen
+    int wantMore;           // user reached the end before the prefetch arrived
+    int appending;          // rows are being inserted, ignore list notifications
+    int prefetchPending;    // a page read is queued on the database worker
+    int dataVersion;        // of the newest page, see ShowSalesReport
+    sqlite3_int64 newestId; // newest sale in the list
+    SalesPage* prefetched;
+} SalesPager;
+
+SalesPager g_salesPager = {0};
+
+// Sales Report summary mode: one row per day, read from the sales_daily rollup
+// instead of the sales table, so it costs the same at any number of sales
+#define SALES_SUMMARY_DAYS 366
+
+typedef struct {
+    char day[16];
+    int transactions;
+    int units;
+    Money revenue;
+} SalesDayRow;
+
+typedef struct {
+    int generation;         // LoadSalesSummary() call this summary belongs to
+    int dataVersion;        // worker connection's data_version before the read
+    sqlite3_int64 maxSaleId; // newest sale the rows include
+    int count;
+    SalesDayRow rows[SALES_SUMMARY_DAYS];
+} SalesSummary;
+
+typedef struct {
+    int enabled;            // "Daily totals" is checked
+    int generation;
+    int loaded;             // the summary is on screen and can be patched
+    int pending;            // a summary read is queued on the database worker
+    int dataVersion;
+} SalesSummaryView;
+
+SalesSummaryView g_salesSummary = {0};
+
+// Sales Report by product: best sellers over the summary's days, summed from an in-memory
+// mirror of the sales columns instead of a GROUP BY over the sales table. Optional, see
+// sales_mirror in inventory.ini, since the mirror holds every sale.
+#define SALES_BY_PRODUCT_ROWS 500
+
+typedef struct {
+    int available;          // sales_mirror=1 in inventory.ini
+    int enabled;            // "By product" is checked
+    int loaded;             // the mirror holds every sale up to mirror.lastId
+    int pending;            // the mirror is being read on the database worker or a reader
+    int refreshQueued;      // IDT_SALES_BY_PRODUCT is set
+    int naming;             // a DBJOB_SALES_BY_PRODUCT_NAMES job is out
+    int stale;              // sales were committed while it was out
+    SalesMirror mirror;     // the UI thread's once loaded
+} SalesByProductView;
+
+typedef struct {
+    int32_t productId;
+    SalesMirrorTotals totals;
+} SalesByProductRow;
+
+// The best sellers as shown: ranked on the UI thread from the mirror, then named by a report
+// job, so painting the list runs no SQL
+typedef struct {
+    SalesMirrorTotals all;
+    int count;
+    SalesByProductRow rows[SALES_BY_PRODUCT_ROWS];
+    char names[SALES_BY_PRODUCT_ROWS][256];
+} SalesByProductList;
+
+SalesByProductView g_salesByProduct = {0};
+
+StatementCache g_stmtCache = {0};    // UI thread's connection
+
+// Checkout cart: lines collected in memory, committed together as one receipt
+#define CART_MAX_LINES 100
+
+typedef struct {
+    int productId;
+    char name[256];
+    int quantity;
+    Money unitPrice;        // as listed; checkout charges the price in the database
+} CartLine;
+
+typedef struct {
+    CartLine lines[CART_MAX_LINES];
+    int count;
+    int checkingOut;        // a checkout job is in flight, the cart is read-only
+} Cart;
+
+Cart g_cart = {0};
+
+// Requests for the database worker in db_worker.h. Each finished job is posted
+// back with WM_APP_DB_RESULT, so WndProc never waits on a commit or a long read.
+typedef enum {
+    DBJOB_ADD_PRODUCT,
+    DBJOB_UPDATE_PRODUCT,
+    DBJOB_DELETE_PRODUCT,
+    DBJOB_PURCHASE,
+    DBJOB_SALES_PAGE,
+    DBJOB_SALES_SUMMARY,
+    DBJOB_CHECKOUT,
+    DBJOB_DATA_VERSION,
+    DBJOB_IMPORT_PRODUCTS,
+    DBJOB_LOAD_SALES_MIRROR,
+    DBJOB_SALES_BY_PRODUCT_NAMES
+} DbJobType;
+
+typedef struct DbJob {
+    DbWork work;            // first: queued through it; ok, error and changes come back in it
+    DbJobType type;
+
+    // Request
+    int productId;
+    char name[256];
+    int quantity;
+    Money price;            // purchases: unit price read back by the stock update
+    SalesPage* page;        // DBJOB_SALES_PAGE: beforeId in, rows out
+    SalesSummary* summary;  // DBJOB_SALES_SUMMARY: rows out
+    CartLine* lines;        // DBJOB_CHECKOUT: owned copy of the cart
+    int lineCount;
+    char* path;             // DBJOB_IMPORT_PRODUCTS: owned copy of the file name
+    SalesMirror* mirror;    // DBJOB_LOAD_SALES_MIRROR: every sale out
+    SalesByProductList* byProduct;  // DBJOB_SALES_BY_PRODUCT_NAMES: ranked rows in, names out
+
+    // Result
+    Money total;
+    sqlite3_int64 receiptId;
+    int failedLine;         // checkout line that was short of stock, or -1
+    int failedMissing;      // the failed line's product was deleted rather than short
+    int dataVersion;        // DBJOB_DATA_VERSION: worker connection's data_version, or -1
+    ProductImportResult imported;
+    DWORD elapsedMs;        // DBJOB_IMPORT_PRODUCTS: time the import held the worker
+} DbJob;
+
+// The only writer; runs jobs with RunMutation and RunDbJob
+DbWorker g_dbWorker = {0};
+
+// Report reads on read-only connections; the worker hands report jobs over after stamping them
+#define DB_DEFAULT_READERS 2
+
+DbReaderPool g_dbReaders = {0};
+
+
 LRESULT CALLBACK WndProc(HWND, UINT, WPARAM, LPARAM);
 INT_PTR CALLBACK ProductDialogProc(HWND, UINT, WPARAM, LPARAM);
 INT_PTR CALLBACK PurchaseDialogProc(HWND, UINT, WPARAM, LPARAM);
@@ -123,15 +339,54 @@ LRESULT CALLBACK SimpleDialogProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lPa
 }
 
 void InitDatabase();
+int GetConfigPath(char* path);
+const PragmaProfile* LoadPragmaProfile();
+void LoadGroupCommitSettings(DbWorker* worker);
+sqlite3_stmt* AcquireStatement(const char* sql);
+void ReleaseStatement(sqlite3_stmt* stmt);
+void FinalizeStatementCache();
+void UpdateStatusBar();
+int MigrateMoneyColumns();
+int CreateSearchIndex();
+int CreateSalesRollup();
 void InsertSampleData();
 void CreateControls(HWND hwnd);
 void LoadProducts();
+void ApplyChanges(ChangeLog* log);
+DbJob* NewDbJob(DbJobType type);
+void RunMutation(DbWorker* worker, DbWork* work);
+int RunDbJob(DbWorker* worker, DbWork* work);
+void ReadDbJob(DbReader* reader, DbWork* work);
+void PostDbJob(DbWork* work);
+int LoadReadConnections();
+int LoadSalesMirrorSetting();
+void OnDbJobDone(DbJob* job);
 void LoadSales();
+void LoadSalesSummary();
+void OnSalesSummaryLoaded(SalesSummary* summary, int ok);
+void OnDataVersionChecked(int dataVersion, int ok);
+void RefreshSalesDay(sqlite3_int64 saleId);
+void LoadSalesMirror();
+void CatchUpSalesMirror();
+void OnSalesMirrorLoaded(SalesMirror* mirror, int ok);
+void RefreshSalesByProduct();
+void QueueSalesByProductRefresh();
+void OnSalesByProductNamed(SalesByProductList* list, int ok);
+void LoadMoreSales();
+void ShutdownSalesPager();
 void AddProduct(HWND hwnd);
 void UpdateProduct(HWND hwnd);
 void DeleteProduct(HWND hwnd);
 void PurchaseProduct(HWND hwnd);
+void AddToCart(HWND hwnd);
+void RemoveCartLine(HWND hwnd);
+void ClearCart(HWND hwnd);
+void Checkout(HWND hwnd);
+void ImportProducts(HWND hwnd);
+void RefreshCart();
+void ShowTab(int tabIndex);
 void SearchProducts(HWND hwnd);
+void OnSearchTextChanged(HWND hwnd);
 void ShowError(const char* message);
 void ShowSuccess(const char* message);
 
@@ -142,12 +397,26 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance,
     // Initialize common controls
     INITCOMMONCONTROLSEX icex;
     icex.dwSize = sizeof(INITCOMMONCONTROLSEX);
-    icex.dwICC = ICC_LISTVIEW_CLASSES | ICC_TAB_CLASSES;
+    icex.dwICC = ICC_LISTVIEW_CLASSES | ICC_TAB_CLASSES | ICC_BAR_CLASSES;
     InitCommonControlsEx(&icex);
 
     // Initialize database
     InitDatabase();
 
+    g_dbWorker.mutate = RunMutation;
+    g_dbWorker.run = RunDbJob;
+    g_dbWorker.done = PostDbJob;
+    LoadGroupCommitSettings(&g_dbWorker);
+    if (!DbWorker_Start(&g_dbWorker, DB_FILENAME, g_pragmaProfile)) {
+        MessageBox(NULL, "Cannot start database worker", "Error", MB_OK | MB_ICONERROR);
+        return 0;
+    }
+    // Without readers, reports are read on the worker's connection as before
+    g_dbReaders.read = ReadDbJob;
+    g_dbReaders.done = PostDbJob;
+    DbReaders_Start(&g_dbReaders, DB_FILENAME, g_pragmaProfile, LoadReadConnections());
+    g_salesByProduct.available = LoadSalesMirrorSetting();
+
     // Register window class
     WNDCLASSEX wc = {0};
     wc.cbSize = sizeof(WNDCLASSEX);
@@ -190,73 +459,404 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance,
         DispatchMessage(&msg);
     }
 
+    // Let queued commits finish before the process exits; the worker may still hand reads over
+    DbWorker_Stop(&g_dbWorker);
+    DbReaders_Stop(&g_dbReaders);
+    ShutdownSalesPager();
+    SalesMirror_Free(&g_salesByProduct.mirror);
+    ProductCache_Free(&g_productCache);
+    SearchResults_Free(&g_searchResults);
+    FinalizeStatementCache();
     sqlite3_close(db);
     return msg.wParam;
 }
 
+// Shorthands for the UI thread's connection
+sqlite3_stmt* AcquireStatement(const char* sql) {
+    return StmtCache_Acquire(&g_stmtCache, sql);
+}
+
+void ReleaseStatement(sqlite3_stmt* stmt) {
+    StmtCache_Release(&g_stmtCache, stmt);
+}
+
+void FinalizeStatementCache() {
+    StmtCache_Finalize(&g_stmtCache);
+}
+
+// Add a column if an older database does not have it yet
+static int EnsureColumn(const char* table, const char* column, const char* alterSql) {
+    char sql[256];
+    sqlite3_stmt* stmt;
+
+    snprintf(sql, sizeof(sql), "SELECT %s FROM %s LIMIT 0", column, table);
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, 0) == SQLITE_OK) {
+        sqlite3_finalize(stmt);
+        return 1;
+    }
+    return sqlite3_exec(db, alterSql, 0, 0, 0) == SQLITE_OK;
+}
+
+// Fill an integer money column from its REAL counterpart, a range of ids per
+// transaction so a big table never holds the write lock for long. Rows already
+// converted are skipped, so an interrupted migration simply resumes.
+static int BackfillMoneyColumn(const char* rangeSql, const char* updateSql) {
+    sqlite3_stmt* stmt;
+    sqlite3_int64 minId = 0, maxId = -1;
+    const sqlite3_int64 batch = 10000;
+
+    if (sqlite3_prepare_v2(db, rangeSql, -1, &stmt, 0) != SQLITE_OK) {
+        return 0;
+    }
+    if (sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_type(stmt, 0) != SQLITE_NULL) {
+        minId = sqlite3_column_int64(stmt, 0);
+        maxId = sqlite3_column_int64(stmt, 1);
+    }
+    sqlite3_finalize(stmt);
+
+    if (sqlite3_prepare_v2(db, updateSql, -1, &stmt, 0) != SQLITE_OK) {
+        return 0;
+    }
+
+    int ok = 1;
+    for (sqlite3_int64 from = minId; ok && from <= maxId; from += batch) {
+        sqlite3_exec(db, "BEGIN", 0, 0, 0);
+        sqlite3_bind_int64(stmt, 1, from);
+        sqlite3_bind_int64(stmt, 2, from + batch);
+        ok = sqlite3_step(stmt) == SQLITE_DONE;
+        sqlite3_reset(stmt);
+        sqlite3_exec(db, ok ? "COMMIT" : "ROLLBACK", 0, 0, 0);
+    }
+    sqlite3_finalize(stmt);
+    return ok;
+}
+
+// Move prices and sale totals from REAL columns to integer ngwee. The REAL
+// columns are kept up to date for older builds that still read them.
+int MigrateMoneyColumns() {
+    if (!EnsureColumn("products", "price_cents",
+                      "ALTER TABLE products ADD COLUMN price_cents INTEGER") ||
+        !EnsureColumn("sales", "total_cents",
+                      "ALTER TABLE sales ADD COLUMN total_cents INTEGER")) {
+        return 0;
+    }
+
+    return BackfillMoneyColumn(
+               "SELECT MIN(id), MAX(id) FROM products WHERE price_cents IS NULL",
+               "UPDATE products SET price_cents = CAST(ROUND(price * 100) AS INTEGER) "
+               "WHERE id >= ? AND id < ? AND price_cents IS NULL") &&
+           BackfillMoneyColumn(
+               "SELECT MIN(id), MAX(id) FROM sales WHERE total_cents IS NULL",
+               "UPDATE sales SET total_cents = CAST(ROUND(total_amount * 100) AS INTEGER) "
+               "WHERE id >= ? AND id < ? AND total_cents IS NULL");
+}
+
+// Trigram full-text index over products.name, stored as an external-content
+// table so names are not duplicated. Triggers keep it in step with products.
+int CreateSearchIndex() {
+    sqlite3_stmt* stmt;
+    int exists = 0;
+
+    if (sqlite3_prepare_v2(db, "SELECT 1 FROM sqlite_master WHERE name = 'products_fts'", -1, &stmt, 0) == SQLITE_OK) {
+        exists = sqlite3_step(stmt) == SQLITE_ROW;
+    }
+    sqlite3_finalize(stmt);
+
+    if (!exists) {
+        // Index the existing catalog in the same transaction that creates the table
+        sqlite3_exec(db, "BEGIN", 0, 0, 0);
+        if (sqlite3_exec(db, SQL_CREATE_PRODUCTS_FTS, 0, 0, 0) != SQLITE_OK ||
+            sqlite3_exec(db, SQL_REBUILD_PRODUCTS_FTS, 0, 0, 0) != SQLITE_OK ||
+            sqlite3_exec(db, SQL_CREATE_PRODUCTS_FTS_TRIGGERS, 0, 0, 0) != SQLITE_OK) {
+            sqlite3_exec(db, "ROLLBACK", 0, 0, 0);
+            return 0;
+        }
+        sqlite3_exec(db, "COMMIT", 0, 0, 0);
+        return 1;
+    }
+
+    return sqlite3_exec(db, SQL_CREATE_PRODUCTS_FTS_TRIGGERS, 0, 0, 0) == SQLITE_OK;
+}
+
+// Per-day, per-product sales totals for the Sales Report summary. Built once
+// from the existing sales, then kept current by triggers on sales.
+int CreateSalesRollup() {
+    sqlite3_stmt* stmt;
+    int exists = 0;
+
+    if (sqlite3_prepare_v2(db, "SELECT 1 FROM sqlite_master WHERE name = 'sales_daily'", -1, &stmt, 0) == SQLITE_OK) {
+        exists = sqlite3_step(stmt) == SQLITE_ROW;
+    }
+    sqlite3_finalize(stmt);
+
+    if (!exists) {
+        sqlite3_exec(db, "BEGIN", 0, 0, 0);
+        if (sqlite3_exec(db, SQL_CREATE_SALES_DAILY, 0, 0, 0) != SQLITE_OK ||
+            sqlite3_exec(db, SQL_REBUILD_SALES_DAILY, 0, 0, 0) != SQLITE_OK ||
+            sqlite3_exec(db, SQL_CREATE_SALES_DAILY_TRIGGERS, 0, 0, 0) != SQLITE_OK) {
+            sqlite3_exec(db, "ROLLBACK", 0, 0, 0);
+            return 0;
+        }
+        sqlite3_exec(db, "COMMIT", 0, 0, 0);
+        return 1;
+    }
+
+    return sqlite3_exec(db, SQL_CREATE_SALES_DAILY_TRIGGERS, 0, 0, 0) == SQLITE_OK;
+}
+
+// Rollup triggers that drop a day's or a product's row once its last sale is deleted,
+// replacing ones that left it behind at zero, and the zero rows those left
+static int ReplaceSalesRollupTriggers() {
+    sqlite3_exec(db, "BEGIN", 0, 0, 0);
+    if (sqlite3_exec(db, SQL_DROP_SALES_DAILY_TRIGGERS SQL_CREATE_SALES_DAILY_TRIGGERS
+                         SQL_PRUNE_SALES_DAILY, 0, 0, 0) != SQLITE_OK) {
+        sqlite3_exec(db, "ROLLBACK", 0, 0, 0);
+        return 0;
+    }
+    sqlite3_exec(db, "COMMIT", 0, 0, 0);
+    return 1;
+}
+
+// A bare file name would make the profile API look in the Windows directory
+int GetConfigPath(char* path) {
+    return GetFullPathName(DB_CONFIG_FILENAME, MAX_PATH, path, NULL) != 0;
+}
+
+// Reads [database] profile= from inventory.ini next to the database
+const PragmaProfile* LoadPragmaProfile() {
+    char path[MAX_PATH];
+    char name[64];
+    const PragmaProfile* profile;
+
+    if (!GetConfigPath(path)) {
+        return FindPragmaProfile(DB_DEFAULT_PROFILE);
+    }
+    GetPrivateProfileString("database", "profile", DB_DEFAULT_PROFILE, name, sizeof(name), path);
+
+    profile = FindPragmaProfile(name);
+    if (!profile) {
+        MessageBox(NULL, "Unknown database profile in inventory.ini; using \"" DB_DEFAULT_PROFILE "\".",
+                   "Warning", MB_OK | MB_ICONWARNING);
+        profile = FindPragmaProfile(DB_DEFAULT_PROFILE);
+    }
+    return profile;
+}
+
+// Reads [database] read_connections= from inventory.ini
+int LoadReadConnections() {
+    char path[MAX_PATH];
+    int count;
+
+    if (!GetConfigPath(path)) {
+        return DB_DEFAULT_READERS;
+    }
+    count = GetPrivateProfileInt("database", "read_connections", DB_DEFAULT_READERS, path);
+    if (count < 0) {
+        return 0;
+    }
+    return count > DB_MAX_READERS ? DB_MAX_READERS : count;
+}
+
+// Reads [database] sales_mirror= from inventory.ini
+int LoadSalesMirrorSetting() {
+    char path[MAX_PATH];
+
+    if (!GetConfigPath(path)) {
+        return 0;
+    }
+    return GetPrivateProfileInt("database", "sales_mirror", 0, path) != 0;
+}
+
+// Reads [database] group_commit_ms= and group_commit_batch= from inventory.ini
+void LoadGroupCommitSettings(DbWorker* worker) {
+    char path[MAX_PATH];
+
+    worker->groupCommitMs = 0;
+    worker->groupCommitBatch = GROUP_COMMIT_DEFAULT_BATCH;
+    if (!GetConfigPath(path)) {
+        return;
+    }
+
+    worker->groupCommitMs = GetPrivateProfileInt("database", "group_commit_ms", 0, path);
+    worker->groupCommitBatch = GetPrivateProfileInt("database", "group_commit_batch", GROUP_COMMIT_DEFAULT_BATCH, path);
+    if (worker->groupCommitBatch < 1) {
+        worker->groupCommitBatch = 1;
+    } else if (worker->groupCommitBatch > GROUP_COMMIT_MAX_BATCH) {
+        worker->groupCommitBatch = GROUP_COMMIT_MAX_BATCH;
+    }
+}
+
+static int CreateBaseTables() {
+    return sqlite3_exec(db, SQL_CREATE_PRODUCTS SQL_CREATE_SALES, 0, 0, 0) == SQLITE_OK;
+}
+
+static int CreateReceiptTables() {
+    return sqlite3_exec(db, SQL_CREATE_RECEIPTS SQL_CREATE_SALE_LINES, 0, 0, 0) == SQLITE_OK;
+}
+
+// Whether this build's SQLite has FTS5; without it search falls back to LIKE
+static int HasFts5() {
+    return sqlite3_compileoption_used("ENABLE_FTS5");
+}
+
+// Without FTS5 there is nothing to build, which is not a failed step; InitDatabase
+// builds the index on the first start of a build that has it
+static int CreateOptionalSearchIndex() {
+    return HasFts5() ? CreateSearchIndex() : 1;
+}
+
+// Schema changes in the order they were introduced. Step N brings a database from
+// user_version N-1 to N. Every step copes with a database where it already ran,
+// so one interrupted before its version was recorded is simply repeated.
+typedef struct {
+    const char* name;
+    int (*apply)();
+} SchemaMigration;
+
+static const SchemaMigration g_migrations[DB_SCHEMA_VERSION] = {
+    { "products and sales", CreateBaseTables },
+    { "integer money columns", MigrateMoneyColumns },
+    { "receipts", CreateReceiptTables },
+    { "product search index", CreateOptionalSearchIndex },
+    { "daily sales rollup", CreateSalesRollup },
+    { "empty daily rollup rows", ReplaceSalesRollupTriggers }
+};
+
+static int GetSchemaVersion() {
+    sqlite3_stmt* stmt;
+    int version = -1;
+
+    if (sqlite3_prepare_v2(db, "PRAGMA user_version", -1, &stmt, 0) == SQLITE_OK &&
+        sqlite3_step(stmt) == SQLITE_ROW) {
+        version = sqlite3_column_int(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+    return version;
+}
+
+// Runs the steps above the stored version. Returns the version found before
+// migrating, or -1 after reporting a failed step.
+static int MigrateSchema() {
+    char sql[64];
+    int version = GetSchemaVersion();
+    int from = version;
+
+    if (version < 0) {
+        MessageBox(NULL, sqlite3_errmsg(db), "Database Error", MB_OK | MB_ICONERROR);
+        return -1;
+    }
+
+    for (; version < DB_SCHEMA_VERSION; version++) {
+        const SchemaMigration* step = &g_migrations[version];
+        if (!step->apply()) {
+            char message[512];
+            snprintf(message, sizeof(message), "Cannot upgrade the database (%s):\n%s",
+                     step->name, sqlite3_errmsg(db));
+            MessageBox(NULL, message, "Database Error", MB_OK | MB_ICONERROR);
+            return -1;
+        }
+        snprintf(sql, sizeof(sql), "PRAGMA user_version = %d", version + 1);
+        sqlite3_exec(db, sql, 0, 0, 0);
+    }
+    return from;
+}
+
+// The search table may exist in a database last opened by a build with FTS5
+static int HasSearchIndex() {
+    sqlite3_stmt* stmt;
+    int ok = sqlite3_prepare_v2(db, "SELECT rowid FROM products_fts LIMIT 0", -1, &stmt, 0) == SQLITE_OK;
+    sqlite3_finalize(stmt);
+    return ok;
+}
+
+// After a failed migration or index step, already reported: the schema may be half
+// upgraded, so the app stops rather than run or write against it
+static void CloseDatabaseAndExit() {
+    ProductCache_Free(&g_productCache);
+    FinalizeStatementCache();
+    sqlite3_close(db);
+    exit(1);
+}
+
 void InitDatabase() {
-    int rc = sqlite3_open("inventory.db", &db);
+    int rc = sqlite3_open(DB_FILENAME, &db);
     if (rc) {
         MessageBox(NULL, "Cannot open database", "Error", MB_OK | MB_ICONERROR);
         exit(1);
     }
+    sqlite3_busy_timeout(db, DB_BUSY_TIMEOUT_MS);
+    g_stmtCache.conn = db;
+    ProductCache_Init(&g_productCache, db, 0);
+
+    g_pragmaProfile = LoadPragmaProfile();
+    if (ApplyPragmaProfile(db, g_pragmaProfile) != SQLITE_OK) {
+        MessageBox(NULL, "Cannot apply the database profile; some SQLite defaults remain in effect.",
+                   "Warning", MB_OK | MB_ICONWARNING);
+    }
 
-    // Create products table
-    const char* sqlProducts =
-        "CREATE TABLE IF NOT EXISTS products ("
-        "id INTEGER PRIMARY KEY AUTOINCREMENT,"
-        "name TEXT NOT NULL UNIQUE,"
-        "quantity INTEGER NOT NULL DEFAULT 0,"
-        "price REAL NOT NULL,"
-        "created_at DATETIME DEFAULT CURRENT_TIMESTAMP);";
-
-    // Create sales table
-    const char* sqlSales =
-        "CREATE TABLE IF NOT EXISTS sales ("
-        "id INTEGER PRIMARY KEY AUTOINCREMENT,"
-        "product_id INTEGER NOT NULL,"
-        "product_name TEXT NOT NULL,"
-        "quantity_sold INTEGER NOT NULL,"
-        "total_amount REAL NOT NULL,"
-        "sale_date DATETIME DEFAULT CURRENT_TIMESTAMP,"
-        "FOREIGN KEY (product_id) REFERENCES products(id));";
-
-    char* errMsg = 0;
-    rc = sqlite3_exec(db, sqlProducts, 0, 0, &errMsg);
-    if (rc != SQLITE_OK) {
-        MessageBox(NULL, errMsg, "Database Error", MB_OK | MB_ICONERROR);
-        sqlite3_free(errMsg);
-        return;
+    // A current database runs no DDL here, only the version check
+    int from = MigrateSchema();
+    if (from < 0) {
+        CloseDatabaseAndExit();
+    }
+    g_ftsAvailable = HasSearchIndex();
+    // Recorded versions say nothing about the index when an earlier build lacked FTS5
+    if (!g_ftsAvailable && HasFts5()) {
+        if (CreateSearchIndex()) {
+            g_ftsAvailable = HasSearchIndex();
+        } else {
+            MessageBox(NULL, "Cannot build the product search index; search will scan every product.",
+                       "Warning", MB_OK | MB_ICONWARNING);
+        }
     }
+    g_productCache.ftsAvailable = g_ftsAvailable;
 
-    rc = sqlite3_exec(db, sqlSales, 0, 0, &errMsg);
-    if (rc != SQLITE_OK) {
-        MessageBox(NULL, errMsg, "Database Error", MB_OK | MB_ICONERROR);
-        sqlite3_free(errMsg);
-        return;
+    // Reads sqlite_master only, unless an index definition changed
+    if (EnsureIndexes(db) != SQLITE_OK) {
+        MessageBox(NULL, sqlite3_errmsg(db), "Database Error", MB_OK | MB_ICONERROR);
+        CloseDatabaseAndExit();
+    }
+
+    // Only a database that had no schema at all can need the samples
+    if (from == 0) {
+        InsertSampleData();
     }
 
-    // Insert sample data
-    InsertSampleData();
+    // From here on this connection only lists and looks up rows; the worker does every write
+    sqlite3_exec(db, "PRAGMA query_only=1", 0, 0, 0);
 }
 
 void InsertSampleData() {
-    // Check if data already exists
-    const char* checkSql = "SELECT COUNT(*) FROM products";
+    // A database from before schema versioning may already hold products;
+    // one row is enough to tell, so this never counts the table
+    const char* checkSql = "SELECT 1 FROM products LIMIT 1";
     sqlite3_stmt* stmt;
-    int count = 0;
+    int exists = 0;
 
-    if (sqlite3_prepare_v2(db, checkSql, -1, &stmt, 0) == SQLITE_OK) {
-        if (sqlite3_step(stmt) == SQLITE_ROW) {
-            count = sqlite3_column_int(stmt, 0);
-        }
+    stmt = AcquireStatement(checkSql);
+    if (stmt) {
+        exists = sqlite3_step(stmt) == SQLITE_ROW;
     }
-    sqlite3_finalize(stmt);
+    ReleaseStatement(stmt);
 
-    if (count > 0) {
+    if (exists) {
         return; // Data already exists
     }
 
+    // [seed] scale=N fills an empty database with the synthetic workload instead of the samples
+    char path[MAX_PATH];
+    if (GetConfigPath(path)) {
+        int scale = GetPrivateProfileInt("seed", "scale", 0, path);
+        if (scale > 0) {
+            WorkloadSpec spec;
+            Workload_Init(&spec, scale, (unsigned long long)GetPrivateProfileInt("seed", "seed", 1, path));
+            if (Workload_Generate(db, &spec, NULL, NULL) != SQLITE_OK) {
+                MessageBox(NULL, sqlite3_errmsg(db), "Seeding Error", MB_OK | MB_ICONERROR);
+            }
+            return;
+        }
+    }
+
     // Sample products data
     const char* sampleProducts[][3] = {
         {"Laptop Dell XPS 13", "15", "8500.00"},
@@ -276,17 +876,23 @@ void InsertSampleData() {
         {"Power Bank 20000mAh", "55", "280.00"}
     };
 
-    const char* sql = "INSERT INTO products (name, quantity, price) VALUES (?, ?, ?)";
+    const char* sql = SQL_INSERT_PRODUCT;
 
+    StmtCache_Exec(&g_stmtCache, "BEGIN TRANSACTION");
     for (int i = 0; i < 15; i++) {
-        if (sqlite3_prepare_v2(db, sql, -1, &stmt, 0) == SQLITE_OK) {
+        Money price = 0;
+        ParseMoney(sampleProducts[i][2], &price);
+
+        stmt = AcquireStatement(sql);
+        if (stmt) {
             sqlite3_bind_text(stmt, 1, sampleProducts[i][0], -1, SQLITE_TRANSIENT);
             sqlite3_bind_int(stmt, 2, atoi(sampleProducts[i][1]));
-            sqlite3_bind_double(stmt, 3, atof(sampleProducts[i][2]));
+            sqlite3_bind_int64(stmt, 3, price);
             sqlite3_step(stmt);
         }
-        sqlite3_finalize(stmt);
+        ReleaseStatement(stmt);
     }
+    StmtCache_Exec(&g_stmtCache, "COMMIT");
 }
 
 void CreateControls(HWND hwnd) {
@@ -305,6 +911,8 @@ void CreateControls(HWND hwnd) {
     TabCtrl_InsertItem(hTabControl, 0, &tie);
     tie.pszText = "Sales Report";
     TabCtrl_InsertItem(hTabControl, 1, &tie);
+    tie.pszText = "Cart";
+    TabCtrl_InsertItem(hTabControl, 2, &tie);
 
     // Search box
     CreateWindow("STATIC", "Search:", WS_CHILD | WS_VISIBLE,
@@ -317,10 +925,13 @@ void CreateControls(HWND hwnd) {
     CreateWindow("BUTTON", "Search", WS_CHILD | WS_VISIBLE | BS_PUSHBUTTON,
                  295, 47, 80, 24, hwnd, (HMENU)ID_BTN_SEARCH, hInst, NULL);
 
+    hBtnImport = CreateWindow("BUTTON", "Import CSV...", WS_CHILD | WS_VISIBLE | BS_PUSHBUTTON,
+                              385, 47, 110, 24, hwnd, (HMENU)ID_BTN_IMPORT, hInst, NULL);
+
     // Products ListView
     hListViewProducts = CreateWindowEx(
         WS_EX_CLIENTEDGE, WC_LISTVIEW, "",
-        WS_CHILD | WS_VISIBLE | LVS_REPORT | LVS_SINGLESEL,
+        WS_CHILD | WS_VISIBLE | LVS_REPORT | LVS_SINGLESEL | LVS_OWNERDATA,
         20, 80, 940, 450,
         hwnd, (HMENU)ID_LISTVIEW_PRODUCTS, hInst, NULL
     );
@@ -383,6 +994,105 @@ void CreateControls(HWND hwnd) {
     lvc.cx = 230;
     ListView_InsertColumn(hListViewSales, 4, &lvc);
 
+    // Sales summary ListView, shown instead of the sales when "Daily totals" is checked
+    hChkSalesSummary = CreateWindow("BUTTON", "Daily totals", WS_CHILD | BS_AUTOCHECKBOX,
+                 400, 49, 150, 20, hwnd, (HMENU)ID_CHK_SALES_SUMMARY, hInst, NULL);
+
+    hListViewSalesSummary = CreateWindowEx(
+        WS_EX_CLIENTEDGE, WC_LISTVIEW, "",
+        WS_CHILD | LVS_REPORT | LVS_SINGLESEL,
+        20, 80, 940, 450,
+        hwnd, (HMENU)ID_LISTVIEW_SALES_SUMMARY, hInst, NULL
+    );
+
+    ListView_SetExtendedListViewStyle(hListViewSalesSummary,
+        LVS_EX_FULLROWSELECT | LVS_EX_GRIDLINES);
+
+    lvc.pszText = "Day";
+    lvc.cx = 200;
+    ListView_InsertColumn(hListViewSalesSummary, 0, &lvc);
+
+    lvc.pszText = "Transactions";
+    lvc.cx = 200;
+    ListView_InsertColumn(hListViewSalesSummary, 1, &lvc);
+
+    lvc.pszText = "Units Sold";
+    lvc.cx = 200;
+    ListView_InsertColumn(hListViewSalesSummary, 2, &lvc);
+
+    lvc.pszText = "Revenue (K)";
+    lvc.cx = 230;
+    ListView_InsertColumn(hListViewSalesSummary, 3, &lvc);
+
+    // Best sellers ListView, shown instead of the sales when "By product" is checked
+    hChkSalesByProduct = CreateWindow("BUTTON", "By product", WS_CHILD | BS_AUTOCHECKBOX,
+                 560, 49, 150, 20, hwnd, (HMENU)ID_CHK_SALES_BY_PRODUCT, hInst, NULL);
+
+    hListViewSalesByProduct = CreateWindowEx(
+        WS_EX_CLIENTEDGE, WC_LISTVIEW, "",
+        WS_CHILD | LVS_REPORT | LVS_SINGLESEL,
+        20, 80, 940, 450,
+        hwnd, (HMENU)ID_LISTVIEW_SALES_BY_PRODUCT, hInst, NULL
+    );
+
+    ListView_SetExtendedListViewStyle(hListViewSalesByProduct,
+        LVS_EX_FULLROWSELECT | LVS_EX_GRIDLINES);
+
+    lvc.pszText = "Product";
+    lvc.cx = 300;
+    ListView_InsertColumn(hListViewSalesByProduct, 0, &lvc);
+
+    lvc.pszText = "Transactions";
+    lvc.cx = 200;
+    ListView_InsertColumn(hListViewSalesByProduct, 1, &lvc);
+
+    lvc.pszText = "Units Sold";
+    lvc.cx = 200;
+    ListView_InsertColumn(hListViewSalesByProduct, 2, &lvc);
+
+    lvc.pszText = "Revenue (K)";
+    lvc.cx = 200;
+    ListView_InsertColumn(hListViewSalesByProduct, 3, &lvc);
+
+    // Cart ListView, with its own buttons inside the tab
+    hListViewCart = CreateWindowEx(
+        WS_EX_CLIENTEDGE, WC_LISTVIEW, "",
+        WS_CHILD | LVS_REPORT | LVS_SINGLESEL,
+        20, 80, 940, 400,
+        hwnd, (HMENU)ID_LISTVIEW_CART, hInst, NULL
+    );
+
+    ListView_SetExtendedListViewStyle(hListViewCart,
+        LVS_EX_FULLROWSELECT | LVS_EX_GRIDLINES);
+
+    lvc.pszText = "Product Name";
+    lvc.cx = 400;
+    ListView_InsertColumn(hListViewCart, 0, &lvc);
+
+    lvc.pszText = "Quantity";
+    lvc.cx = 150;
+    ListView_InsertColumn(hListViewCart, 1, &lvc);
+
+    lvc.pszText = "Unit Price (K)";
+    lvc.cx = 180;
+    ListView_InsertColumn(hListViewCart, 2, &lvc);
+
+    lvc.pszText = "Line Total (K)";
+    lvc.cx = 180;
+    ListView_InsertColumn(hListViewCart, 3, &lvc);
+
+    hBtnCartRemove = CreateWindow("BUTTON", "Remove Line", WS_CHILD | BS_PUSHBUTTON,
+                 20, 490, 120, 30, hwnd, (HMENU)ID_BTN_CART_REMOVE, hInst, NULL);
+
+    hBtnCartClear = CreateWindow("BUTTON", "Clear Cart", WS_CHILD | BS_PUSHBUTTON,
+                 150, 490, 120, 30, hwnd, (HMENU)ID_BTN_CART_CLEAR, hInst, NULL);
+
+    hBtnCheckout = CreateWindow("BUTTON", "Checkout", WS_CHILD | BS_PUSHBUTTON,
+                 280, 490, 120, 30, hwnd, (HMENU)ID_BTN_CHECKOUT, hInst, NULL);
+
+    hCartTotal = CreateWindow("STATIC", "", WS_CHILD | SS_RIGHT,
+                 560, 495, 400, 20, hwnd, NULL, hInst, NULL);
+
     // Buttons
     int btnY = 570;
     CreateWindow("BUTTON", "Add Product", WS_CHILD | WS_VISIBLE | BS_PUSHBUTTON,
@@ -403,7 +1113,16 @@ void CreateControls(HWND hwnd) {
     CreateWindow("BUTTON", "View Sales", WS_CHILD | WS_VISIBLE | BS_PUSHBUTTON,
                  670, btnY, 120, 30, hwnd, (HMENU)ID_BTN_VIEW_SALES, hInst, NULL);
 
+    CreateWindow("BUTTON", "Add to Cart", WS_CHILD | WS_VISIBLE | BS_PUSHBUTTON,
+                 800, btnY, 120, 30, hwnd, (HMENU)ID_BTN_ADD_TO_CART, hInst, NULL);
+
+    // Status bar
+    hStatusBar = CreateWindowEx(0, STATUSCLASSNAME, "",
+                                WS_CHILD | WS_VISIBLE,
+                                0, 0, 0, 0, hwnd, NULL, hInst, NULL);
+
     LoadProducts();
+    LoadSalesMirror();
 }
 
 INT_PTR CALLBACK ProductDialogProc(HWND hDlg, UINT message, WPARAM wParam, LPARAM lParam) {
@@ -416,9 +1135,8 @@ INT_PTR CALLBACK ProductDialogProc(HWND hDlg, UINT message, WPARAM wParam, LPARA
             SetDlgItemText(hDlg, IDC_EDIT_NAME, g_productData.name);
             SetDlgItemInt(hDlg, IDC_EDIT_QUANTITY, g_productData.quantity, FALSE);
 
-            char priceStr[50];
-            sprintf(priceStr, "%.2f", g_productData.price);
-            SetDlgItemText(hDlg, IDC_EDIT_PRICE, priceStr);
+            char priceStr[MONEY_TEXT_SIZE];
+            SetDlgItemText(hDlg, IDC_EDIT_PRICE, FormatMoney(g_productData.price, priceStr));
 
             return TRUE;
         }
@@ -431,7 +1149,9 @@ INT_PTR CALLBACK ProductDialogProc(HWND hDlg, UINT message, WPARAM wParam, LPARA
 
                 char priceStr[50];
                 GetDlgItemText(hDlg, IDC_EDIT_PRICE, priceStr, 50);
-                g_productData.price = atof(priceStr);
+                if (!ParseMoney(priceStr, &g_productData.price)) {
+                    g_productData.price = 0;
+                }
 
                 // Validate
                 if (strlen(g_productData.name) == 0) {
@@ -459,9 +1179,9 @@ INT_PTR CALLBACK ProductDialogProc(HWND hDlg, UINT message, WPARAM wParam, LPARA
 INT_PTR CALLBACK PurchaseDialogProc(HWND hDlg, UINT message, WPARAM wParam, LPARAM lParam) {
     switch (message) {
         case WM_INITDIALOG: {
-            char info[512];
-            sprintf(info, "Product: %s\nPrice: K%.2f per unit",
-                    g_purchaseData.productName, g_purchaseData.price);
+            char info[512], priceStr[MONEY_TEXT_SIZE];
+            sprintf(info, "Product: %s\nPrice: K%s per unit",
+                    g_purchaseData.productName, FormatMoney(g_purchaseData.price, priceStr));
             SetDlgItemText(hDlg, IDC_EDIT_NAME, info);
             SetDlgItemInt(hDlg, IDC_EDIT_PURCHASE_QTY, 1, FALSE);
             return TRUE;
@@ -488,78 +1208,1200 @@ INT_PTR CALLBACK PurchaseDialogProc(HWND hDlg, UINT message, WPARAM wParam, LPAR
     return FALSE;
 }
 
-void LoadProducts() {
-    ListView_DeleteAllItems(hListViewProducts);
-
-    const char* sql = "SELECT id, name, quantity, price, created_at FROM products ORDER BY id";
-    sqlite3_stmt* stmt;
-
-    if (sqlite3_prepare_v2(db, sql, -1, &stmt, 0) == SQLITE_OK) {
-        int row = 0;
-        while (sqlite3_step(stmt) == SQLITE_ROW) {
-            LVITEM lvi = {0};
-            char buffer[256];
-
-            lvi.mask = LVIF_TEXT;
-            lvi.iItem = row;
+static ULONGLONG FileTimeToMs(const FILETIME* ft) {
+    ULARGE_INTEGER value;
+    value.LowPart = ft->dwLowDateTime;
+    value.HighPart = ft->dwHighDateTime;
+    return value.QuadPart / 10000;
+}
 
-            sprintf(buffer, "%d", sqlite3_column_int(stmt, 0));
-            lvi.pszText = buffer;
-            ListView_InsertItem(hListViewProducts, &lvi);
+// Cold start: from process creation, so loader and database open are included,
+// to the first product row handed to the list view for painting
+static void RecordStartupTime() {
+    FILETIME created, exited, kernel, user, now;
+    char message[64];
 
-            ListView_SetItemText(hListViewProducts, row, 1,
-                (char*)sqlite3_column_text(stmt, 1));
+    if (!GetProcessTimes(GetCurrentProcess(), &created, &exited, &kernel, &user)) {
+        return;
+    }
+    GetSystemTimeAsFileTime(&now);
+    g_startupMs = FileTimeToMs(&now) - FileTimeToMs(&created);
+    if (g_startupMs == 0) {
+        g_startupMs = 1;
+    }
 
-            sprintf(buffer, "%d", sqlite3_column_int(stmt, 2));
-            ListView_SetItemText(hListViewProducts, row, 2, buffer);
+    snprintf(message, sizeof(message), "Startup: %llu ms\n", (unsigned long long)g_startupMs);
+    OutputDebugString(message);
+    UpdateStatusBar();
+}
 
-            sprintf(buffer, "%.2f", sqlite3_column_double(stmt, 3));
-            ListView_SetItemText(hListViewProducts, row, 3, buffer);
+// Fill one cell of the owner-data product list
+void GetProductDispInfo(NMLVDISPINFO* dispInfo) {
+    LVITEM* item = &dispInfo->item;
+    if (!(item->mask & LVIF_TEXT) || item->cchTextMax <= 0) {
+        return;
+    }
 
-            ListView_SetItemText(hListViewProducts, row, 4,
-                (char*)sqlite3_column_text(stmt, 4));
+    const ProductRow* row = ProductCache_GetRow(&g_productCache, item->iItem);
+    if (!row) {
+        item->pszText[0] = '\0';
+        return;
+    }
+    if (!g_startupMs) {
+        RecordStartupTime();
+    }
 
-            row++;
+    switch (item->iSubItem) {
+        case 0:
+            snprintf(item->pszText, item->cchTextMax, "%d", row->id);
+            break;
+        case 1:
+            snprintf(item->pszText, item->cchTextMax, "%s", row->name);
+            break;
+        case 2:
+            snprintf(item->pszText, item->cchTextMax, "%d", row->quantity);
+            break;
+        case 3: {
+            char priceStr[MONEY_TEXT_SIZE];
+            snprintf(item->pszText, item->cchTextMax, "%s", FormatMoney(row->price, priceStr));
+            break;
         }
+        case 4:
+            snprintf(item->pszText, item->cchTextMax, "%s", row->createdAt);
+            break;
+        default:
+            item->pszText[0] = '\0';
+            break;
+    }
+}
+
+// The product list stays on this connection rather than the DbReaders pool: the virtual
+// list asks for rows while it paints and needs them then, not after a round trip to a thread.
+// It reads ids once per fill and single pages after that; under WAL neither holds up a commit.
+void LoadProducts() {
+    SearchResults_Clear(&g_searchResults);
+    ProductCache_Reset(&g_productCache, NULL, NULL);
+    ListView_SetItemCountEx(hListViewProducts, g_productCache.totalRows, 0);
+    InvalidateRect(hListViewProducts, NULL, TRUE);
+    UpdateStatusBar();
+}
+
+// Put a newly recorded sale at the top of the Sales Report, if it has been loaded
+static void PrependSale(sqlite3_int64 id) {
+    // Before its first page arrives the report will pick the sale up anyway, see
+    // CatchUpSales; a sale it already shows has an id no newer than the top row
+    if (!g_salesPager.loaded || id <= g_salesPager.newestId) {
+        return;
+    }
+
+    sqlite3_stmt* stmt;
+
+    stmt = AcquireStatement(SQL_SALE_BY_ID);
+    if (stmt) {
+        sqlite3_bind_int64(stmt, 1, id);
+
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            LVITEM lvi = {0};
+            char buffer[256];
+
+            g_salesPager.appending = 1;
+            lvi.mask = LVIF_TEXT;
+            lvi.iItem = 0;
+
+            sprintf(buffer, "%d", sqlite3_column_int(stmt, 0));
+            lvi.pszText = buffer;
+            ListView_InsertItem(hListViewSales, &lvi);
+
+            ListView_SetItemText(hListViewSales, 0, 1,
+                (char*)sqlite3_column_text(stmt, 1));
+
+            sprintf(buffer, "%d", sqlite3_column_int(stmt, 2));
+            ListView_SetItemText(hListViewSales, 0, 2, buffer);
+
+            FormatMoney(sqlite3_column_int64(stmt, 3), buffer);
+            ListView_SetItemText(hListViewSales, 0, 3, buffer);
+
+            ListView_SetItemText(hListViewSales, 0, 4,
+                (char*)sqlite3_column_text(stmt, 4));
+            g_salesPager.appending = 0;
+            g_salesPager.newestId = id;
+        }
+    }
+    ReleaseStatement(stmt);
+}
+
+// A report is read on its own snapshot, which may predate sales whose commits were
+// acknowledged while it was in flight, with nothing on screen to patch yet. Sale ids
+// only grow, so those are exactly the sales after the newest one the report holds.
+static void CatchUpSales(sqlite3_int64 afterId, void (*apply)(sqlite3_int64 saleId)) {
+    sqlite3_stmt* stmt = AcquireStatement(SQL_SALES_AFTER_ID);
+
+    if (stmt) {
+        sqlite3_bind_int64(stmt, 1, afterId);
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            apply(sqlite3_column_int64(stmt, 0));
+        }
+    }
+    ReleaseStatement(stmt);
+}
+
+// Patch the lists with the rows a committed job changed. Each changed row
+// costs a constant amount of list work, whatever the size of the catalog.
+void ApplyChanges(ChangeLog* log) {
+    int countChanged = 0;
+    int salesInserted = 0;
+
+    // A search result may gain or lose rows on any edit, and a burst of
+    // changes is cheaper to reload than to patch
+    if (log->overflow || g_productCache.filterMode != FILTER_NONE) {
+        int productsChanged = log->overflow;
+
+        for (int i = 0; i < log->count && !log->overflow; i++) {
+            const RowChange* change = &log->changes[i];
+            if (!change->isSales) {
+                productsChanged = 1;
+            } else if (change->op == SQLITE_INSERT) {
+                PrependSale(change->rowid);
+                RefreshSalesDay(change->rowid);
+                salesInserted = 1;
+            }
+        }
+
+        if (productsChanged) {
+            ProductCache_Rescan(&g_productCache, &g_searchResults);
+            ListView_SetItemCountEx(hListViewProducts, g_productCache.totalRows, 0);
+            InvalidateRect(hListViewProducts, NULL, TRUE);
+        }
+        if (log->overflow && g_salesPager.generation > 0) {
+            LoadSales();
+        }
+        if (log->overflow && g_salesSummary.loaded) {
+            LoadSalesSummary();
+        }
+        if (log->overflow || salesInserted) {
+            CatchUpSalesMirror();
+            QueueSalesByProductRefresh();
+        }
+
+        log->count = 0;
+        log->overflow = 0;
+        return;
+    }
+
+    for (int i = 0; i < log->count; i++) {
+        const RowChange* change = &log->changes[i];
+
+        if (change->isSales) {
+            if (change->op == SQLITE_INSERT) {
+                PrependSale(change->rowid);
+                RefreshSalesDay(change->rowid);
+                salesInserted = 1;
+            }
+            continue;
+        }
+
+        int index;
+        switch (ProductCache_ApplyChange(&g_productCache, change->op, change->rowid, &index)) {
+            case PRODUCT_LIST_REDRAW_ROW:
+                ListView_RedrawItems(hListViewProducts, index, index);
+                break;
+            case PRODUCT_LIST_COUNT:
+                countChanged = 1;
+                break;
+        }
+    }
+
+    if (countChanged) {
+        ListView_SetItemCountEx(hListViewProducts, g_productCache.totalRows,
+                                LVSICF_NOSCROLL | LVSICF_NOINVALIDATEALL);
+        InvalidateRect(hListViewProducts, NULL, FALSE);
+    }
+    // The sales are appended to the mirror in one read, not one per insert
+    if (salesInserted) {
+        CatchUpSalesMirror();
+        QueueSalesByProductRefresh();
+    }
+
+    log->count = 0;
+    log->overflow = 0;
+    UpdateStatusBar();
+}
+
+// Read one page of sales older than beforeId (or the newest page when beforeId is 0)
+static int FetchSalesPage(StatementCache* stmts, sqlite3_int64 beforeId, SalesPage* page) {
+    const char* sql = beforeId > 0 ? SQL_SALES_PAGE_BEFORE : SQL_SALES_PAGE_FIRST;
+    sqlite3_stmt* stmt;
+    int rc;
+
+    page->beforeId = beforeId;
+    page->count = 0;
+
+    stmt = StmtCache_Acquire(stmts, sql);
+    rc = stmt ? SQLITE_OK : SQLITE_ERROR;
+    if (rc == SQLITE_OK) {
+        int param = 1;
+        if (beforeId > 0) {
+            sqlite3_bind_int64(stmt, param++, beforeId);
+        }
+        sqlite3_bind_int(stmt, param, SALES_PAGE_SIZE);
+
+        while ((rc = sqlite3_step(stmt)) == SQLITE_ROW && page->count < SALES_PAGE_SIZE) {
+            SalesRow* r = &page->rows[page->count++];
+            const char* productName = (const char*)sqlite3_column_text(stmt, 1);
+            const char* saleDate = (const char*)sqlite3_column_text(stmt, 4);
+
+            r->id = sqlite3_column_int(stmt, 0);
+            r->quantitySold = sqlite3_column_int(stmt, 2);
+            r->totalAmount = sqlite3_column_int64(stmt, 3);
+            snprintf(r->productName, sizeof(r->productName), "%s", productName ? productName : "");
+            snprintf(r->saleDate, sizeof(r->saleDate), "%s", saleDate ? saleDate : "");
+        }
+        if (rc == SQLITE_DONE || rc == SQLITE_ROW) {
+            rc = SQLITE_OK;
+        }
+    }
+    StmtCache_Release(stmts, stmt);
+    return rc == SQLITE_OK;
+}
+
+static void AppendSalesPage(const SalesPage* page) {
+    int row = ListView_GetItemCount(hListViewSales);
+
+    g_salesPager.appending = 1;
+    for (int i = 0; i < page->count; i++, row++) {
+        const SalesRow* r = &page->rows[i];
+        LVITEM lvi = {0};
+        char buffer[256];
+
+        lvi.mask = LVIF_TEXT;
+        lvi.iItem = row;
+
+        sprintf(buffer, "%d", r->id);
+        lvi.pszText = buffer;
+        ListView_InsertItem(hListViewSales, &lvi);
+
+        ListView_SetItemText(hListViewSales, row, 1, (char*)r->productName);
+
+        sprintf(buffer, "%d", r->quantitySold);
+        ListView_SetItemText(hListViewSales, row, 2, buffer);
+
+        FormatMoney(r->totalAmount, buffer);
+        ListView_SetItemText(hListViewSales, row, 3, buffer);
+
+        ListView_SetItemText(hListViewSales, row, 4, (char*)r->saleDate);
+    }
+    g_salesPager.appending = 0;
+
+    if (page->count > 0) {
+        g_salesPager.lastSeenId = page->rows[page->count - 1].id;
+    }
+    if (page->count < SALES_PAGE_SIZE) {
+        g_salesPager.exhausted = 1;
+    }
+}
+
+// Queue a read of the sales older than beforeId on the database worker
+static void RequestSalesPage(sqlite3_int64 beforeId) {
+    DbJob* job = NewDbJob(DBJOB_SALES_PAGE);
+    if (!job) {
+        return;
+    }
+
+    job->page = (SalesPage*)malloc(sizeof(SalesPage));
+    if (!job->page) {
+        free(job);
+        return;
+    }
+    job->page->generation = g_salesPager.generation;
+    job->page->beforeId = beforeId;
+    job->page->count = 0;
+
+    g_salesPager.prefetchPending = 1;
+    DbWorker_Submit(&g_dbWorker, &job->work);
+}
+
+// Start reading the page after the last one shown, unless one is already on its way
+static void StartSalesPrefetch() {
+    if (g_salesPager.exhausted || g_salesPager.prefetched || g_salesPager.prefetchPending) {
+        return;
+    }
+    RequestSalesPage(g_salesPager.lastSeenId);
+}
+
+// A sales page came back from the worker: show the first page straight away,
+// keep later ones until the user scrolls to them
+void OnSalesPageLoaded(SalesPage* page, int ok) {
+    if (page->generation != g_salesPager.generation) {
+        free(page);
+        return;
+    }
+    g_salesPager.prefetchPending = 0;
+
+    if (!ok) {
+        free(page);
+        return;
+    }
+
+    if (!g_salesPager.loaded) {
+        AppendSalesPage(page);
+        g_salesPager.dataVersion = page->dataVersion;
+        g_salesPager.newestId = page->count > 0 ? page->rows[0].id : 0;
+        free(page);
+        g_salesPager.loaded = 1;
+        CatchUpSales(g_salesPager.newestId, PrependSale);
+        StartSalesPrefetch();
+        return;
+    }
+
+    g_salesPager.prefetched = page;
+    if (g_salesPager.wantMore) {
+        LoadMoreSales();
+    }
+}
+
+// Show the prefetched page and start reading the one after it
+void LoadMoreSales() {
+    if (g_salesPager.exhausted || !g_salesPager.loaded) {
+        return;
+    }
+
+    if (!g_salesPager.prefetched) {
+        g_salesPager.wantMore = 1;
+        StartSalesPrefetch();
+        return;
+    }
+
+    SalesPage* page = g_salesPager.prefetched;
+    g_salesPager.prefetched = NULL;
+    g_salesPager.wantMore = 0;
+
+    AppendSalesPage(page);
+    free(page);
+    StartSalesPrefetch();
+}
+
+// Called when the sales list scrolls: fetch more once the last row is in view
+void CheckSalesScrollEnd() {
+    if (g_salesPager.appending) {
+        return;
+    }
+
+    int count = ListView_GetItemCount(hListViewSales);
+    int lastVisible = ListView_GetTopIndex(hListViewSales) + ListView_GetCountPerPage(hListViewSales);
+
+    if (lastVisible >= count) {
+        LoadMoreSales();
+    }
+}
+
+void LoadSales() {
+    // Pages still in flight belong to the previous load and are dropped on arrival
+    free(g_salesPager.prefetched);
+    g_salesPager.prefetched = NULL;
+    g_salesPager.generation++;
+    g_salesPager.lastSeenId = 0;
+    g_salesPager.newestId = 0;
+    g_salesPager.loaded = 0;
+    g_salesPager.exhausted = 0;
+    g_salesPager.wantMore = 0;
+    g_salesPager.prefetchPending = 0;
+
+    ListView_DeleteAllItems(hListViewSales);
+    RequestSalesPage(0);
+}
+
+void ShutdownSalesPager() {
+    free(g_salesPager.prefetched);
+    g_salesPager.prefetched = NULL;
+}
+
+static void ReadSalesDayRow(sqlite3_stmt* stmt, SalesDayRow* row) {
+    const char* day = (const char*)sqlite3_column_text(stmt, 0);
+
+    snprintf(row->day, sizeof(row->day), "%s", day ? day : "");
+    row->transactions = sqlite3_column_int(stmt, 1);
+    row->units = sqlite3_column_int(stmt, 2);
+    row->revenue = sqlite3_column_int64(stmt, 3);
+}
+
+// Read the newest SALES_SUMMARY_DAYS days of the rollup, on the database worker or a reader.
+// The newest sale id comes from the same read transaction, so it is exactly what the rows include.
+static int FetchSalesSummary(StatementCache* stmts, SalesSummary* summary) {
+    sqlite3_stmt* stmt;
+    int rc;
+
+    summary->count = 0;
+    summary->maxSaleId = 0;
+
+    if (StmtCache_Exec(stmts, "BEGIN") != SQLITE_OK) {
+        return 0;
+    }
+
+    stmt = StmtCache_Acquire(stmts, SQL_SALES_MAX_ID);
+    rc = stmt && sqlite3_step(stmt) == SQLITE_ROW ? SQLITE_OK : SQLITE_ERROR;
+    if (rc == SQLITE_OK) {
+        summary->maxSaleId = sqlite3_column_int64(stmt, 0);
+    }
+    StmtCache_Release(stmts, stmt);
+
+    stmt = rc == SQLITE_OK ? StmtCache_Acquire(stmts, SQL_SALES_DAILY_SUMMARY) : NULL;
+    rc = stmt ? SQLITE_OK : SQLITE_ERROR;
+    if (rc == SQLITE_OK) {
+        sqlite3_bind_int(stmt, 1, SALES_SUMMARY_DAYS);
+        while ((rc = sqlite3_step(stmt)) == SQLITE_ROW && summary->count < SALES_SUMMARY_DAYS) {
+            ReadSalesDayRow(stmt, &summary->rows[summary->count++]);
+        }
+        if (rc == SQLITE_DONE || rc == SQLITE_ROW) {
+            rc = SQLITE_OK;
+        }
+    }
+    StmtCache_Release(stmts, stmt);
+    StmtCache_Exec(stmts, "COMMIT");
+    return rc == SQLITE_OK;
+}
+
+// Write a day into the summary list, as a new row at index or over the existing one
+static void SetSalesDayItem(int index, const SalesDayRow* row, int insert) {
+    char buffer[64];
+
+    if (insert) {
+        LVITEM lvi = {0};
+        lvi.mask = LVIF_TEXT;
+        lvi.iItem = index;
+        lvi.pszText = (char*)row->day;
+        ListView_InsertItem(hListViewSalesSummary, &lvi);
+    }
+
+    sprintf(buffer, "%d", row->transactions);
+    ListView_SetItemText(hListViewSalesSummary, index, 1, buffer);
+
+    sprintf(buffer, "%d", row->units);
+    ListView_SetItemText(hListViewSalesSummary, index, 2, buffer);
+
+    FormatMoney(row->revenue, buffer);
+    ListView_SetItemText(hListViewSalesSummary, index, 3, buffer);
+}
+
+void LoadSalesSummary() {
+    // A summary still in flight belongs to the previous load and is dropped on arrival
+    g_salesSummary.generation++;
+    g_salesSummary.loaded = 0;
+    g_salesSummary.pending = 0;
+    ListView_DeleteAllItems(hListViewSalesSummary);
+
+    DbJob* job = NewDbJob(DBJOB_SALES_SUMMARY);
+    if (!job) {
+        return;
+    }
+
+    job->summary = (SalesSummary*)malloc(sizeof(SalesSummary));
+    if (!job->summary) {
+        free(job);
+        return;
+    }
+    job->summary->generation = g_salesSummary.generation;
+    job->summary->count = 0;
+    g_salesSummary.pending = 1;
+    DbWorker_Submit(&g_dbWorker, &job->work);
+}
+
+void OnSalesSummaryLoaded(SalesSummary* summary, int ok) {
+    if (summary->generation == g_salesSummary.generation) {
+        g_salesSummary.pending = 0;
+        if (ok) {
+            for (int i = 0; i < summary->count; i++) {
+                SetSalesDayItem(i, &summary->rows[i], 1);
+            }
+            g_salesSummary.dataVersion = summary->dataVersion;
+            g_salesSummary.loaded = 1;
+            CatchUpSales(summary->maxSaleId, RefreshSalesDay);
+        }
+    }
+    free(summary);
+}
+
+// Re-read the day a new sale landed in; the rollup row is already up to date
+void RefreshSalesDay(sqlite3_int64 saleId) {
+    if (!g_salesSummary.loaded) {
+        return;
+    }
+
+    sqlite3_stmt* stmt;
+
+    stmt = AcquireStatement(SQL_SALES_DAILY_FOR_SALE);
+    if (stmt) {
+        sqlite3_bind_int64(stmt, 1, saleId);
+
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            SalesDayRow row;
+            char day[16];
+            int count = ListView_GetItemCount(hListViewSalesSummary);
+            int index;
+
+            ReadSalesDayRow(stmt, &row);
+            for (index = 0; index < count; index++) {
+                ListView_GetItemText(hListViewSalesSummary, index, 0, day, sizeof(day));
+                if (strcmp(day, row.day) <= 0) {
+                    break;
+                }
+            }
+
+            // Days are listed newest first: update the day if shown, otherwise insert it in place
+            if (index < count && strcmp(day, row.day) == 0) {
+                SetSalesDayItem(index, &row, 0);
+            } else if (index < SALES_SUMMARY_DAYS) {
+                SetSalesDayItem(index, &row, 1);
+            }
+        }
+    }
+    ReleaseStatement(stmt);
+}
+
+// Read every sale into the mirror, on the database worker or a reader
+static int FetchSalesMirror(StatementCache* stmts, SalesMirror* mirror) {
+    sqlite3_stmt* stmt = StmtCache_Acquire(stmts, SQL_SALES_MIRROR_AFTER_ID);
+    int rc = stmt ? SalesMirror_CatchUp(mirror, stmt) : SQLITE_ERROR;
+
+    StmtCache_Release(stmts, stmt);
+    return rc == SQLITE_OK;
+}
+
+// Load the mirror once, in the background; until it arrives "By product" shows nothing
+void LoadSalesMirror() {
+    if (!g_salesByProduct.available) {
+        return;
+    }
+
+    DbJob* job = NewDbJob(DBJOB_LOAD_SALES_MIRROR);
+    if (!job) {
+        return;
+    }
+
+    job->mirror = (SalesMirror*)calloc(1, sizeof(SalesMirror));
+    if (!job->mirror) {
+        free(job);
+        return;
+    }
+    g_salesByProduct.pending = 1;
+    DbWorker_Submit(&g_dbWorker, &job->work);
+}
+
+// Append the sales committed after the mirror's newest one, on the UI connection
+void CatchUpSalesMirror() {
+    if (!g_salesByProduct.loaded) {
+        return;
+    }
+
+    sqlite3_stmt* stmt = AcquireStatement(SQL_SALES_MIRROR_AFTER_ID);
+    if (stmt) {
+        SalesMirror_CatchUp(&g_salesByProduct.mirror, stmt);
+    }
+    ReleaseStatement(stmt);
+}
+
+void OnSalesMirrorLoaded(SalesMirror* mirror, int ok) {
+    g_salesByProduct.pending = 0;
+    if (ok) {
+        g_salesByProduct.mirror = *mirror;
+        g_salesByProduct.loaded = 1;
+        // Sales committed while it loaded were read by the job or are read now
+        CatchUpSalesMirror();
+        if (g_salesByProduct.enabled) {
+            RefreshSalesByProduct();
+        }
+    } else {
+        SalesMirror_Free(mirror);
+        g_salesByProduct.available = 0;
+        g_salesByProduct.enabled = 0;
+        SendMessage(hChkSalesByProduct, BM_SETCHECK, BST_UNCHECKED, 0);
+        ShowWindow(hChkSalesByProduct, SW_HIDE);
+        ShowWindow(hListViewSalesByProduct, SW_HIDE);
+        MessageBox(NULL, "Cannot load the sales mirror; the Sales Report by product is unavailable.",
+                   "Warning", MB_OK | MB_ICONWARNING);
+    }
+    free(mirror);
+}
+
+static int CompareRevenueDescending(const void* a, const void* b) {
+    Money left = ((const SalesByProductRow*)a)->totals.revenue;
+    Money right = ((const SalesByProductRow*)b)->totals.revenue;
+
+    return left < right ? 1 : left > right ? -1 : 0;
+}
+
+// Write one row of the by-product list at index
+static void SetSalesByProductItem(int index, const char* name, const SalesMirrorTotals* totals) {
+    char buffer[64];
+    LVITEM lvi = {0};
+
+    lvi.mask = LVIF_TEXT;
+    lvi.iItem = index;
+    lvi.pszText = (char*)name;
+    ListView_InsertItem(hListViewSalesByProduct, &lvi);
+
+    sprintf(buffer, "%lld", (long long)totals->transactions);
+    ListView_SetItemText(hListViewSalesByProduct, index, 1, buffer);
+
+    sprintf(buffer, "%lld", (long long)totals->units);
+    ListView_SetItemText(hListViewSalesByProduct, index, 2, buffer);
+
+    FormatMoney(totals->revenue, buffer);
+    ListView_SetItemText(hListViewSalesByProduct, index, 3, buffer);
+}
+
+// Committed sales redraw the best sellers at most once per SALES_BY_PRODUCT_REFRESH_MS: a busy
+// till commits several sales a second and each redraw re-sums the whole window. The timer is
+// not restarted while it runs, so steady sales still show within the interval.
+void QueueSalesByProductRefresh() {
+    if (g_salesByProduct.refreshQueued || !IsWindowVisible(hListViewSalesByProduct)) {
+        return;
+    }
+    if (SetTimer(g_hMainWnd, IDT_SALES_BY_PRODUCT, SALES_BY_PRODUCT_REFRESH_MS, NULL)) {
+        g_salesByProduct.refreshQueued = 1;
+    } else {
+        RefreshSalesByProduct();
+    }
+}
+
+// Names of the ranked products in one query, on the database worker or a reader. A product
+// deleted since keeps the "Product #id" it was given, since it still has its sales.
+static int FetchProductNames(StatementCache* stmts, SalesByProductList* list) {
+    char ids[SALES_BY_PRODUCT_ROWS * 12 + 3];
+    size_t used = 0;
+    sqlite3_stmt* stmt;
+    int rc = SQLITE_ERROR;
+
+    ids[used++] = '[';
+    for (int i = 0; i < list->count; i++) {
+        used += sprintf(ids + used, i > 0 ? ",%d" : "%d", list->rows[i].productId);
+    }
+    ids[used++] = ']';
+
+    stmt = StmtCache_Acquire(stmts, SQL_PRODUCT_NAMES_BY_IDS);
+    if (stmt) {
+        sqlite3_bind_text(stmt, 1, ids, (int)used, SQLITE_TRANSIENT);
+        while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+            int index = sqlite3_column_int(stmt, 0);
+            if (index >= 0 && index < list->count) {
+                snprintf(list->names[index], sizeof(list->names[index]), "%s",
+                         (const char*)sqlite3_column_text(stmt, 1));
+            }
+        }
+    }
+    StmtCache_Release(stmts, stmt);
+    return rc == SQLITE_DONE;
+}
+
+// Best sellers over the newest SALES_SUMMARY_DAYS days the mirror holds, all summed in memory.
+// The list is redrawn once their names arrive, see OnSalesByProductNamed.
+void RefreshSalesByProduct() {
+    const SalesMirror* mirror = &g_salesByProduct.mirror;
+    uint32_t newestDay = mirror->maxTime / 86400;
+    uint32_t firstDay = newestDay >= SALES_SUMMARY_DAYS - 1 ? newestDay - (SALES_SUMMARY_DAYS - 1) : 0;
+    uint32_t from = firstDay * 86400;
+    uint32_t to = newestDay < UINT32_MAX / 86400 ? (newestDay + 1) * 86400 : UINT32_MAX;
+    SalesMirrorTotals* byProduct;
+    SalesByProductRow* rows;
+    SalesByProductList* list;
+    DbJob* job;
+    int count = 0;
+
+    if (!g_salesByProduct.loaded || mirror->count == 0) {
+        ListView_DeleteAllItems(hListViewSalesByProduct);
+        return;
+    }
+    // One naming job at a time; the one out ranks again when it is back
+    if (g_salesByProduct.naming) {
+        g_salesByProduct.stale = 1;
+        return;
+    }
+
+    byProduct = (SalesMirrorTotals*)calloc((size_t)mirror->maxProductId + 1, sizeof(SalesMirrorTotals));
+    rows = (SalesByProductRow*)malloc(((size_t)mirror->maxProductId + 1) * sizeof(SalesByProductRow));
+    list = (SalesByProductList*)malloc(sizeof(SalesByProductList));
+    job = NewDbJob(DBJOB_SALES_BY_PRODUCT_NAMES);
+    if (!byProduct || !rows || !list || !job) {
+        free(byProduct);
+        free(rows);
+        free(list);
+        free(job);
+        return;
+    }
+
+    SalesMirror_Totals(mirror, from, to, 0, &list->all);
+    SalesMirror_ByProduct(mirror, from, to, byProduct);
+    for (int32_t id = 0; id <= mirror->maxProductId; id++) {
+        if (byProduct[id].transactions > 0) {
+            rows[count].productId = id;
+            rows[count].totals = byProduct[id];
+            count++;
+        }
+    }
+    qsort(rows, count, sizeof(SalesByProductRow), CompareRevenueDescending);
+
+    list->count = count < SALES_BY_PRODUCT_ROWS ? count : SALES_BY_PRODUCT_ROWS;
+    for (int i = 0; i < list->count; i++) {
+        list->rows[i] = rows[i];
+        sprintf(list->names[i], "Product #%d", rows[i].productId);
+    }
+    free(byProduct);
+    free(rows);
+
+    job->byProduct = list;
+    g_salesByProduct.naming = 1;
+    if (!DbReaders_Submit(&g_dbReaders, &job->work)) {
+        DbWorker_Submit(&g_dbWorker, &job->work);
+    }
+}
+
+void OnSalesByProductNamed(SalesByProductList* list, int ok) {
+    g_salesByProduct.naming = 0;
+    if (g_salesByProduct.stale) {
+        // Sales committed since it was ranked; rank again rather than show it
+        g_salesByProduct.stale = 0;
+        RefreshSalesByProduct();
+    } else if (g_salesByProduct.enabled) {
+        // Unnamed rows keep "Product #id" if the names could not be read
+        ListView_DeleteAllItems(hListViewSalesByProduct);
+        SetSalesByProductItem(0, "All products", &list->all);
+        for (int i = 0; i < list->count; i++) {
+            SetSalesByProductItem(i + 1, list->names[i], &list->rows[i].totals);
+        }
+    }
+    free(list);
+}
+
+DbJob* NewDbJob(DbJobType type) {
+    DbJob* job = (DbJob*)calloc(1, sizeof(DbJob));
+    if (job) {
+        job->type = type;
+        job->work.mutation = type == DBJOB_ADD_PRODUCT || type == DBJOB_UPDATE_PRODUCT ||
+                             type == DBJOB_DELETE_PRODUCT || type == DBJOB_PURCHASE;
+        job->failedLine = -1;
+    }
+    return job;
+}
+
+static void RunAddProduct(DbWorker* worker, DbJob* job) {
+    const char* sql = SQL_INSERT_PRODUCT;
+    sqlite3_stmt* stmt = StmtCache_Acquire(&worker->stmts, sql);
+
+    if (stmt) {
+        sqlite3_bind_text(stmt, 1, job->name, -1, SQLITE_TRANSIENT);
+        sqlite3_bind_int(stmt, 2, job->quantity);
+        sqlite3_bind_int64(stmt, 3, job->price);
+        job->work.ok = sqlite3_step(stmt) == SQLITE_DONE;
+    }
+    StmtCache_Release(&worker->stmts, stmt);
+}
+
+static void RunUpdateProduct(DbWorker* worker, DbJob* job) {
+    const char* sql = SQL_UPDATE_PRODUCT;
+    sqlite3_stmt* stmt = StmtCache_Acquire(&worker->stmts, sql);
+
+    if (stmt) {
+        sqlite3_bind_text(stmt, 1, job->name, -1, SQLITE_TRANSIENT);
+        sqlite3_bind_int(stmt, 2, job->quantity);
+        sqlite3_bind_int64(stmt, 3, job->price);
+        sqlite3_bind_int(stmt, 4, job->productId);
+        job->work.ok = sqlite3_step(stmt) == SQLITE_DONE;
+    }
+    StmtCache_Release(&worker->stmts, stmt);
+}
+
+static void RunDeleteProduct(DbWorker* worker, DbJob* job) {
+    const char* sql = SQL_DELETE_PRODUCT;
+    sqlite3_stmt* stmt = StmtCache_Acquire(&worker->stmts, sql);
+
+    if (stmt) {
+        sqlite3_bind_int(stmt, 1, job->productId);
+        job->work.ok = sqlite3_step(stmt) == SQLITE_DONE;
+    }
+    StmtCache_Release(&worker->stmts, stmt);
+}
+
+typedef enum {
+    SALE_RECORDED,
+    SALE_NO_STOCK,
+    SALE_NO_PRODUCT,        // deleted since the list showed it
+    SALE_FAILED
+} SaleResult;
+
+// Decrements stock and inserts the sale row inside the caller's write transaction. The guarded
+// UPDATE returns the authoritative price and name, so nothing read by the UI can be stale.
+static SaleResult RecordSale(DbWorker* worker, int productId, int quantity,
+                             Money* unitPrice, char* name, size_t nameSize, sqlite3_int64* saleId) {
+    sqlite3_stmt* stmt;
+    int rc = SQLITE_ERROR;
+
+    stmt = StmtCache_Acquire(&worker->stmts, SQL_PURCHASE_UPDATE_STOCK);
+    if (stmt) {
+        sqlite3_bind_int(stmt, 1, quantity);
+        sqlite3_bind_int(stmt, 2, productId);
+        rc = sqlite3_step(stmt);
+        if (rc == SQLITE_ROW) {
+            const char* text = (const char*)sqlite3_column_text(stmt, 2);
+            *unitPrice = sqlite3_column_int64(stmt, 1);
+            snprintf(name, nameSize, "%s", text ? text : "");
+            rc = sqlite3_step(stmt) == SQLITE_DONE ? SQLITE_ROW : SQLITE_ERROR;
+        }
+    }
+    StmtCache_Release(&worker->stmts, stmt);
+
+    if (rc == SQLITE_DONE) {
+        // Nothing matched the guard: tell a short stock from a product that is gone
+        rc = SQLITE_ERROR;
+        stmt = StmtCache_Acquire(&worker->stmts, SQL_PRODUCT_BY_ID);
+        if (stmt) {
+            sqlite3_bind_int(stmt, 1, productId);
+            rc = sqlite3_step(stmt);
+        }
+        StmtCache_Release(&worker->stmts, stmt);
+        return rc == SQLITE_ROW ? SALE_NO_STOCK : rc == SQLITE_DONE ? SALE_NO_PRODUCT : SALE_FAILED;
+    }
+    if (rc != SQLITE_ROW) {
+        return SALE_FAILED;
+    }
+
+    rc = SQLITE_ERROR;
+    stmt = StmtCache_Acquire(&worker->stmts, SQL_PURCHASE_INSERT_SALE);
+    if (stmt) {
+        sqlite3_bind_int(stmt, 1, productId);
+        sqlite3_bind_text(stmt, 2, name, -1, SQLITE_TRANSIENT);
+        sqlite3_bind_int(stmt, 3, quantity);
+        sqlite3_bind_int64(stmt, 4, quantity * *unitPrice);
+        rc = sqlite3_step(stmt);
+    }
+    StmtCache_Release(&worker->stmts, stmt);
+
+    *saleId = sqlite3_last_insert_rowid(worker->conn);
+    return rc == SQLITE_DONE ? SALE_RECORDED : SALE_FAILED;
+}
+
+static void RunPurchase(DbWorker* worker, DbJob* job) {
+    sqlite3_int64 saleId;
+    SaleResult result = RecordSale(worker, job->productId, job->quantity, &job->price,
+                                   job->name, sizeof(job->name), &saleId);
+
+    if (result == SALE_RECORDED) {
+        job->total = job->quantity * job->price;
+        job->work.ok = 1;
+    } else {
+        job->work.error = result == SALE_NO_STOCK ? "Not enough stock available!" :
+                          result == SALE_NO_PRODUCT ? "This product no longer exists." : "Failed to record sale.";
+    }
+}
+
+// One queued mutation, inside its savepoint of the worker's batch transaction
+void RunMutation(DbWorker* worker, DbWork* work) {
+    DbJob* job = (DbJob*)work;
+
+    switch (job->type) {
+        case DBJOB_ADD_PRODUCT:
+            RunAddProduct(worker, job);
+            break;
+        case DBJOB_UPDATE_PRODUCT:
+            RunUpdateProduct(worker, job);
+            break;
+        case DBJOB_DELETE_PRODUCT:
+            RunDeleteProduct(worker, job);
+            break;
+        case DBJOB_PURCHASE:
+            RunPurchase(worker, job);
+            break;
+        default:
+            break;
+    }
+}
+
+// Every cart line under one receipt header in a single transaction: one fsync per basket.
+// Any line short of stock rolls back the whole basket.
+static void RunCheckout(DbWorker* worker, DbJob* job) {
+    sqlite3_stmt* stmt;
+    int ok = 0;
+
+    if (StmtCache_Exec(&worker->stmts, "BEGIN IMMEDIATE") != SQLITE_OK) {
+        job->work.error = "Failed to start checkout.";
+        return;
+    }
+
+    stmt = StmtCache_Acquire(&worker->stmts, SQL_INSERT_RECEIPT);
+    if (stmt) {
+        sqlite3_bind_int(stmt, 1, job->lineCount);
+        ok = sqlite3_step(stmt) == SQLITE_DONE;
+    }
+    StmtCache_Release(&worker->stmts, stmt);
+    job->receiptId = sqlite3_last_insert_rowid(worker->conn);
+
+    job->total = 0;
+    for (int i = 0; ok && i < job->lineCount; i++) {
+        CartLine* line = &job->lines[i];
+        sqlite3_int64 saleId;
+        SaleResult result = RecordSale(worker, line->productId, line->quantity,
+                                       &line->unitPrice, line->name, sizeof(line->name), &saleId);
+        if (result != SALE_RECORDED) {
+            if (result == SALE_NO_STOCK || result == SALE_NO_PRODUCT) {
+                job->failedLine = i;
+                job->failedMissing = result == SALE_NO_PRODUCT;
+            }
+            ok = 0;
+            break;
+        }
+        job->total += line->quantity * line->unitPrice;
+
+        ok = 0;
+        stmt = StmtCache_Acquire(&worker->stmts, SQL_INSERT_SALE_LINE);
+        if (stmt) {
+            sqlite3_bind_int64(stmt, 1, job->receiptId);
+            sqlite3_bind_int(stmt, 2, i + 1);
+            sqlite3_bind_int64(stmt, 3, saleId);
+            sqlite3_bind_int64(stmt, 4, line->unitPrice);
+            ok = sqlite3_step(stmt) == SQLITE_DONE;
+        }
+        StmtCache_Release(&worker->stmts, stmt);
+    }
+
+    if (ok) {
+        ok = 0;
+        stmt = StmtCache_Acquire(&worker->stmts, SQL_UPDATE_RECEIPT_TOTAL);
+        if (stmt) {
+            sqlite3_bind_int64(stmt, 1, job->total);
+            sqlite3_bind_int64(stmt, 2, job->receiptId);
+            ok = sqlite3_step(stmt) == SQLITE_DONE;
+        }
+        StmtCache_Release(&worker->stmts, stmt);
+    }
+
+    if (!ok || StmtCache_Exec(&worker->stmts, "COMMIT") != SQLITE_OK) {
+        StmtCache_Exec(&worker->stmts, "ROLLBACK");
+        job->work.error = "Failed to record sale.";
+        return;
+    }
+    job->work.ok = 1;
+}
+
+// A supplier catalog in one transaction. Jobs queued behind it wait as they would for any
+// commit; the window stays responsive and the lists reload once when it is done.
+static void RunImportProducts(DbWorker* worker, DbJob* job) {
+    ULONGLONG started = GetTickCount64();
+    int rc = ProductImport_Run(worker->conn, job->path, 0, &job->imported);
+
+    job->elapsedMs = (DWORD)(GetTickCount64() - started);
+    if (rc == SQLITE_CANTOPEN) {
+        job->work.error = "Cannot read the file.";
+    } else if (rc != SQLITE_OK) {
+        job->work.error = "Import failed; no products were changed.";
     }
-    sqlite3_finalize(stmt);
+    job->work.ok = rc == SQLITE_OK;
 }
 
-void LoadSales() {
-    ListView_DeleteAllItems(hListViewSales);
+// PRAGMA data_version on the worker connection changes only when another
+// connection commits, never for the worker's own writes. -1 if it cannot be read.
+static int ReadDataVersion(StatementCache* stmts) {
+    sqlite3_stmt* stmt = StmtCache_Acquire(stmts, "PRAGMA data_version");
+    int version = -1;
 
-    const char* sql = "SELECT id, product_name, quantity_sold, total_amount, sale_date FROM sales ORDER BY id DESC";
-    sqlite3_stmt* stmt;
+    if (stmt && sqlite3_step(stmt) == SQLITE_ROW) {
+        version = sqlite3_column_int(stmt, 0);
+    }
+    StmtCache_Release(stmts, stmt);
+    return version;
+}
 
-    if (sqlite3_prepare_v2(db, sql, -1, &stmt, 0) == SQLITE_OK) {
-        int row = 0;
-        while (sqlite3_step(stmt) == SQLITE_ROW) {
-            LVITEM lvi = {0};
-            char buffer[256];
+// Any job but a mutation. Returns 0 if the job was handed to the reader pool, which posts it when done.
+int RunDbJob(DbWorker* worker, DbWork* work) {
+    DbJob* job = (DbJob*)work;
 
-            lvi.mask = LVIF_TEXT;
-            lvi.iItem = row;
+    switch (job->type) {
+        case DBJOB_ADD_PRODUCT:
+        case DBJOB_UPDATE_PRODUCT:
+        case DBJOB_DELETE_PRODUCT:
+        case DBJOB_PURCHASE:
+            // Batched by the worker, see RunMutation
+            break;
+        case DBJOB_CHECKOUT:
+            RunCheckout(worker, job);
+            break;
+        case DBJOB_SALES_PAGE:
+            // Read first: a commit landing in between only costs a spare reload later.
+            // A reader's snapshot starts after this, so it never misses a counted commit.
+            job->page->dataVersion = ReadDataVersion(&worker->stmts);
+            if (DbReaders_Submit(&g_dbReaders, &job->work)) {
+                return 0;
+            }
+            job->work.ok = FetchSalesPage(&worker->stmts, job->page->beforeId, job->page);
+            break;
+        case DBJOB_SALES_SUMMARY:
+            job->summary->dataVersion = ReadDataVersion(&worker->stmts);
+            if (DbReaders_Submit(&g_dbReaders, &job->work)) {
+                return 0;
+            }
+            job->work.ok = FetchSalesSummary(&worker->stmts, job->summary);
+            break;
+        case DBJOB_DATA_VERSION:
+            job->dataVersion = ReadDataVersion(&worker->stmts);
+            job->work.ok = job->dataVersion >= 0;
+            break;
+        case DBJOB_IMPORT_PRODUCTS:
+            RunImportProducts(worker, job);
+            break;
+        case DBJOB_LOAD_SALES_MIRROR:
+            if (DbReaders_Submit(&g_dbReaders, &job->work)) {
+                return 0;
+            }
+            job->work.ok = FetchSalesMirror(&worker->stmts, job->mirror);
+            break;
+        case DBJOB_SALES_BY_PRODUCT_NAMES:
+            // Only without readers: the UI thread submits it to the pool first
+            job->work.ok = FetchProductNames(&worker->stmts, job->byProduct);
+            break;
+    }
+    return 1;
+}
 
-            sprintf(buffer, "%d", sqlite3_column_int(stmt, 0));
-            lvi.pszText = buffer;
-            ListView_InsertItem(hListViewSales, &lvi);
+// Hand a finished job to the UI thread, or drop it if the window is gone
+void PostDbJob(DbWork* work) {
+    DbJob* job = (DbJob*)work;
+
+    if (!PostMessage(g_hMainWnd, WM_APP_DB_RESULT, 0, (LPARAM)job)) {
+        free(job->page);
+        free(job->summary);
+        free(job->lines);
+        free(job->path);
+        free(job->byProduct);
+        if (job->mirror) {
+            SalesMirror_Free(job->mirror);
+            free(job->mirror);
+        }
+        free(job);
+    }
+}
 
-            ListView_SetItemText(hListViewSales, row, 1,
-                (char*)sqlite3_column_text(stmt, 1));
+// A report job on a reader's connection
+void ReadDbJob(DbReader* reader, DbWork* work) {
+    DbJob* job = (DbJob*)work;
+
+    if (job->type == DBJOB_SALES_PAGE) {
+        job->work.ok = FetchSalesPage(&reader->stmts, job->page->beforeId, job->page);
+    } else if (job->type == DBJOB_SALES_SUMMARY) {
+        job->work.ok = FetchSalesSummary(&reader->stmts, job->summary);
+    } else if (job->type == DBJOB_LOAD_SALES_MIRROR) {
+        job->work.ok = FetchSalesMirror(&reader->stmts, job->mirror);
+    } else if (job->type == DBJOB_SALES_BY_PRODUCT_NAMES) {
+        job->work.ok = FetchProductNames(&reader->stmts, job->byProduct);
+    }
+}
 
-            sprintf(buffer, "%d", sqlite3_column_int(stmt, 2));
-            ListView_SetItemText(hListViewSales, row, 2, buffer);
+// WM_APP_DB_RESULT handler, on the UI thread
+void OnDbJobDone(DbJob* job) {
+    char message[256], totalStr[MONEY_TEXT_SIZE];
 
-            sprintf(buffer, "%.2f", sqlite3_column_double(stmt, 3));
-            ListView_SetItemText(hListViewSales, row, 3, buffer);
+    if (job->type == DBJOB_SALES_PAGE) {
+        OnSalesPageLoaded(job->page, job->work.ok);
+        free(job);
+        return;
+    }
+    if (job->type == DBJOB_SALES_SUMMARY) {
+        OnSalesSummaryLoaded(job->summary, job->work.ok);
+        free(job);
+        return;
+    }
+    if (job->type == DBJOB_LOAD_SALES_MIRROR) {
+        OnSalesMirrorLoaded(job->mirror, job->work.ok);
+        free(job);
+        return;
+    }
+    if (job->type == DBJOB_SALES_BY_PRODUCT_NAMES) {
+        OnSalesByProductNamed(job->byProduct, job->work.ok);
+        free(job);
+        return;
+    }
+    if (job->type == DBJOB_DATA_VERSION) {
+        OnDataVersionChecked(job->dataVersion, job->work.ok);
+        free(job);
+        return;
+    }
 
-            ListView_SetItemText(hListViewSales, row, 4,
-                (char*)sqlite3_column_text(stmt, 4));
+    // Patch the lists before the message box so they are current behind it
+    ApplyChanges(&job->work.changes);
 
-            row++;
-        }
+    switch (job->type) {
+        case DBJOB_ADD_PRODUCT:
+            if (job->work.ok) {
+                ShowSuccess("Product added successfully!");
+            } else {
+                ShowError("Failed to add product. Name might already exist.");
+            }
+            break;
+        case DBJOB_UPDATE_PRODUCT:
+            if (job->work.ok) {
+                ShowSuccess("Product updated successfully!");
+            } else {
+                ShowError("Failed to update product.");
+            }
+            break;
+        case DBJOB_DELETE_PRODUCT:
+            if (job->work.ok) {
+                ShowSuccess("Product deleted successfully!");
+            } else {
+                ShowError("Failed to delete product.");
+            }
+            break;
+        case DBJOB_PURCHASE:
+            if (job->work.ok) {
+                sprintf(message, "Purchase successful!\nTotal: K%s", FormatMoney(job->total, totalStr));
+                ShowSuccess(message);
+            } else {
+                ShowError(job->work.error);
+            }
+            break;
+        case DBJOB_CHECKOUT:
+            g_cart.checkingOut = 0;
+            if (job->work.ok) {
+                g_cart.count = 0;
+                RefreshCart();
+                sprintf(message, "Checkout complete!\nReceipt #%lld, %d line(s)\nTotal: K%s",
+                        (long long)job->receiptId, job->lineCount, FormatMoney(job->total, totalStr));
+                ShowSuccess(message);
+            } else {
+                // Keep the cart so the short line can be fixed and checked out again
+                RefreshCart();
+                if (job->failedLine >= 0) {
+                    snprintf(message, sizeof(message), job->failedMissing ? "%s is no longer in the catalog." :
+                             "Not enough stock for %s.", job->lines[job->failedLine].name);
+                    ShowError(message);
+                } else {
+                    ShowError(job->work.error);
+                }
+            }
+            free(job->lines);
+            break;
+        case DBJOB_IMPORT_PRODUCTS:
+            EnableWindow(hBtnImport, TRUE);
+            UpdateStatusBar();
+            if (job->work.ok) {
+                const ProductImportResult* imported = &job->imported;
+                int length = snprintf(message, sizeof(message),
+                                      "Imported %lld product(s), %lld of them new.\n"
+                                      "%.0f rows/sec, peak memory %lld KB",
+                                      (long long)imported->rows, (long long)imported->added,
+                                      imported->rows * 1000.0 / (job->elapsedMs ? job->elapsedMs : 1),
+                                      (long long)(imported->peakMemory / 1024));
+                if (imported->skipped && length > 0 && length < (int)sizeof(message)) {
+                    snprintf(message + length, sizeof(message) - length,
+                             "\n%lld line(s) skipped, the first at record %lld.",
+                             (long long)imported->skipped, (long long)imported->firstSkipped);
+                }
+                ShowSuccess(message);
+            } else {
+                ShowError(job->work.error);
+            }
+            free(job->path);
+            break;
+        default:
+            break;
     }
-    sqlite3_finalize(stmt);
+    free(job);
 }
 
 void AddProduct(HWND hwnd) {
@@ -655,30 +2497,21 @@ void AddProduct(HWND hwnd) {
         }
 
         int qty = atoi(qtyStr);
-        double price = atof(priceStr);
+        Money price = 0;
 
-        if (price <= 0) {
+        if (!ParseMoney(priceStr, &price) || price <= 0) {
             MessageBox(hwnd, "Price must be greater than 0", "Validation Error", MB_OK | MB_ICONWARNING);
             return;
         }
 
-        // Insert into database
-        const char* sql = "INSERT INTO products (name, quantity, price) VALUES (?, ?, ?)";
-        sqlite3_stmt* stmt;
-
-        if (sqlite3_prepare_v2(db, sql, -1, &stmt, 0) == SQLITE_OK) {
-            sqlite3_bind_text(stmt, 1, name, -1, SQLITE_TRANSIENT);
-            sqlite3_bind_int(stmt, 2, qty);
-            sqlite3_bind_double(stmt, 3, price);
-
-            if (sqlite3_step(stmt) == SQLITE_DONE) {
-                ShowSuccess("Product added successfully!");
-                LoadProducts();
-            } else {
-                ShowError("Failed to add product. Name might already exist.");
-            }
+        // Insert into database; the worker reports back through OnDbJobDone
+        DbJob* job = NewDbJob(DBJOB_ADD_PRODUCT);
+        if (job) {
+            snprintf(job->name, sizeof(job->name), "%s", name);
+            job->quantity = qty;
+            job->price = price;
+            DbWorker_Submit(&g_dbWorker, &job->work);
         }
-        sqlite3_finalize(stmt);
     } else {
         // Cancel was clicked
         if (g_hCurrentDialog) {
@@ -790,30 +2623,21 @@ void UpdateProduct(HWND hwnd) {
         }
 
         int newQty = atoi(qtyStr);
-        double newPrice = atof(priceStr);
+        Money newPrice = 0;
 
-        if (newPrice <= 0) {
+        if (!ParseMoney(priceStr, &newPrice) || newPrice <= 0) {
             MessageBox(hwnd, "Price must be greater than 0", "Validation Error", MB_OK | MB_ICONWARNING);
             return;
         }
 
-        const char* sql = "UPDATE products SET name = ?, quantity = ?, price = ? WHERE id = ?";
-        sqlite3_stmt* stmt;
-
-        if (sqlite3_prepare_v2(db, sql, -1, &stmt, 0) == SQLITE_OK) {
-            sqlite3_bind_text(stmt, 1, newName, -1, SQLITE_TRANSIENT);
-            sqlite3_bind_int(stmt, 2, newQty);
-            sqlite3_bind_double(stmt, 3, newPrice);
-            sqlite3_bind_int(stmt, 4, atoi(id));
-
-            if (sqlite3_step(stmt) == SQLITE_DONE) {
-                ShowSuccess("Product updated successfully!");
-                LoadProducts();
-            } else {
-                ShowError("Failed to update product.");
-            }
+        DbJob* job = NewDbJob(DBJOB_UPDATE_PRODUCT);
+        if (job) {
+            job->productId = atoi(id);
+            snprintf(job->name, sizeof(job->name), "%s", newName);
+            job->quantity = newQty;
+            job->price = newPrice;
+            DbWorker_Submit(&g_dbWorker, &job->work);
         }
-        sqlite3_finalize(stmt);
     } else {
         if (g_hCurrentDialog) {
             DestroyWindow(g_hCurrentDialog);
@@ -823,6 +2647,17 @@ void UpdateProduct(HWND hwnd) {
         SetForegroundWindow(hwnd);
     }
 }
+void UpdateStatusBar() {
+    char status[160];
+    int length = snprintf(status, sizeof(status), "Profile: %s   Statements prepared: %ld   Prepares avoided: %ld",
+                          g_pragmaProfile->name, g_stmtCache.prepares, g_stmtCache.reuses);
+    if (g_startupMs && length > 0 && length < (int)sizeof(status)) {
+        snprintf(status + length, sizeof(status) - length, "   Startup: %llu ms",
+                 (unsigned long long)g_startupMs);
+    }
+    SendMessage(hStatusBar, SB_SETTEXT, 0, (LPARAM)status);
+}
+
 void ShowError(const char* message) {
     MessageBox(NULL, message, "Error", MB_OK | MB_ICONERROR);
 }
@@ -849,20 +2684,11 @@ void DeleteProduct(HWND hwnd) {
                            MB_YESNO | MB_ICONQUESTION);
 
     if (result == IDYES) {
-        const char* sql = "DELETE FROM products WHERE id = ?";
-        sqlite3_stmt* stmt;
-
-        if (sqlite3_prepare_v2(db, sql, -1, &stmt, 0) == SQLITE_OK) {
-            sqlite3_bind_int(stmt, 1, atoi(id));
-
-            if (sqlite3_step(stmt) == SQLITE_DONE) {
-                ShowSuccess("Product deleted successfully!");
-                LoadProducts();
-            } else {
-                ShowError("Failed to delete product.");
-            }
+        DbJob* job = NewDbJob(DBJOB_DELETE_PRODUCT);
+        if (job) {
+            job->productId = atoi(id);
+            DbWorker_Submit(&g_dbWorker, &job->work);
         }
-        sqlite3_finalize(stmt);
     }
 }
 
@@ -873,19 +2699,15 @@ void PurchaseProduct(HWND hwnd) {
         return;
     }
 
-    char id[20], name[256], qty[20], price[20];
+    // The stock shown may lag a commit, so it is neither checked nor shown here: the
+    // worker's guarded UPDATE is the only stock check
+    char id[20], name[256], price[20];
     ListView_GetItemText(hListViewProducts, selectedIndex, 0, id, sizeof(id));
     ListView_GetItemText(hListViewProducts, selectedIndex, 1, name, sizeof(name));
-    ListView_GetItemText(hListViewProducts, selectedIndex, 2, qty, sizeof(qty));
     ListView_GetItemText(hListViewProducts, selectedIndex, 3, price, sizeof(price));
 
-    int currentQty = atoi(qty);
-    double unitPrice = atof(price);
-
-    if (currentQty <= 0) {
-        ShowError("Product is out of stock!");
-        return;
-    }
+    Money unitPrice = 0;
+    ParseMoney(price, &unitPrice);
 
     // Register dialog class
     static BOOL registered = FALSE;
@@ -914,9 +2736,9 @@ void PurchaseProduct(HWND hwnd) {
         hwnd, NULL, hInst, NULL
     );
 
-    char info[512];
-    sprintf(info, "Product: %s\nAvailable: %d units\nPrice: K%.2f per unit",
-            name, currentQty, unitPrice);
+    char info[512], unitPriceStr[MONEY_TEXT_SIZE];
+    sprintf(info, "Product: %s\nPrice: K%s per unit",
+            name, FormatMoney(unitPrice, unitPriceStr));
 
     CreateWindow("STATIC", info, WS_CHILD | WS_VISIBLE,
                  20, 20, 350, 60, g_hCurrentDialog, NULL, hInst, NULL);
@@ -971,52 +2793,11 @@ void PurchaseProduct(HWND hwnd) {
             return;
         }
 
-        if (purchaseQty > currentQty) {
-            MessageBox(hwnd, "Not enough stock available!", "Error", MB_OK | MB_ICONWARNING);
-            return;
-        }
-
-        sqlite3_exec(db, "BEGIN TRANSACTION", 0, 0, 0);
-
-        const char* updateSql = "UPDATE products SET quantity = quantity - ? WHERE id = ?";
-        sqlite3_stmt* stmt;
-        int success = 0;
-
-        if (sqlite3_prepare_v2(db, updateSql, -1, &stmt, 0) == SQLITE_OK) {
-            sqlite3_bind_int(stmt, 1, purchaseQty);
-            sqlite3_bind_int(stmt, 2, atoi(id));
-
-            if (sqlite3_step(stmt) == SQLITE_DONE) {
-                success = 1;
-            }
-        }
-        sqlite3_finalize(stmt);
-
-        if (success) {
-            const char* insertSql = "INSERT INTO sales (product_id, product_name, quantity_sold, total_amount) VALUES (?, ?, ?, ?)";
-            double totalAmount = purchaseQty * unitPrice;
-
-            if (sqlite3_prepare_v2(db, insertSql, -1, &stmt, 0) == SQLITE_OK) {
-                sqlite3_bind_int(stmt, 1, atoi(id));
-                sqlite3_bind_text(stmt, 2, name, -1, SQLITE_TRANSIENT);
-                sqlite3_bind_int(stmt, 3, purchaseQty);
-                sqlite3_bind_double(stmt, 4, totalAmount);
-
-                if (sqlite3_step(stmt) == SQLITE_DONE) {
-                    char successMsg[256];
-                    sprintf(successMsg, "Purchase successful!\nTotal: K%.2f", totalAmount);
-                    sqlite3_exec(db, "COMMIT", 0, 0, 0);
-                    ShowSuccess(successMsg);
-                    LoadProducts();
-                } else {
-                    sqlite3_exec(db, "ROLLBACK", 0, 0, 0);
-                    ShowError("Failed to record sale.");
-                }
-            }
-            sqlite3_finalize(stmt);
-        } else {
-            sqlite3_exec(db, "ROLLBACK", 0, 0, 0);
-            ShowError("Failed to update inventory.");
+        DbJob* job = NewDbJob(DBJOB_PURCHASE);
+        if (job) {
+            job->productId = atoi(id);
+            job->quantity = purchaseQty;
+            DbWorker_Submit(&g_dbWorker, &job->work);
         }
     } else {
         // Cancel was clicked
@@ -1029,71 +2810,317 @@ void PurchaseProduct(HWND hwnd) {
     }
 }
 
-void SearchProducts(HWND hwnd) {
-    char searchText[256];
-    GetWindowText(hEditSearch, searchText, 256);
+// Redraw the Cart tab from g_cart
+void RefreshCart() {
+    char buffer[256], totalStr[MONEY_TEXT_SIZE];
+    Money total = 0;
 
-    if (strlen(searchText) == 0) {
-        LoadProducts();
+    ListView_DeleteAllItems(hListViewCart);
+
+    for (int i = 0; i < g_cart.count; i++) {
+        const CartLine* line = &g_cart.lines[i];
+        LVITEM lvi = {0};
+
+        lvi.mask = LVIF_TEXT;
+        lvi.iItem = i;
+        lvi.pszText = (char*)line->name;
+        ListView_InsertItem(hListViewCart, &lvi);
+
+        sprintf(buffer, "%d", line->quantity);
+        ListView_SetItemText(hListViewCart, i, 1, buffer);
+
+        FormatMoney(line->unitPrice, buffer);
+        ListView_SetItemText(hListViewCart, i, 2, buffer);
+
+        FormatMoney(line->quantity * line->unitPrice, buffer);
+        ListView_SetItemText(hListViewCart, i, 3, buffer);
+
+        total += line->quantity * line->unitPrice;
+    }
+
+    sprintf(buffer, "%d line(s)   Total: K%s", g_cart.count, FormatMoney(total, totalStr));
+    SetWindowText(hCartTotal, buffer);
+    EnableWindow(hBtnCheckout, g_cart.count > 0 && !g_cart.checkingOut);
+}
+
+// Put one unit of the selected product in the cart, or one more of a line already there
+void AddToCart(HWND hwnd) {
+    int selectedIndex = ListView_GetNextItem(hListViewProducts, -1, LVNI_SELECTED);
+    if (selectedIndex == -1) {
+        ShowError("Please select a product to add to the cart.");
         return;
     }
 
-    ListView_DeleteAllItems(hListViewProducts);
+    if (g_cart.checkingOut) {
+        ShowError("Please wait for the checkout to finish.");
+        return;
+    }
 
-    char sql[512];
-    sprintf(sql, "SELECT id, name, quantity, price, created_at FROM products WHERE name LIKE '%%%s%%' ORDER BY id", searchText);
+    const ProductRow* row = ProductCache_GetRow(&g_productCache, selectedIndex);
+    if (!row) {
+        return;
+    }
 
-    sqlite3_stmt* stmt;
+    // The cached stock may lag a commit, so it limits nothing here; the checkout's
+    // guarded UPDATE refuses a line that is short
+    CartLine* line = NULL;
+    for (int i = 0; i < g_cart.count; i++) {
+        if (g_cart.lines[i].productId == row->id) {
+            line = &g_cart.lines[i];
+            break;
+        }
+    }
 
-    if (sqlite3_prepare_v2(db, sql, -1, &stmt, 0) == SQLITE_OK) {
-        int row = 0;
-        while (sqlite3_step(stmt) == SQLITE_ROW) {
-            LVITEM lvi = {0};
-            char buffer[256];
+    if (!line) {
+        if (g_cart.count == CART_MAX_LINES) {
+            ShowError("The cart is full.");
+            return;
+        }
+        line = &g_cart.lines[g_cart.count++];
+        line->productId = row->id;
+        snprintf(line->name, sizeof(line->name), "%s", row->name);
+        line->quantity = 0;
+    }
 
-            lvi.mask = LVIF_TEXT;
-            lvi.iItem = row;
+    line->quantity++;
+    line->unitPrice = row->price;
+    RefreshCart();
+}
 
-            sprintf(buffer, "%d", sqlite3_column_int(stmt, 0));
-            lvi.pszText = buffer;
-            ListView_InsertItem(hListViewProducts, &lvi);
+void RemoveCartLine(HWND hwnd) {
+    int selectedIndex = ListView_GetNextItem(hListViewCart, -1, LVNI_SELECTED);
+    if (selectedIndex == -1 || selectedIndex >= g_cart.count) {
+        ShowError("Please select a cart line to remove.");
+        return;
+    }
 
-            ListView_SetItemText(hListViewProducts, row, 1,
-                (char*)sqlite3_column_text(stmt, 1));
+    if (g_cart.checkingOut) {
+        return;
+    }
 
-            sprintf(buffer, "%d", sqlite3_column_int(stmt, 2));
-            ListView_SetItemText(hListViewProducts, row, 2, buffer);
+    memmove(&g_cart.lines[selectedIndex], &g_cart.lines[selectedIndex + 1],
+            (g_cart.count - selectedIndex - 1) * sizeof(CartLine));
+    g_cart.count--;
+    RefreshCart();
+}
+
+void ClearCart(HWND hwnd) {
+    if (g_cart.checkingOut) {
+        return;
+    }
 
-            sprintf(buffer, "%.2f", sqlite3_column_double(stmt, 3));
-            ListView_SetItemText(hListViewProducts, row, 3, buffer);
+    g_cart.count = 0;
+    RefreshCart();
+}
 
-            ListView_SetItemText(hListViewProducts, row, 4,
-                (char*)sqlite3_column_text(stmt, 4));
+// Hand a copy of the cart to the worker; the cart itself stays until the receipt commits
+void Checkout(HWND hwnd) {
+    if (g_cart.count == 0) {
+        ShowError("The cart is empty.");
+        return;
+    }
+
+    if (g_cart.checkingOut) {
+        return;
+    }
+
+    DbJob* job = NewDbJob(DBJOB_CHECKOUT);
+    if (!job) {
+        return;
+    }
+
+    job->lines = (CartLine*)malloc(g_cart.count * sizeof(CartLine));
+    if (!job->lines) {
+        free(job);
+        return;
+    }
+    memcpy(job->lines, g_cart.lines, g_cart.count * sizeof(CartLine));
+    job->lineCount = g_cart.count;
+
+    g_cart.checkingOut = 1;
+    EnableWindow(hBtnCheckout, FALSE);
+    DbWorker_Submit(&g_dbWorker, &job->work);
+}
+
+// Ask for a CSV file of name,quantity,price lines and load it on the worker
+void ImportProducts(HWND hwnd) {
+    char path[MAX_PATH] = "";
+    OPENFILENAME ofn = {0};
+
+    ofn.lStructSize = sizeof(ofn);
+    ofn.hwndOwner = hwnd;
+    ofn.lpstrFilter = "CSV files (*.csv)\0*.csv\0All files (*.*)\0*.*\0";
+    ofn.lpstrFile = path;
+    ofn.nMaxFile = sizeof(path);
+    ofn.lpstrTitle = "Import Products";
+    // The database and inventory.ini are found relative to the working directory
+    ofn.Flags = OFN_FILEMUSTEXIST | OFN_PATHMUSTEXIST | OFN_HIDEREADONLY | OFN_NOCHANGEDIR;
+    if (!GetOpenFileName(&ofn)) {
+        return;
+    }
+
+    DbJob* job = NewDbJob(DBJOB_IMPORT_PRODUCTS);
+    if (!job) {
+        return;
+    }
+    job->path = (char*)malloc(strlen(path) + 1);
+    if (!job->path) {
+        free(job);
+        return;
+    }
+    strcpy(job->path, path);
+
+    EnableWindow(hBtnImport, FALSE);
+    SendMessage(hStatusBar, SB_SETTEXT, 0, (LPARAM)"Importing products...");
+    DbWorker_Submit(&g_dbWorker, &job->work);
+}
+
+// Opening the Sales Report keeps what is already on screen: this process's commits
+// reached it through ApplyChanges, so it is stale only if another connection or
+// process wrote since it was read. The worker answers that with data_version.
+static void ShowSalesReport() {
+    // The mirror is kept current by ApplyChanges; only other writers' sales need reading
+    if (g_salesByProduct.enabled) {
+        CatchUpSalesMirror();
+        RefreshSalesByProduct();
+        return;
+    }
+
+    int loaded = g_salesSummary.enabled ? g_salesSummary.loaded : g_salesPager.loaded;
+    int pending = g_salesSummary.enabled ? g_salesSummary.pending
+                                         : g_salesPager.prefetchPending && !g_salesPager.loaded;
+
+    if (pending) {
+        return;
+    }
+
+    DbJob* job = loaded ? NewDbJob(DBJOB_DATA_VERSION) : NULL;
+    if (job) {
+        DbWorker_Submit(&g_dbWorker, &job->work);
+    } else if (g_salesSummary.enabled) {
+        LoadSalesSummary();
+    } else {
+        LoadSales();
+    }
+}
 
-            row++;
+// Reload the report on screen if another connection committed since it was read
+void OnDataVersionChecked(int dataVersion, int ok) {
+    if (g_salesSummary.enabled) {
+        if (g_salesSummary.loaded && (!ok || dataVersion != g_salesSummary.dataVersion)) {
+            LoadSalesSummary();
         }
+    } else if (g_salesPager.loaded && (!ok || dataVersion != g_salesPager.dataVersion)) {
+        LoadSales();
+    }
+}
+
+void ShowTab(int tabIndex) {
+    int cartShow = tabIndex == 2 ? SW_SHOW : SW_HIDE;
+
+    TabCtrl_SetCurSel(hTabControl, tabIndex);
+    ShowWindow(hListViewProducts, tabIndex == 0 ? SW_SHOW : SW_HIDE);
+    ShowWindow(hListViewSales, tabIndex == 1 && !g_salesSummary.enabled && !g_salesByProduct.enabled
+                               ? SW_SHOW : SW_HIDE);
+    ShowWindow(hListViewSalesSummary, tabIndex == 1 && g_salesSummary.enabled ? SW_SHOW : SW_HIDE);
+    ShowWindow(hListViewSalesByProduct, tabIndex == 1 && g_salesByProduct.enabled ? SW_SHOW : SW_HIDE);
+    ShowWindow(hChkSalesSummary, tabIndex == 1 ? SW_SHOW : SW_HIDE);
+    ShowWindow(hChkSalesByProduct, tabIndex == 1 && g_salesByProduct.available ? SW_SHOW : SW_HIDE);
+    ShowWindow(hListViewCart, cartShow);
+    ShowWindow(hBtnCartRemove, cartShow);
+    ShowWindow(hBtnCartClear, cartShow);
+    ShowWindow(hBtnCheckout, cartShow);
+    ShowWindow(hCartTotal, cartShow);
+
+    if (tabIndex == 1) {
+        ShowSalesReport();
+    } else if (tabIndex == 2) {
+        RefreshCart();
+    }
+}
+
+// Progress callback while a search scans: abandon it if the user typed again
+static int SearchProgressHandler(void* arg) {
+    return HIWORD(GetQueueStatus(QS_KEY)) != 0;
+}
+
+void SearchProducts(HWND hwnd) {
+    char searchText[256];
+    GetWindowText(hEditSearch, searchText, 256);
+
+    KillTimer(hwnd, IDT_SEARCH_DEBOUNCE);
+
+    if (strlen(searchText) == 0) {
+        LoadProducts();
+        return;
+    }
+
+    if (CanRefineSearch(&g_searchResults, searchText)) {
+        RefineSearch(&g_productCache, &g_searchResults, searchText);
+    } else {
+        // Give up on the scan as soon as another key is waiting; that key
+        // restarts the debounce and a fresh search replaces this one
+        sqlite3_progress_handler(db, 1000, SearchProgressHandler, NULL);
+        int complete = ProductCache_Reset(&g_productCache, searchText, &g_searchResults);
+        sqlite3_progress_handler(db, 0, NULL, NULL);
+
+        if (!complete) {
+            SetTimer(hwnd, IDT_SEARCH_DEBOUNCE, SEARCH_DEBOUNCE_MS, NULL);
+        }
+    }
+
+    ListView_SetItemCountEx(hListViewProducts, g_productCache.totalRows, 0);
+    InvalidateRect(hListViewProducts, NULL, TRUE);
+    UpdateStatusBar();
+}
+
+// Search box edits: narrowing the last result set is instant, anything that
+// needs SQLite waits until typing pauses
+void OnSearchTextChanged(HWND hwnd) {
+    char searchText[256];
+    GetWindowText(hEditSearch, searchText, 256);
+
+    if (searchText[0] && CanRefineSearch(&g_searchResults, searchText)) {
+        SearchProducts(hwnd);
+    } else {
+        SetTimer(hwnd, IDT_SEARCH_DEBOUNCE, SEARCH_DEBOUNCE_MS, NULL);
     }
-    sqlite3_finalize(stmt);
 }
 
 LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
     switch (msg) {
         case WM_CREATE:
+            g_hMainWnd = hwnd;
             CreateControls(hwnd);
             break;
 
+        case WM_SIZE:
+            SendMessage(hStatusBar, WM_SIZE, 0, 0);
+            break;
+
+        case WM_APP_DB_RESULT:
+            OnDbJobDone((DbJob*)lParam);
+            break;
+
         case WM_NOTIFY: {
             LPNMHDR pnmhdr = (LPNMHDR)lParam;
             if (pnmhdr->idFrom == ID_TAB_CONTROL && pnmhdr->code == TCN_SELCHANGE) {
-                int tabIndex = TabCtrl_GetCurSel(hTabControl);
-                if (tabIndex == 0) {
-                    ShowWindow(hListViewProducts, SW_SHOW);
-                    ShowWindow(hListViewSales, SW_HIDE);
-                } else if (tabIndex == 1) {
-                    ShowWindow(hListViewProducts, SW_HIDE);
-                    ShowWindow(hListViewSales, SW_SHOW);
-                    LoadSales();
-                }
+                ShowTab(TabCtrl_GetCurSel(hTabControl));
+            }
+            else if (pnmhdr->idFrom == ID_LISTVIEW_PRODUCTS && pnmhdr->code == LVN_GETDISPINFO) {
+                GetProductDispInfo((NMLVDISPINFO*)lParam);
+            }
+            else if (pnmhdr->idFrom == ID_LISTVIEW_PRODUCTS && pnmhdr->code == LVN_ODCACHEHINT) {
+                NMLVCACHEHINT* hint = (NMLVCACHEHINT*)lParam;
+                ProductCache_Hint(&g_productCache, hint->iFrom, hint->iTo);
+            }
+            else if (pnmhdr->idFrom == ID_LISTVIEW_SALES && pnmhdr->code == LVN_ENDSCROLL) {
+                CheckSalesScrollEnd();
+            }
+            else if (pnmhdr->idFrom == ID_LISTVIEW_SALES && pnmhdr->code == LVN_ITEMCHANGED &&
+                     (((NMLISTVIEW*)lParam)->uChanged & LVIF_STATE)) {
+                // Keyboard navigation moves the selection without an LVN_ENDSCROLL
+                CheckSalesScrollEnd();
             }
             break;
         }
@@ -1116,14 +3143,64 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
                     LoadProducts();
                     break;
                 case ID_BTN_VIEW_SALES:
-                    TabCtrl_SetCurSel(hTabControl, 1);
-                    ShowWindow(hListViewProducts, SW_HIDE);
-                    ShowWindow(hListViewSales, SW_SHOW);
-                    LoadSales();
+                    ShowTab(1);
+                    break;
+                case ID_BTN_ADD_TO_CART:
+                    AddToCart(hwnd);
+                    break;
+                case ID_BTN_CART_REMOVE:
+                    RemoveCartLine(hwnd);
+                    break;
+                case ID_BTN_CART_CLEAR:
+                    ClearCart(hwnd);
+                    break;
+                case ID_BTN_CHECKOUT:
+                    Checkout(hwnd);
+                    break;
+                case ID_BTN_IMPORT:
+                    ImportProducts(hwnd);
+                    break;
+                case ID_CHK_SALES_SUMMARY:
+                    if (HIWORD(wParam) == BN_CLICKED) {
+                        g_salesSummary.enabled = SendMessage(hChkSalesSummary, BM_GETCHECK, 0, 0) == BST_CHECKED;
+                        // One report at a time
+                        if (g_salesSummary.enabled) {
+                            g_salesByProduct.enabled = 0;
+                            SendMessage(hChkSalesByProduct, BM_SETCHECK, BST_UNCHECKED, 0);
+                        }
+                        ShowTab(1);
+                    }
+                    break;
+                case ID_CHK_SALES_BY_PRODUCT:
+                    if (HIWORD(wParam) == BN_CLICKED) {
+                        g_salesByProduct.enabled = SendMessage(hChkSalesByProduct, BM_GETCHECK, 0, 0) == BST_CHECKED;
+                        if (g_salesByProduct.enabled) {
+                            g_salesSummary.enabled = 0;
+                            SendMessage(hChkSalesSummary, BM_SETCHECK, BST_UNCHECKED, 0);
+                        }
+                        ShowTab(1);
+                    }
                     break;
                 case ID_BTN_SEARCH:
                     SearchProducts(hwnd);
                     break;
+                case ID_EDIT_SEARCH:
+                    if (HIWORD(wParam) == EN_CHANGE) {
+                        OnSearchTextChanged(hwnd);
+                    }
+                    break;
+            }
+            break;
+
+        case WM_TIMER:
+            if (wParam == IDT_SEARCH_DEBOUNCE) {
+                SearchProducts(hwnd);
+            } else if (wParam == IDT_SALES_BY_PRODUCT) {
+                KillTimer(hwnd, IDT_SALES_BY_PRODUCT);
+                g_salesByProduct.refreshQueued = 0;
+                if (IsWindowVisible(hListViewSalesByProduct)) {
+                    RefreshSalesByProduct();
+                }
             }
             break;
 
@@ -0,0 +1,92 @@
+/*
+ * Money is held as a whole number of ngwee (1/100 kwacha) so that prices,
+ * totals and sums are exact integer arithmetic. Shared by the GUI and the CSV importer.
+ */
+
+#ifndef MONEY_H
+#define MONEY_H
+
+#include <string.h>
+#include <sqlite3.h>
+
+typedef sqlite3_int64 Money;
+#define MONEY_SCALE 100
+#define MONEY_TEXT_SIZE 24
+
+// Parse "12", "12.5" or "12.50" into ngwee. Returns 0 if the text is not an amount.
+static inline int ParseMoney(const char* text, Money* amount) {
+    Money whole = 0, fraction = 0;
+    int negative = 0, digits = 0, fractionDigits = 0;
+
+    while (*text == ' ') {
+        text++;
+    }
+    if (*text == '-') {
+        negative = 1;
+        text++;
+    }
+
+    for (; *text >= '0' && *text <= '9'; text++, digits++) {
+        // Fifteen whole digits keep whole * MONEY_SCALE far inside int64
+        if (digits == 15) {
+            return 0;
+        }
+        whole = whole * 10 + (*text - '0');
+    }
+
+    if (*text == '.') {
+        for (text++; *text >= '0' && *text <= '9'; text++, digits++) {
+            // Round on the third decimal, ignore the rest
+            if (fractionDigits < 2) {
+                fraction = fraction * 10 + (*text - '0');
+            } else if (fractionDigits == 2 && *text >= '5') {
+                fraction++;
+            }
+            fractionDigits++;
+        }
+    }
+
+    while (*text == ' ') {
+        text++;
+    }
+    if (digits == 0 || *text != '\0') {
+        return 0;
+    }
+
+    for (; fractionDigits < 2; fractionDigits++) {
+        fraction *= 10;
+    }
+
+    *amount = whole * MONEY_SCALE + fraction;
+    if (negative) {
+        *amount = -*amount;
+    }
+    return 1;
+}
+
+// Format ngwee as "1234.50" into buffer (at least MONEY_TEXT_SIZE bytes).
+// Digits are written back to front, no printf involved.
+static inline char* FormatMoney(Money amount, char* buffer) {
+    char digits[MONEY_TEXT_SIZE];
+    char* p = digits + sizeof(digits);
+    sqlite3_uint64 value = amount < 0 ? (sqlite3_uint64)0 - (sqlite3_uint64)amount : (sqlite3_uint64)amount;
+
+    *--p = '\0';
+    *--p = (char)('0' + value % 10);
+    value /= 10;
+    *--p = (char)('0' + value % 10);
+    value /= 10;
+    *--p = '.';
+    do {
+        *--p = (char)('0' + value % 10);
+        value /= 10;
+    } while (value);
+    if (amount < 0) {
+        *--p = '-';
+    }
+
+    memcpy(buffer, p, digits + sizeof(digits) - p);
+    return buffer;
+}
+
+#endif
@@ -0,0 +1,93 @@
+/*
+ * Lock-free multi-producer, single-consumer queue behind DbWorker_Submit in
+ * db_worker.c. Intrusive: a queued record starts with an MpscNode.
+ * Uses the GCC/Clang __atomic builtins, which MinGW provides in C and C++ alike.
+ *
+ * Producers never wait on each other or on the consumer: a push is one atomic
+ * exchange and one store. The consumer pops with plain loads, except that taking
+ * the last node costs it one push of its own. Based on Dmitry Vyukov's design.
+ */
+
+#ifndef MPSC_QUEUE_H
+#define MPSC_QUEUE_H
+
+#include <stddef.h>
+
+typedef struct MpscNode {
+    struct MpscNode* next;
+} MpscNode;
+
+typedef struct {
+    MpscNode* head;     // last pushed node, swapped by producers
+    MpscNode* tail;     // next node to pop, consumer only
+    MpscNode stub;      // keeps the list non-empty so push and pop never touch the same pointer
+    int sleeping;       // the consumer is about to block, see MpscQueue_Sleep
+} MpscQueue;
+
+static inline void MpscQueue_Init(MpscQueue* q) {
+    q->stub.next = NULL;
+    q->head = &q->stub;
+    q->tail = &q->stub;
+    q->sleeping = 0;
+}
+
+static inline void MpscQueue_Link(MpscQueue* q, MpscNode* node) {
+    MpscNode* prev;
+
+    __atomic_store_n(&node->next, (MpscNode*)NULL, __ATOMIC_RELAXED);
+    prev = __atomic_exchange_n(&q->head, node, __ATOMIC_ACQ_REL);
+    // Until this store the consumer sees the queue end at prev
+    __atomic_store_n(&prev->next, node, __ATOMIC_SEQ_CST);
+}
+
+// Any thread. Returns 1 if the consumer announced it is going to sleep, in which
+// case the caller must wake it with whatever it blocks on.
+static inline int MpscQueue_Push(MpscQueue* q, MpscNode* node) {
+    MpscQueue_Link(q, node);
+    return __atomic_exchange_n(&q->sleeping, 0, __ATOMIC_SEQ_CST) != 0;
+}
+
+// Consumer only. NULL when the queue is empty, or when the next node's push has
+// swapped head but not linked it yet; that producer wakes a sleeping consumer.
+static inline MpscNode* MpscQueue_Pop(MpscQueue* q) {
+    MpscNode* tail = q->tail;
+    MpscNode* next = __atomic_load_n(&tail->next, __ATOMIC_SEQ_CST);
+
+    if (tail == &q->stub) {
+        if (!next) {
+            return NULL;
+        }
+        q->tail = next;
+        tail = next;
+        next = __atomic_load_n(&next->next, __ATOMIC_SEQ_CST);
+    }
+    if (next) {
+        q->tail = next;
+        return tail;
+    }
+
+    // tail is the last node: put the stub behind it so tail can be handed out
+    if (tail != __atomic_load_n(&q->head, __ATOMIC_SEQ_CST)) {
+        return NULL;
+    }
+    MpscQueue_Link(q, &q->stub);
+    next = __atomic_load_n(&tail->next, __ATOMIC_SEQ_CST);
+    if (next) {
+        q->tail = next;
+        return tail;
+    }
+    return NULL;
+}
+
+// Consumer only: call before the last MpscQueue_Pop ahead of blocking. If that pop
+// comes back empty, any producer it missed sees the flag and must wake the consumer.
+static inline void MpscQueue_Sleep(MpscQueue* q) {
+    __atomic_store_n(&q->sleeping, 1, __ATOMIC_SEQ_CST);
+}
+
+// Consumer only: back from blocking, or it found work and did not block
+static inline void MpscQueue_Awake(MpscQueue* q) {
+    __atomic_store_n(&q->sleeping, 0, __ATOMIC_SEQ_CST);
+}
+
+#endif
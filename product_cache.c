@@ -0,0 +1,597 @@
+/*
+ * Product row cache behind the owner-data product list
+ * Statements are prepared on first use and stay prepared until the cache is freed. Each is
+ * reset as soon as its rows are read, which ends its read transaction on the connection.
+ */
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "product_cache.h"
+#include "db_queries.h"
+
+static sqlite3_stmt* ProductCache_Statement(ProductRowCache* cache, sqlite3_stmt** stmt, const char* sql) {
+    if (!*stmt && sqlite3_prepare_v3(cache->conn, sql, -1, SQLITE_PREPARE_PERSISTENT, stmt, 0) != SQLITE_OK) {
+        sqlite3_finalize(*stmt);
+        *stmt = NULL;
+    }
+    return *stmt;
+}
+
+static void ProductCache_Done(sqlite3_stmt* stmt) {
+    if (stmt) {
+        sqlite3_reset(stmt);
+        sqlite3_clear_bindings(stmt);
+    }
+}
+
+static void ProductCache_ClearSlots(ProductRowCache* cache) {
+    for (int i = 0; i < PRODUCT_CACHE_SLOTS; i++) {
+        cache->slots[i].page = -1;
+        cache->slots[i].lastUsed = 0;
+    }
+}
+
+void ProductCache_Init(ProductRowCache* cache, sqlite3* conn, int ftsAvailable) {
+    memset(cache, 0, sizeof(*cache));
+    cache->conn = conn;
+    cache->ftsAvailable = ftsAvailable;
+    ProductCache_ClearSlots(cache);
+}
+
+/*
+ * Page counts are also kept as a Fenwick tree: node i, counting from 1, holds the rows of
+ * pages i - (i & -i) to i - 1. The rows before a page are a sum of O(log pages) nodes, and
+ * a row removed or added changes O(log pages) nodes, so no page start is ever shifted.
+ */
+
+// Rows in the pages before `page`, which is the list index of its first row
+static int ProductCache_PageStart(const ProductRowCache* cache, int page) {
+    int rows = 0;
+    for (int node = page; node > 0; node -= node & -node) {
+        rows += cache->pageTree[node];
+    }
+    return rows;
+}
+
+static void ProductCache_AddToPage(ProductRowCache* cache, int page, int delta) {
+    cache->pages[page].count += delta;
+    for (int node = page + 1; node <= cache->pageCount; node += node & -node) {
+        cache->pageTree[node] += delta;
+        cache->stats.pageTableWrites++;
+    }
+}
+
+// Rebuild every node after a scan filled in the page counts, in one pass
+static void ProductCache_BuildTree(ProductRowCache* cache) {
+    for (int node = 1; node <= cache->pageCount; node++) {
+        cache->pageTree[node] = cache->pages[node - 1].count;
+    }
+    for (int node = 1; node <= cache->pageCount; node++) {
+        int parent = node + (node & -node);
+        if (parent <= cache->pageCount) {
+            cache->pageTree[parent] += cache->pageTree[node];
+        }
+    }
+}
+
+// Append an empty page anchor, growing the page table as needed
+static int ProductCache_AddPage(ProductRowCache* cache, sqlite3_int64 firstId) {
+    if (cache->pageCount == cache->pageCapacity) {
+        int newCapacity = cache->pageCapacity ? cache->pageCapacity * 2 : 64;
+        ProductPage* pages = (ProductPage*)realloc(cache->pages, newCapacity * sizeof(ProductPage));
+        if (!pages) {
+            return 0;
+        }
+        cache->pages = pages;
+
+        int* tree = (int*)realloc(cache->pageTree, (newCapacity + 1) * sizeof(int));
+        if (!tree) {
+            return 0;
+        }
+        cache->pageTree = tree;
+        cache->pageCapacity = newCapacity;
+    }
+
+    ProductPage* page = &cache->pages[cache->pageCount++];
+    page->firstId = firstId;
+    page->count = 0;
+
+    // The new node covers pages already counted, up to the one before it
+    int node = cache->pageCount;
+    cache->pageTree[node] = ProductCache_PageStart(cache, node - 1) -
+                            ProductCache_PageStart(cache, node - (node & -node));
+    return 1;
+}
+
+static int SearchResults_Add(SearchResults* results, sqlite3_int64 id, const char* name) {
+    size_t nameSize = strlen(name) + 1;
+
+    if (results->count == SEARCH_REFINE_LIMIT) {
+        return 0;
+    }
+
+    if (results->count == results->capacity) {
+        int newCapacity = results->capacity ? results->capacity * 2 : 1024;
+        sqlite3_int64* ids = (sqlite3_int64*)realloc(results->ids, newCapacity * sizeof(sqlite3_int64));
+        if (!ids) {
+            return 0;
+        }
+        results->ids = ids;
+
+        size_t* offsets = (size_t*)realloc(results->nameOffsets, newCapacity * sizeof(size_t));
+        if (!offsets) {
+            return 0;
+        }
+        results->nameOffsets = offsets;
+        results->capacity = newCapacity;
+    }
+
+    if (results->namesUsed + nameSize > results->namesCapacity) {
+        size_t newCapacity = results->namesCapacity ? results->namesCapacity * 2 : 32768;
+        while (newCapacity < results->namesUsed + nameSize) {
+            newCapacity *= 2;
+        }
+        char* names = (char*)realloc(results->names, newCapacity);
+        if (!names) {
+            return 0;
+        }
+        results->names = names;
+        results->namesCapacity = newCapacity;
+    }
+
+    results->ids[results->count] = id;
+    results->nameOffsets[results->count] = results->namesUsed;
+    memcpy(results->names + results->namesUsed, name, nameSize);
+    results->namesUsed += nameSize;
+    results->count++;
+    return 1;
+}
+
+void SearchResults_Clear(SearchResults* results) {
+    results->valid = 0;
+    results->count = 0;
+    results->namesUsed = 0;
+    results->term[0] = '\0';
+}
+
+void SearchResults_Free(SearchResults* results) {
+    SearchResults_Clear(results);
+    free(results->ids);
+    free(results->nameOffsets);
+    free(results->names);
+    results->ids = NULL;
+    results->nameOffsets = NULL;
+    results->names = NULL;
+    results->capacity = 0;
+    results->namesCapacity = 0;
+}
+
+// Rebuild the page table with one pass over the id index. Only ids are read,
+// so this is far cheaper than materialising every row.
+int ProductCache_Rescan(ProductRowCache* cache, SearchResults* capture) {
+    cache->pageCount = 0;
+    cache->totalRows = 0;
+    cache->lastId = 0;
+    cache->useClock = 0;
+    ProductCache_ClearSlots(cache);
+
+    static const char* const scanSql[] = {
+        SQL_PRODUCT_IDS,
+        SQL_PRODUCT_IDS_LIKE,
+        SQL_PRODUCT_IDS_MATCH
+    };
+    sqlite3_stmt* stmt;
+    int rc = SQLITE_ERROR;
+
+    if (capture) {
+        SearchResults_Clear(capture);
+        if (cache->filterMode != FILTER_NONE) {
+            snprintf(capture->term, sizeof(capture->term), "%s", cache->term);
+            capture->valid = 1;
+        }
+    }
+
+    cache->stats.scans++;
+    stmt = ProductCache_Statement(cache, &cache->scanStmts[cache->filterMode], scanSql[cache->filterMode]);
+    if (stmt) {
+        if (cache->filterMode != FILTER_NONE) {
+            sqlite3_bind_text(stmt, 1, cache->filter, -1, SQLITE_TRANSIENT);
+        }
+
+        while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+            sqlite3_int64 id = sqlite3_column_int64(stmt, 0);
+
+            if (cache->totalRows % PRODUCT_PAGE_SIZE == 0) {
+                if (!ProductCache_AddPage(cache, id)) {
+                    break;
+                }
+            }
+            cache->pages[cache->pageCount - 1].count++;
+            cache->totalRows++;
+            cache->lastId = id;
+
+            if (capture && capture->valid) {
+                const char* name = (const char*)sqlite3_column_text(stmt, 1);
+                capture->valid = SearchResults_Add(capture, id, name ? name : "");
+            }
+        }
+        cache->stats.idsScanned += cache->totalRows;
+    }
+    ProductCache_Done(stmt);
+    ProductCache_BuildTree(cache);
+
+    if (rc != SQLITE_DONE && capture) {
+        SearchResults_Clear(capture);
+    }
+    return rc == SQLITE_DONE;
+}
+
+// Lay out pages over an already known, ascending list of ids
+static void ProductCache_SetIds(ProductRowCache* cache, const sqlite3_int64* ids, int count) {
+    cache->pageCount = 0;
+    cache->totalRows = 0;
+    cache->lastId = 0;
+    cache->useClock = 0;
+    ProductCache_ClearSlots(cache);
+
+    for (int i = 0; i < count; i++) {
+        if (i % PRODUCT_PAGE_SIZE == 0 && !ProductCache_AddPage(cache, ids[i])) {
+            break;
+        }
+        cache->pages[cache->pageCount - 1].count++;
+        cache->totalRows++;
+        cache->lastId = ids[i];
+    }
+    ProductCache_BuildTree(cache);
+}
+
+// Turn search text into an FTS5 phrase: wrapped in quotes, inner quotes doubled
+static void BuildMatchPhrase(const char* text, char* phrase, size_t size) {
+    size_t n = 0;
+
+    phrase[n++] = '"';
+    for (; *text && n + 3 < size; text++) {
+        if (*text == '"') {
+            phrase[n++] = '"';
+        }
+        phrase[n++] = *text;
+    }
+    phrase[n++] = '"';
+    phrase[n] = '\0';
+}
+
+static void ProductCache_SetFilter(ProductRowCache* cache, const char* filter) {
+    cache->filterMode = FILTER_NONE;
+    cache->term[0] = '\0';
+    cache->filter[0] = '\0';
+
+    // Trigrams need at least three characters to match anything
+    if (filter && filter[0]) {
+        if (cache->ftsAvailable && strlen(filter) >= 3) {
+            cache->filterMode = FILTER_MATCH;
+            BuildMatchPhrase(filter, cache->filter, sizeof(cache->filter));
+        } else {
+            cache->filterMode = FILTER_LIKE;
+            snprintf(cache->filter, sizeof(cache->filter), "%%%s%%", filter);
+        }
+        snprintf(cache->term, sizeof(cache->term), "%s", filter);
+    }
+}
+
+int ProductCache_Reset(ProductRowCache* cache, const char* filter, SearchResults* capture) {
+    ProductCache_SetFilter(cache, filter);
+    return ProductCache_Rescan(cache, capture);
+}
+
+// ASCII case-insensitive substring test, the same matching LIKE does
+static int ContainsNoCase(const char* text, const char* term) {
+    size_t termLength = strlen(term);
+
+    for (; *text; text++) {
+        size_t i = 0;
+        while (i < termLength && text[i] &&
+               tolower((unsigned char)text[i]) == tolower((unsigned char)term[i])) {
+            i++;
+        }
+        if (i == termLength) {
+            return 1;
+        }
+    }
+    return termLength == 0;
+}
+
+// Terms with wildcards or non-ASCII text go back to SQLite, where LIKE and the
+// trigram tokenizer have the last word on what matches.
+int CanRefineSearch(const SearchResults* results, const char* term) {
+    if (!results->valid || !results->term[0] || !ContainsNoCase(term, results->term)) {
+        return 0;
+    }
+
+    for (const char* p = term; *p; p++) {
+        if (*p == '%' || *p == '_' || (unsigned char)*p >= 0x80) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+void RefineSearch(ProductRowCache* cache, SearchResults* results, const char* term) {
+    int kept = 0;
+
+    for (int i = 0; i < results->count; i++) {
+        if (ContainsNoCase(results->names + results->nameOffsets[i], term)) {
+            results->ids[kept] = results->ids[i];
+            results->nameOffsets[kept] = results->nameOffsets[i];
+            kept++;
+        }
+    }
+    results->count = kept;
+    snprintf(results->term, sizeof(results->term), "%s", term);
+
+    // Page fetches still run the SQL filter, so it must describe the new term
+    ProductCache_SetFilter(cache, term);
+    ProductCache_SetIds(cache, results->ids, results->count);
+}
+
+// The page containing a list index, found by descending the tree, and the index's row
+// within it. Empty pages hold no index, so they are never returned.
+static int ProductCache_FindPage(const ProductRowCache* cache, int index, int* row) {
+    int page = 0, step = 1;
+
+    if (index < 0 || index >= cache->totalRows) {
+        return -1;
+    }
+    while (step * 2 <= cache->pageCount) {
+        step *= 2;
+    }
+    // Skip whole subtrees of pages that end at or before the index
+    for (; step > 0; step /= 2) {
+        if (page + step <= cache->pageCount && cache->pageTree[page + step] <= index) {
+            page += step;
+            index -= cache->pageTree[page];
+        }
+    }
+    if (row) {
+        *row = index;
+    }
+    return page;
+}
+
+static void ProductCache_ReadRow(ProductRowCache* cache, sqlite3_stmt* stmt, ProductRow* r) {
+    const char* name = (const char*)sqlite3_column_text(stmt, 1);
+    const char* createdAt = (const char*)sqlite3_column_text(stmt, 4);
+
+    r->id = sqlite3_column_int(stmt, 0);
+    r->quantity = sqlite3_column_int(stmt, 2);
+    r->price = sqlite3_column_int64(stmt, 3);
+    snprintf(r->name, sizeof(r->name), "%s", name ? name : "");
+    snprintf(r->createdAt, sizeof(r->createdAt), "%s", createdAt ? createdAt : "");
+    cache->stats.rowsRead++;
+}
+
+// Fill a slot with one page: a single index seek on id plus LIMIT
+static void ProductCache_LoadPage(ProductRowCache* cache, ProductCacheSlot* slot, int pageIndex) {
+    const ProductPage* page = &cache->pages[pageIndex];
+    static const char* const pageSql[] = {
+        SQL_PRODUCT_PAGE,
+        SQL_PRODUCT_PAGE_LIKE,
+        SQL_PRODUCT_PAGE_MATCH
+    };
+    sqlite3_stmt* stmt;
+    int row = 0;
+
+    cache->stats.pageLoads++;
+    stmt = ProductCache_Statement(cache, &cache->pageStmts[cache->filterMode], pageSql[cache->filterMode]);
+    if (stmt) {
+        int param = 1;
+        if (cache->filterMode != FILTER_NONE) {
+            sqlite3_bind_text(stmt, param++, cache->filter, -1, SQLITE_TRANSIENT);
+        }
+        sqlite3_bind_int64(stmt, param++, page->firstId);
+        sqlite3_bind_int(stmt, param, page->count);
+
+        while (row < page->count && sqlite3_step(stmt) == SQLITE_ROW) {
+            ProductCache_ReadRow(cache, stmt, &slot->rows[row++]);
+        }
+    }
+    ProductCache_Done(stmt);
+
+    // Rows deleted behind our back leave blanks until the next reset
+    for (; row < PRODUCT_PAGE_SIZE; row++) {
+        memset(&slot->rows[row], 0, sizeof(ProductRow));
+    }
+
+    slot->page = pageIndex;
+}
+
+// Return the slot holding a page, loading it into the least recently used slot if needed
+static ProductCacheSlot* ProductCache_FetchPage(ProductRowCache* cache, int pageIndex) {
+    ProductCacheSlot* victim = &cache->slots[0];
+
+    for (int i = 0; i < PRODUCT_CACHE_SLOTS; i++) {
+        ProductCacheSlot* slot = &cache->slots[i];
+        if (slot->page == pageIndex) {
+            slot->lastUsed = ++cache->useClock;
+            return slot;
+        }
+        if (slot->page == -1 || slot->lastUsed < victim->lastUsed) {
+            victim = slot;
+        }
+    }
+
+    ProductCache_LoadPage(cache, victim, pageIndex);
+    victim->lastUsed = ++cache->useClock;
+    return victim;
+}
+
+void ProductCache_Hint(ProductRowCache* cache, int from, int to) {
+    int first = ProductCache_FindPage(cache, from, NULL);
+    int last = ProductCache_FindPage(cache, to, NULL);
+    int fetched = 0;
+    if (first == -1 || last == -1) {
+        return;
+    }
+
+    // Never hint more pages than the cache can hold at once
+    for (int page = first; page <= last && fetched < PRODUCT_CACHE_SLOTS; page++) {
+        if (cache->pages[page].count > 0) {
+            ProductCache_FetchPage(cache, page);
+            fetched++;
+        }
+    }
+}
+
+const ProductRow* ProductCache_GetRow(ProductRowCache* cache, int index) {
+    int row;
+    int pageIndex = ProductCache_FindPage(cache, index, &row);
+    if (pageIndex == -1) {
+        return NULL;
+    }
+
+    ProductCacheSlot* slot = ProductCache_FetchPage(cache, pageIndex);
+    return &slot->rows[row];
+}
+
+// Find the page whose keyset range holds an id: the last page with firstId <= id
+static int ProductCache_FindPageById(const ProductRowCache* cache, sqlite3_int64 id) {
+    int lo = 0, hi = cache->pageCount - 1, found = -1;
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        if (cache->pages[mid].firstId <= id) {
+            found = mid;
+            lo = mid + 1;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return found;
+}
+
+int ProductCache_RefreshRow(ProductRowCache* cache, sqlite3_int64 id) {
+    int pageIndex = ProductCache_FindPageById(cache, id);
+    if (pageIndex == -1) {
+        return -1;
+    }
+
+    for (int i = 0; i < PRODUCT_CACHE_SLOTS; i++) {
+        ProductCacheSlot* slot = &cache->slots[i];
+        if (slot->page != pageIndex) {
+            continue;
+        }
+
+        for (int row = 0; row < cache->pages[pageIndex].count; row++) {
+            if (slot->rows[row].id != id) {
+                continue;
+            }
+
+            sqlite3_stmt* stmt;
+            stmt = ProductCache_Statement(cache, &cache->byIdStmt, SQL_PRODUCT_BY_ID);
+            if (stmt) {
+                sqlite3_bind_int64(stmt, 1, id);
+                if (sqlite3_step(stmt) == SQLITE_ROW) {
+                    ProductCache_ReadRow(cache, stmt, &slot->rows[row]);
+                }
+            }
+            ProductCache_Done(stmt);
+            return ProductCache_PageStart(cache, pageIndex) + row;
+        }
+    }
+    return -1;
+}
+
+// A new id above every listed id only grows the last page
+void ProductCache_AppendRow(ProductRowCache* cache, sqlite3_int64 id) {
+    int last = cache->pageCount - 1;
+
+    if (last == -1 || cache->pages[last].count == PRODUCT_PAGE_SIZE) {
+        if (!ProductCache_AddPage(cache, id)) {
+            return;
+        }
+        last = cache->pageCount - 1;
+    }
+
+    ProductCache_AddToPage(cache, last, 1);
+    cache->totalRows++;
+    cache->lastId = id;
+
+    // The cached copy of the last page is now short by one row
+    for (int i = 0; i < PRODUCT_CACHE_SLOTS; i++) {
+        if (cache->slots[i].page == last) {
+            cache->slots[i].page = -1;
+        }
+    }
+}
+
+// Removing an id shrinks its page; firstId stays a valid lower bound even if
+// it was the deleted row, and a page left empty stays in the table. A cached
+// copy of the page drops the row in place; no other page is touched.
+void ProductCache_RemoveRow(ProductRowCache* cache, sqlite3_int64 id) {
+    int pageIndex = ProductCache_FindPageById(cache, id);
+    if (pageIndex == -1 || cache->pages[pageIndex].count == 0) {
+        return;
+    }
+
+    for (int i = 0; i < PRODUCT_CACHE_SLOTS; i++) {
+        ProductCacheSlot* slot = &cache->slots[i];
+        if (slot->page != pageIndex) {
+            continue;
+        }
+
+        int count = cache->pages[pageIndex].count;
+        int row = 0;
+        while (row < count && slot->rows[row].id != id) {
+            row++;
+        }
+        if (row == count) {
+            // Not among the rows read, so the copy no longer matches the page
+            slot->page = -1;
+        } else {
+            memmove(&slot->rows[row], &slot->rows[row + 1], (count - row - 1) * sizeof(ProductRow));
+            memset(&slot->rows[count - 1], 0, sizeof(ProductRow));
+        }
+    }
+
+    ProductCache_AddToPage(cache, pageIndex, -1);
+    cache->totalRows--;
+}
+
+int ProductCache_ApplyChange(ProductRowCache* cache, int op, sqlite3_int64 id, int* index) {
+    if (op == SQLITE_UPDATE) {
+        *index = ProductCache_RefreshRow(cache, id);
+        return *index != -1 ? PRODUCT_LIST_REDRAW_ROW : PRODUCT_LIST_UNCHANGED;
+    }
+    if (op == SQLITE_INSERT && id > cache->lastId) {
+        ProductCache_AppendRow(cache, id);
+    } else if (op == SQLITE_DELETE) {
+        ProductCache_RemoveRow(cache, id);
+    } else {
+        // An insert below the highest id shifts rows, rebuild the page table
+        ProductCache_Rescan(cache, NULL);
+    }
+    return PRODUCT_LIST_COUNT;
+}
+
+size_t ProductCache_Bytes(const ProductRowCache* cache) {
+    return sizeof(*cache) + (size_t)cache->pageCapacity * (sizeof(ProductPage) + sizeof(int));
+}
+
+void ProductCache_Free(ProductRowCache* cache) {
+    for (int i = 0; i < FILTER_MODES; i++) {
+        sqlite3_finalize(cache->scanStmts[i]);
+        sqlite3_finalize(cache->pageStmts[i]);
+        cache->scanStmts[i] = NULL;
+        cache->pageStmts[i] = NULL;
+    }
+    sqlite3_finalize(cache->byIdStmt);
+    cache->byIdStmt = NULL;
+
+    free(cache->pages);
+    free(cache->pageTree);
+    cache->pages = NULL;
+    cache->pageTree = NULL;
+    cache->pageCount = 0;
+    cache->pageCapacity = 0;
+    cache->totalRows = 0;
+}
@@ -0,0 +1,140 @@
+/*
+ * Product row cache behind the owner-data product list
+ * The list holds no strings of its own; rows are pulled on demand from a small window of
+ * cached pages. Pages are keyset ranges on products.id, so fetching any page is an index
+ * seek, never OFFSET. The cache reads through the connection it is given and keeps its own
+ * prepared statements on it, so it runs the same without a window, as the tests and the
+ * benchmarks do.
+ */
+
+#ifndef PRODUCT_CACHE_H
+#define PRODUCT_CACHE_H
+
+#include <stddef.h>
+#include <sqlite3.h>
+#include "money.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PRODUCT_PAGE_SIZE 256
+#define PRODUCT_CACHE_SLOTS 4
+
+// How the product list is filtered
+#define FILTER_NONE 0
+#define FILTER_LIKE 1       // name LIKE '%term%', for terms too short for trigrams
+#define FILTER_MATCH 2      // trigram full-text index on products.name
+#define FILTER_MODES 3
+
+// Ids and names of the last search, kept so a longer term typed on top of it
+// can be answered by filtering in memory instead of querying again
+#define SEARCH_REFINE_LIMIT 50000
+
+typedef struct {
+    int id;
+    int quantity;
+    Money price;
+    char name[256];
+    char createdAt[32];
+} ProductRow;
+
+typedef struct {
+    sqlite3_int64 firstId;  // lower bound: page holds the first `count` matching ids >= firstId
+    int count;              // 0 once every row of the page is deleted; the page stays
+} ProductPage;
+
+typedef struct {
+    int page;               // -1 when the slot is empty
+    unsigned int lastUsed;
+    ProductRow rows[PRODUCT_PAGE_SIZE];
+} ProductCacheSlot;
+
+// Work done since the cache was initialised, for the tests and benchmarks
+typedef struct {
+    sqlite3_int64 scans;        // id scans that rebuilt the page table
+    sqlite3_int64 idsScanned;
+    sqlite3_int64 pageLoads;
+    sqlite3_int64 rowsRead;     // full rows materialised, by page loads and row refreshes
+    sqlite3_int64 pageTableWrites;  // page counts adjusted by single row changes
+} ProductCacheStats;
+
+typedef struct {
+    sqlite3* conn;
+    int ftsAvailable;       // products_fts exists, so terms of three or more characters use MATCH
+    sqlite3_stmt* scanStmts[FILTER_MODES];
+    sqlite3_stmt* pageStmts[FILTER_MODES];
+    sqlite3_stmt* byIdStmt;
+    ProductPage* pages;
+    int* pageTree;          // page counts as a Fenwick tree, so a page's list index is a prefix sum
+    int pageCount;
+    int pageCapacity;
+    int totalRows;
+    sqlite3_int64 lastId;   // highest id in the list, new rows above it are appends
+    int filterMode;
+    char term[256];         // search text as typed
+    char filter[256];       // LIKE pattern or FTS5 query, empty for the full catalog
+    unsigned int useClock;
+    ProductCacheStats stats;
+    ProductCacheSlot slots[PRODUCT_CACHE_SLOTS];
+} ProductRowCache;
+
+typedef struct {
+    char term[256];
+    int valid;
+    int count;
+    int capacity;
+    sqlite3_int64* ids;
+    size_t* nameOffsets;
+    char* names;
+    size_t namesUsed;
+    size_t namesCapacity;
+} SearchResults;
+
+// Start empty on conn; nothing is read until the first reset
+void ProductCache_Init(ProductRowCache* cache, sqlite3* conn, int ftsAvailable);
+
+// List filter, NULL or empty for the full catalog, then one pass over the matching ids.
+// Filtered scans also read names into capture, when given, for in-memory refinement later.
+// Returns 0 if the scan was cut short, e.g. interrupted by a newer search.
+int ProductCache_Reset(ProductRowCache* cache, const char* filter, SearchResults* capture);
+int ProductCache_Rescan(ProductRowCache* cache, SearchResults* capture);
+
+// Load the pages holding list indexes from..to, at most PRODUCT_CACHE_SLOTS of them
+void ProductCache_Hint(ProductRowCache* cache, int from, int to);
+// The row at a list index, valid until the next call into the cache; NULL past the end
+const ProductRow* ProductCache_GetRow(ProductRowCache* cache, int index);
+
+// What the list has to do after ProductCache_ApplyChange
+#define PRODUCT_LIST_UNCHANGED 0
+#define PRODUCT_LIST_REDRAW_ROW 1   // redraw the row at *index
+#define PRODUCT_LIST_COUNT 2        // set the item count to totalRows and repaint
+
+// Row changes committed elsewhere. RefreshRow re-reads a cached row and returns its list
+// index, or -1 when it is not cached. AppendRow takes ids above lastId only. RemoveRow and
+// AppendRow cost O(log pages) and leave every other cached page in place.
+int ProductCache_RefreshRow(ProductRowCache* cache, sqlite3_int64 id);
+void ProductCache_AppendRow(ProductRowCache* cache, sqlite3_int64 id);
+void ProductCache_RemoveRow(ProductRowCache* cache, sqlite3_int64 id);
+// One products change from sqlite3_update_hook: op is SQLITE_INSERT, SQLITE_UPDATE or
+// SQLITE_DELETE. An insert below lastId rescans. Returns a PRODUCT_LIST_ action.
+int ProductCache_ApplyChange(ProductRowCache* cache, int op, sqlite3_int64 id, int* index);
+
+// Bytes held for the catalog: the page table plus the cache itself
+size_t ProductCache_Bytes(const ProductRowCache* cache);
+// Releases the page table and finalizes the statements; Init again before reuse
+void ProductCache_Free(ProductRowCache* cache);
+
+void SearchResults_Clear(SearchResults* results);
+void SearchResults_Free(SearchResults* results);
+
+// A term that contains the previous one can only match a subset of its rows
+int CanRefineSearch(const SearchResults* results, const char* term);
+// Narrow the previous results to a longer term without touching the database
+void RefineSearch(ProductRowCache* cache, SearchResults* results, const char* term);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
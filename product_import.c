@@ -0,0 +1,333 @@
+/*
+ * Bulk product import from CSV
+ * A tokenizer over a fixed buffer feeds one prepared upsert inside one transaction
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "product_import.h"
+#include "db_schema.h"
+#include "db_queries.h"
+#include "money.h"
+
+#define IMPORT_FIELDS 3             // name, quantity, price
+#define IMPORT_FIELD_SIZE 256       // longest name the product dialog accepts, plus the terminator
+
+// Word-at-a-time byte search: eight bytes per step on any 64-bit target, no intrinsics needed
+typedef unsigned long long CsvWord;
+
+#define CSV_ONES 0x0101010101010101ULL
+#define CSV_HIGHS 0x8080808080808080ULL
+#define CSV_REPEAT(c) (CSV_ONES * (unsigned char)(c))
+// Nonzero if any byte of word is zero. Exact as a yes/no answer; which byte is found by rescanning.
+#define CSV_HAS_ZERO(word) (((word) - CSV_ONES) & ~(word) & CSV_HIGHS)
+
+typedef struct {
+    FILE* file;
+    char* buffer;
+    size_t pos;
+    size_t end;
+    sqlite3_int64 bytes;
+    sqlite3_int64 record;           // records read so far
+    char fields[IMPORT_FIELDS][IMPORT_FIELD_SIZE];
+    size_t lengths[IMPORT_FIELDS];
+    int fieldCount;                 // fields in the record, including ignored ones
+    int tooLong;                    // a field did not fit
+} CsvReader;
+
+// Length of the run before the first comma, quote, CR or LF
+static size_t ScanUnquoted(const char* text, size_t length) {
+    size_t i = 0;
+
+    for (; i + sizeof(CsvWord) <= length; i += sizeof(CsvWord)) {
+        CsvWord word;
+
+        memcpy(&word, text + i, sizeof(word));
+        if (CSV_HAS_ZERO(word ^ CSV_REPEAT(',')) | CSV_HAS_ZERO(word ^ CSV_REPEAT('"')) |
+            CSV_HAS_ZERO(word ^ CSV_REPEAT('\n')) | CSV_HAS_ZERO(word ^ CSV_REPEAT('\r'))) {
+            break;
+        }
+    }
+    for (; i < length; i++) {
+        char c = text[i];
+        if (c == ',' || c == '"' || c == '\n' || c == '\r') {
+            break;
+        }
+    }
+    return i;
+}
+
+static int CsvReader_Fill(CsvReader* reader) {
+    reader->pos = 0;
+    reader->end = fread(reader->buffer, 1, PRODUCT_IMPORT_BUFFER, reader->file);
+    reader->bytes += (sqlite3_int64)reader->end;
+    return reader->end > 0;
+}
+
+static void CsvReader_Append(CsvReader* reader, const char* text, size_t length) {
+    int field = reader->fieldCount - 1;
+
+    if (field >= IMPORT_FIELDS || length == 0) {
+        return;
+    }
+    if (reader->lengths[field] + length >= IMPORT_FIELD_SIZE) {
+        reader->tooLong = 1;
+        return;
+    }
+    memcpy(reader->fields[field] + reader->lengths[field], text, length);
+    reader->lengths[field] += length;
+}
+
+// Reads the next record into fields, each terminated. Returns 0 at the end of the file.
+static int CsvReader_Next(CsvReader* reader) {
+    enum { FIELD_START, UNQUOTED, QUOTED, AFTER_QUOTE } state = FIELD_START;
+    int started = 0;
+    int i;
+
+    for (i = 0; i < IMPORT_FIELDS; i++) {
+        reader->lengths[i] = 0;
+    }
+    reader->fieldCount = 1;
+    reader->tooLong = 0;
+
+    for (;;) {
+        const char* text;
+        size_t length, run;
+
+        // The last record may end without a line break
+        if (reader->pos == reader->end && !CsvReader_Fill(reader)) {
+            if (!started) {
+                return 0;
+            }
+            break;
+        }
+        text = reader->buffer + reader->pos;
+        length = reader->end - reader->pos;
+        started = 1;
+
+        if (state == FIELD_START) {
+            if (*text == '"') {
+                reader->pos++;
+                state = QUOTED;
+            } else {
+                state = UNQUOTED;
+            }
+        } else if (state == UNQUOTED) {
+            run = ScanUnquoted(text, length);
+            CsvReader_Append(reader, text, run);
+            reader->pos += run;
+            if (run == length) {
+                continue;
+            }
+            reader->pos++;
+            if (text[run] == ',') {
+                reader->fieldCount++;
+                state = FIELD_START;
+            } else if (text[run] == '\n') {
+                break;
+            } else if (text[run] == '"') {
+                // A stray quote inside an unquoted field is taken literally
+                CsvReader_Append(reader, text + run, 1);
+            }
+            // CR is dropped, so CRLF and LF line ends read alike
+        } else if (state == QUOTED) {
+            const char* quote = (const char*)memchr(text, '"', length);
+
+            run = quote ? (size_t)(quote - text) : length;
+            CsvReader_Append(reader, text, run);
+            reader->pos += run;
+            if (quote) {
+                reader->pos++;
+                state = AFTER_QUOTE;
+            }
+        } else {
+            // A doubled quote is a literal one; otherwise the quoted part has ended
+            if (*text == '"') {
+                CsvReader_Append(reader, text, 1);
+                reader->pos++;
+                state = QUOTED;
+            } else {
+                state = UNQUOTED;
+            }
+        }
+    }
+
+    for (i = 0; i < IMPORT_FIELDS; i++) {
+        reader->fields[i][reader->lengths[i]] = '\0';
+    }
+    reader->record++;
+    return 1;
+}
+
+// Whole units, at most nine digits so any value fits an int
+static int ParseQuantity(const char* text, int* quantity) {
+    int value = 0, digits = 0;
+
+    while (*text == ' ') {
+        text++;
+    }
+    for (; *text >= '0' && *text <= '9'; text++) {
+        if (++digits > 9) {
+            return 0;
+        }
+        value = value * 10 + (*text - '0');
+    }
+    while (*text == ' ') {
+        text++;
+    }
+    if (digits == 0 || *text != '\0') {
+        return 0;
+    }
+    *quantity = value;
+    return 1;
+}
+
+// First column of a one-row query with an optional id parameter, -1 on error
+static sqlite3_int64 QueryCount(sqlite3* conn, const char* sql, sqlite3_int64 id) {
+    sqlite3_stmt* stmt;
+    sqlite3_int64 value = -1;
+
+    if (sqlite3_prepare_v2(conn, sql, -1, &stmt, NULL) == SQLITE_OK) {
+        sqlite3_bind_int64(stmt, 1, id);
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            value = sqlite3_column_int64(stmt, 0);
+        }
+    }
+    sqlite3_finalize(stmt);
+    return value;
+}
+
+static int HasTrigger(sqlite3* conn, const char* name) {
+    sqlite3_stmt* stmt;
+    int found = 0;
+
+    if (sqlite3_prepare_v2(conn, "SELECT 1 FROM sqlite_master WHERE type = 'trigger' AND name = ?",
+                           -1, &stmt, NULL) == SQLITE_OK) {
+        sqlite3_bind_text(stmt, 1, name, -1, SQLITE_STATIC);
+        found = sqlite3_step(stmt) == SQLITE_ROW;
+    }
+    sqlite3_finalize(stmt);
+    return found;
+}
+
+// New names go into the trigram index in one statement after the load, rather than through
+// the insert trigger once per row. Ids only grow, so the new rows are those above lastOldId.
+static int IndexNewNames(sqlite3* conn, sqlite3_int64 lastOldId) {
+    sqlite3_stmt* stmt;
+    int rc = sqlite3_prepare_v2(conn, "INSERT INTO products_fts (rowid, name) "
+                                "SELECT id, name FROM products WHERE id > ?", -1, &stmt, NULL);
+
+    if (rc == SQLITE_OK) {
+        sqlite3_bind_int64(stmt, 1, lastOldId);
+        rc = sqlite3_step(stmt) == SQLITE_DONE ? SQLITE_OK : sqlite3_errcode(conn);
+    }
+    sqlite3_finalize(stmt);
+    return rc;
+}
+
+int ProductImport_Run(sqlite3* conn, const char* path, int flags, ProductImportResult* result) {
+    CsvReader* reader;
+    sqlite3_stmt* upsert = NULL;
+    sqlite3_int64 lastOldId = 0;
+    int deferSearch = 0;
+    int rc;
+
+    memset(result, 0, sizeof(*result));
+
+    // The record is a few hundred bytes, the buffer is the only large allocation
+    reader = (CsvReader*)calloc(1, sizeof(CsvReader));
+    if (!reader) {
+        return SQLITE_NOMEM;
+    }
+    reader->buffer = (char*)malloc(PRODUCT_IMPORT_BUFFER);
+    reader->file = fopen(path, "rb");
+    if (!reader->buffer || !reader->file) {
+        rc = reader->buffer ? SQLITE_CANTOPEN : SQLITE_NOMEM;
+        if (reader->file) {
+            fclose(reader->file);
+        }
+        free(reader->buffer);
+        free(reader);
+        return rc;
+    }
+
+    // Spreadsheet programs often start UTF-8 files with a byte order mark
+    if (CsvReader_Fill(reader) && reader->end >= 3 && memcmp(reader->buffer, "\xEF\xBB\xBF", 3) == 0) {
+        reader->pos = 3;
+    }
+
+    sqlite3_memory_highwater(1);
+    rc = sqlite3_exec(conn, "BEGIN IMMEDIATE", NULL, NULL, NULL);
+    if (rc == SQLITE_OK) {
+        lastOldId = QueryCount(conn, "SELECT COALESCE(MAX(id), 0) FROM products", 0);
+        rc = lastOldId >= 0 ? SQLITE_OK : sqlite3_errcode(conn);
+    }
+    if (rc == SQLITE_OK && !(flags & PRODUCT_IMPORT_LIVE_SEARCH_INDEX) && HasTrigger(conn, "products_fts_ai")) {
+        deferSearch = 1;
+        rc = sqlite3_exec(conn, "DROP TRIGGER products_fts_ai", NULL, NULL, NULL);
+    }
+    if (rc == SQLITE_OK) {
+        rc = sqlite3_prepare_v2(conn, SQL_UPSERT_PRODUCT, -1, &upsert, NULL);
+    }
+
+    while (rc == SQLITE_OK && CsvReader_Next(reader)) {
+        Money price = 0;
+        int quantity = 0;
+
+        // Blank lines are not records
+        if (reader->fieldCount == 1 && reader->lengths[0] == 0 && !reader->tooLong) {
+            continue;
+        }
+        if (reader->tooLong || reader->fieldCount < IMPORT_FIELDS || reader->lengths[0] == 0 ||
+            !ParseQuantity(reader->fields[1], &quantity) ||
+            !ParseMoney(reader->fields[2], &price) || price <= 0) {
+            if (reader->record > 1) {
+                result->skipped++;
+                if (!result->firstSkipped) {
+                    result->firstSkipped = reader->record;
+                }
+            }
+            continue;
+        }
+
+        sqlite3_bind_text(upsert, 1, reader->fields[0], (int)reader->lengths[0], SQLITE_STATIC);
+        sqlite3_bind_int(upsert, 2, quantity);
+        sqlite3_bind_int64(upsert, 3, price);
+        rc = sqlite3_step(upsert);
+        sqlite3_reset(upsert);
+        if (rc == SQLITE_DONE) {
+            rc = SQLITE_OK;
+            result->rows++;
+        }
+    }
+    sqlite3_finalize(upsert);
+    if (rc == SQLITE_OK && ferror(reader->file)) {
+        rc = SQLITE_IOERR;
+    }
+
+    if (rc == SQLITE_OK) {
+        result->added = QueryCount(conn, "SELECT COUNT(*) FROM products WHERE id > ?", lastOldId);
+    }
+    if (rc == SQLITE_OK && deferSearch) {
+        rc = IndexNewNames(conn, lastOldId);
+        if (rc == SQLITE_OK) {
+            rc = sqlite3_exec(conn, SQL_CREATE_PRODUCTS_FTS_TRIGGERS, NULL, NULL, NULL);
+        }
+    }
+    if (rc == SQLITE_OK) {
+        rc = sqlite3_exec(conn, "COMMIT", NULL, NULL, NULL);
+    }
+    if (rc != SQLITE_OK) {
+        sqlite3_exec(conn, "ROLLBACK", NULL, NULL, NULL);
+        result->rows = 0;
+        result->added = 0;
+    }
+
+    result->bytes = reader->bytes;
+    result->peakMemory = sqlite3_memory_highwater(0) + PRODUCT_IMPORT_BUFFER;
+    fclose(reader->file);
+    free(reader->buffer);
+    free(reader);
+    return rc;
+}
@@ -0,0 +1,41 @@
+/*
+ * Bulk product import from CSV
+ * The file streams through one fixed buffer, so memory use does not grow with its size
+ */
+
+#ifndef PRODUCT_IMPORT_H
+#define PRODUCT_IMPORT_H
+
+#include <sqlite3.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PRODUCT_IMPORT_BUFFER (256 * 1024)      // bytes read from the file at a time
+
+// Keep the search index triggers firing row by row instead of indexing new names once
+// at the end; only the benchmark uses it, to show what deferring saves
+#define PRODUCT_IMPORT_LIVE_SEARCH_INDEX 1
+
+typedef struct {
+    sqlite3_int64 rows;             // products added or updated
+    sqlite3_int64 added;            // of those, names that were not in the catalog
+    sqlite3_int64 skipped;          // records that are not name,quantity,price; the header is not counted
+    sqlite3_int64 firstSkipped;     // record number of the first one skipped, 0 if none
+    sqlite3_int64 bytes;            // read from the file
+    sqlite3_int64 peakMemory;       // SQLite's heap high-water mark during the import, plus the buffer
+} ProductImportResult;
+
+// Reads name,quantity,price records, quoted as in RFC 4180 where needed; further columns are
+// ignored and a first record that is not a product is taken for the header. A name already in
+// the catalog keeps its id and takes the file's quantity and price. Everything happens in one
+// transaction, so on failure no product has changed.
+// Returns SQLITE_OK, SQLITE_CANTOPEN if the file cannot be read, or the first SQLite error.
+int ProductImport_Run(sqlite3* conn, const char* path, int flags, ProductImportResult* result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
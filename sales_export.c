@@ -0,0 +1,206 @@
+/*
+ * Sales export to CSV
+ * Column values are read in place from SQLite and formatted straight into the output buffer;
+ * nothing is allocated per row
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sales_export.h"
+#include "db_queries.h"
+#include "money.h"
+
+#define EXPORT_HEADER "id,sale_date,product_id,product_name,quantity,total\r\n"
+#define EXPORT_NUMBER_SIZE 24       // longest formatted int64 or amount, sign included
+
+typedef struct {
+    FILE* file;
+    char* buffer;
+    size_t used;
+    sqlite3_int64 bytes;
+    int failed;
+} CsvWriter;
+
+static void CsvWriter_Flush(CsvWriter* writer) {
+    if (writer->used > 0 && fwrite(writer->buffer, 1, writer->used, writer->file) != writer->used) {
+        writer->failed = 1;
+    }
+    writer->bytes += (sqlite3_int64)writer->used;
+    writer->used = 0;
+}
+
+// Room for size more bytes, which must be at most SALES_EXPORT_BUFFER
+static char* CsvWriter_Reserve(CsvWriter* writer, size_t size) {
+    if (writer->used + size > SALES_EXPORT_BUFFER) {
+        CsvWriter_Flush(writer);
+    }
+    return writer->buffer + writer->used;
+}
+
+static void CsvWriter_Write(CsvWriter* writer, const char* text, size_t length) {
+    while (length > 0) {
+        size_t room = SALES_EXPORT_BUFFER - writer->used;
+        size_t chunk = length < room ? length : room;
+
+        memcpy(writer->buffer + writer->used, text, chunk);
+        writer->used += chunk;
+        text += chunk;
+        length -= chunk;
+        if (writer->used == SALES_EXPORT_BUFFER) {
+            CsvWriter_Flush(writer);
+        }
+    }
+}
+
+static void CsvWriter_Char(CsvWriter* writer, char c) {
+    *CsvWriter_Reserve(writer, 1) = c;
+    writer->used++;
+}
+
+// Digits are produced back to front into a scratch array, then copied once
+static void CsvWriter_Int(CsvWriter* writer, sqlite3_int64 value) {
+    char digits[EXPORT_NUMBER_SIZE];
+    char* p = digits + sizeof(digits);
+    sqlite3_uint64 magnitude = value < 0 ? (sqlite3_uint64)0 - (sqlite3_uint64)value : (sqlite3_uint64)value;
+
+    do {
+        *--p = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude);
+    if (value < 0) {
+        *--p = '-';
+    }
+    memcpy(CsvWriter_Reserve(writer, EXPORT_NUMBER_SIZE), p, digits + sizeof(digits) - p);
+    writer->used += digits + sizeof(digits) - p;
+}
+
+static void CsvWriter_Money(CsvWriter* writer, Money amount) {
+    char* out = CsvWriter_Reserve(writer, MONEY_TEXT_SIZE);
+
+    FormatMoney(amount, out);
+    writer->used += strlen(out);
+}
+
+// Quoted only when it holds a comma, quote or line break, with quotes doubled
+static void CsvWriter_Text(CsvWriter* writer, const char* text, size_t length) {
+    size_t i;
+
+    for (i = 0; i < length; i++) {
+        char c = text[i];
+        if (c == ',' || c == '"' || c == '\n' || c == '\r') {
+            break;
+        }
+    }
+    if (i == length) {
+        CsvWriter_Write(writer, text, length);
+        return;
+    }
+
+    CsvWriter_Char(writer, '"');
+    for (;;) {
+        const char* quote = (const char*)memchr(text, '"', length);
+        size_t run = quote ? (size_t)(quote - text) + 1 : length;
+
+        CsvWriter_Write(writer, text, run);
+        if (!quote) {
+            break;
+        }
+        CsvWriter_Char(writer, '"');
+        text += run;
+        length -= run;
+    }
+    CsvWriter_Char(writer, '"');
+}
+
+int SalesExport_Run(sqlite3* conn, const char* path, const SalesExportFilter* filter,
+                    SalesExportProgress progress, void* context, SalesExportResult* result) {
+    CsvWriter writer;
+    sqlite3_stmt* stmt = NULL;
+    const char* sql = SQL_SALES_EXPORT;
+    int filtered = 0;
+    int rc;
+
+    memset(result, 0, sizeof(*result));
+    memset(&writer, 0, sizeof(writer));
+
+    writer.buffer = (char*)malloc(SALES_EXPORT_BUFFER);
+    if (!writer.buffer) {
+        return SQLITE_NOMEM;
+    }
+    writer.file = fopen(path, "wb");
+    if (!writer.file) {
+        free(writer.buffer);
+        return SQLITE_CANTOPEN;
+    }
+
+    if (filter && filter->productId > 0) {
+        sql = SQL_SALES_EXPORT_PRODUCT;
+        filtered = 1;
+    } else if (filter && (filter->from || filter->to)) {
+        sql = SQL_SALES_EXPORT_DATES;
+        filtered = 1;
+    }
+
+    sqlite3_memory_highwater(1);
+    rc = sqlite3_exec(conn, "BEGIN", NULL, NULL, NULL);
+    if (rc == SQLITE_OK) {
+        rc = sqlite3_prepare_v2(conn, sql, -1, &stmt, NULL);
+    }
+    if (rc == SQLITE_OK && filtered) {
+        // An open end of the range is a bound every timestamp falls within. Both must stay
+        // text: sale_date has numeric affinity, so "9999" would compare as a number.
+        sqlite3_bind_text(stmt, 1, filter->from ? filter->from : "", -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 2, filter->to ? filter->to : "9999-12-31", -1, SQLITE_STATIC);
+        sqlite3_bind_int64(stmt, 3, filter->productId);
+    }
+
+    if (rc == SQLITE_OK) {
+        CsvWriter_Write(&writer, EXPORT_HEADER, sizeof(EXPORT_HEADER) - 1);
+    }
+    while (rc == SQLITE_OK && !writer.failed) {
+        int step = sqlite3_step(stmt);
+
+        if (step != SQLITE_ROW) {
+            rc = step == SQLITE_DONE ? SQLITE_OK : step;
+            break;
+        }
+
+        CsvWriter_Int(&writer, sqlite3_column_int64(stmt, 0));
+        CsvWriter_Char(&writer, ',');
+        CsvWriter_Write(&writer, (const char*)sqlite3_column_text(stmt, 1), (size_t)sqlite3_column_bytes(stmt, 1));
+        CsvWriter_Char(&writer, ',');
+        CsvWriter_Int(&writer, sqlite3_column_int64(stmt, 2));
+        CsvWriter_Char(&writer, ',');
+        CsvWriter_Text(&writer, (const char*)sqlite3_column_text(stmt, 3), (size_t)sqlite3_column_bytes(stmt, 3));
+        CsvWriter_Char(&writer, ',');
+        CsvWriter_Int(&writer, sqlite3_column_int64(stmt, 4));
+        CsvWriter_Char(&writer, ',');
+        CsvWriter_Money(&writer, sqlite3_column_int64(stmt, 5));
+        CsvWriter_Write(&writer, "\r\n", 2);
+
+        result->rows++;
+        if (progress && result->rows % SALES_EXPORT_PROGRESS_ROWS == 0) {
+            progress(context, result->rows);
+        }
+    }
+    sqlite3_finalize(stmt);
+    sqlite3_exec(conn, "COMMIT", NULL, NULL, NULL);
+
+    CsvWriter_Flush(&writer);
+    if (fclose(writer.file) != 0) {
+        writer.failed = 1;
+    }
+    if (rc == SQLITE_OK && writer.failed) {
+        rc = SQLITE_IOERR;
+    }
+    // A partial file would pass for a complete export
+    if (rc != SQLITE_OK) {
+        remove(path);
+    }
+
+    result->bytes = writer.bytes;
+    result->peakMemory = sqlite3_memory_highwater(0) + SALES_EXPORT_BUFFER;
+    free(writer.buffer);
+    return rc;
+}
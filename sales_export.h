@@ -0,0 +1,44 @@
+/*
+ * Sales export to CSV
+ * Rows are stepped straight into one output buffer, so memory use does not grow with the table
+ */
+
+#ifndef SALES_EXPORT_H
+#define SALES_EXPORT_H
+
+#include <sqlite3.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SALES_EXPORT_BUFFER (1024 * 1024)      // bytes handed to the file at a time
+#define SALES_EXPORT_PROGRESS_ROWS 1000000
+
+typedef struct {
+    const char* from;           // first day as 'YYYY-MM-DD', or NULL for the oldest sale
+    const char* to;             // day after the last, or NULL for the newest sale
+    sqlite3_int64 productId;    // 0 for every product
+} SalesExportFilter;
+
+typedef struct {
+    sqlite3_int64 rows;
+    sqlite3_int64 bytes;        // written to the file, header included
+    sqlite3_int64 peakMemory;   // SQLite's heap high-water mark during the export, plus the buffer
+} SalesExportResult;
+
+// Called every SALES_EXPORT_PROGRESS_ROWS rows
+typedef void (*SalesExportProgress)(void* context, sqlite3_int64 rows);
+
+// Writes id,sale_date,product_id,product_name,quantity,total lines, oldest sale first, with
+// totals in kwacha. The rows come from one read transaction, so the file is a consistent
+// snapshot even while sales are being recorded.
+// Returns SQLITE_OK, SQLITE_CANTOPEN or SQLITE_IOERR for the file, or the first SQLite error.
+int SalesExport_Run(sqlite3* conn, const char* path, const SalesExportFilter* filter,
+                    SalesExportProgress progress, void* context, SalesExportResult* result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,227 @@
+/*
+ * In-memory sales mirror
+ * Kernels use SSE2, which every x86-64 compiler enables by default, and fall back to the
+ * same loop one sale at a time elsewhere. A time range check is one subtraction and one
+ * unsigned compare: from <= time < to exactly when time - from, wrapped, is below to - from.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "sales_mirror.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SALES_MIRROR_SSE2 1
+#endif
+
+static int SalesMirror_Grow(SalesMirror* mirror) {
+    sqlite3_int64 capacity = mirror->capacity ? mirror->capacity * 2 : SALES_MIRROR_MIN_CAPACITY;
+    int32_t* productId = (int32_t*)realloc(mirror->productId, (size_t)capacity * sizeof(int32_t));
+    int32_t* quantity;
+    uint32_t* time;
+    Money* total;
+
+    // Each array is replaced as soon as it has moved, so a failure part way frees cleanly
+    if (!productId) {
+        return 0;
+    }
+    mirror->productId = productId;
+    quantity = (int32_t*)realloc(mirror->quantity, (size_t)capacity * sizeof(int32_t));
+    if (!quantity) {
+        return 0;
+    }
+    mirror->quantity = quantity;
+    time = (uint32_t*)realloc(mirror->time, (size_t)capacity * sizeof(uint32_t));
+    if (!time) {
+        return 0;
+    }
+    mirror->time = time;
+    total = (Money*)realloc(mirror->total, (size_t)capacity * sizeof(Money));
+    if (!total) {
+        return 0;
+    }
+    mirror->total = total;
+    mirror->capacity = capacity;
+    return 1;
+}
+
+int SalesMirror_CatchUp(SalesMirror* mirror, sqlite3_stmt* afterId) {
+    int rc = SQLITE_OK;
+
+    sqlite3_bind_int64(afterId, 1, mirror->lastId);
+    for (;;) {
+        int step = sqlite3_step(afterId);
+        sqlite3_int64 productId, quantity, time;
+        sqlite3_int64 i = mirror->count;
+
+        if (step != SQLITE_ROW) {
+            rc = step == SQLITE_DONE ? SQLITE_OK : step;
+            break;
+        }
+        productId = sqlite3_column_int64(afterId, 1);
+        quantity = sqlite3_column_int64(afterId, 2);
+        time = sqlite3_column_int64(afterId, 4);
+        if (productId < 0 || productId > INT32_MAX || quantity < INT32_MIN || quantity > INT32_MAX ||
+            time < 0 || time > UINT32_MAX) {
+            rc = SQLITE_RANGE;
+            break;
+        }
+        if (i == mirror->capacity && !SalesMirror_Grow(mirror)) {
+            rc = SQLITE_NOMEM;
+            break;
+        }
+
+        mirror->productId[i] = (int32_t)productId;
+        mirror->quantity[i] = (int32_t)quantity;
+        mirror->total[i] = sqlite3_column_int64(afterId, 3);
+        mirror->time[i] = (uint32_t)time;
+        mirror->count = i + 1;
+        mirror->lastId = sqlite3_column_int64(afterId, 0);
+        if (productId > mirror->maxProductId) {
+            mirror->maxProductId = (int32_t)productId;
+        }
+        if ((uint32_t)time > mirror->maxTime) {
+            mirror->maxTime = (uint32_t)time;
+        }
+    }
+    sqlite3_reset(afterId);
+    return rc;
+}
+
+void SalesMirror_Free(SalesMirror* mirror) {
+    free(mirror->productId);
+    free(mirror->quantity);
+    free(mirror->time);
+    free(mirror->total);
+    memset(mirror, 0, sizeof(*mirror));
+}
+
+void SalesMirror_Totals(const SalesMirror* mirror, uint32_t from, uint32_t to, int32_t productId,
+                        SalesMirrorTotals* totals) {
+    const int32_t* products = mirror->productId;
+    const int32_t* quantities = mirror->quantity;
+    const uint32_t* times = mirror->time;
+    const Money* amounts = mirror->total;
+    sqlite3_int64 n = mirror->count;
+    sqlite3_int64 i = 0;
+    sqlite3_int64 transactions = 0, units = 0;
+    Money revenue = 0;
+    uint32_t width = to - from;
+
+    memset(totals, 0, sizeof(*totals));
+    if (to <= from) {
+        return;
+    }
+
+#ifdef SALES_MIRROR_SSE2
+    {
+        // SSE2 compares signed lanes only; flipping the top bit orders unsigned values the same way
+        const __m128i bias = _mm_set1_epi32(INT32_MIN);
+        const __m128i first = _mm_set1_epi32((int32_t)from);
+        const __m128i limit = _mm_xor_si128(_mm_set1_epi32((int32_t)width), bias);
+        const __m128i product = _mm_set1_epi32(productId);
+        __m128i count = _mm_setzero_si128();
+        __m128i sumUnits = _mm_setzero_si128();
+        __m128i sumRevenue = _mm_setzero_si128();
+        int64_t lanes[2];
+
+        for (; i + 4 <= n; i += 4) {
+            __m128i time = _mm_loadu_si128((const __m128i*)(times + i));
+            __m128i in = _mm_cmplt_epi32(_mm_xor_si128(_mm_sub_epi32(time, first), bias), limit);
+            __m128i quantity, sign, low, high;
+
+            if (productId != 0) {
+                in = _mm_and_si128(in, _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(products + i)), product));
+            }
+            // Each 32-bit mask lane doubled into a 64-bit one, for the 64-bit sums
+            low = _mm_unpacklo_epi32(in, in);
+            high = _mm_unpackhi_epi32(in, in);
+
+            count = _mm_sub_epi64(count, low);
+            count = _mm_sub_epi64(count, high);
+
+            quantity = _mm_and_si128(_mm_loadu_si128((const __m128i*)(quantities + i)), in);
+            sign = _mm_srai_epi32(quantity, 31);
+            sumUnits = _mm_add_epi64(sumUnits, _mm_unpacklo_epi32(quantity, sign));
+            sumUnits = _mm_add_epi64(sumUnits, _mm_unpackhi_epi32(quantity, sign));
+
+            sumRevenue = _mm_add_epi64(sumRevenue, _mm_and_si128(_mm_loadu_si128((const __m128i*)(amounts + i)), low));
+            sumRevenue = _mm_add_epi64(sumRevenue, _mm_and_si128(_mm_loadu_si128((const __m128i*)(amounts + i + 2)), high));
+        }
+
+        _mm_storeu_si128((__m128i*)lanes, count);
+        transactions = lanes[0] + lanes[1];
+        _mm_storeu_si128((__m128i*)lanes, sumUnits);
+        units = lanes[0] + lanes[1];
+        _mm_storeu_si128((__m128i*)lanes, sumRevenue);
+        revenue = lanes[0] + lanes[1];
+    }
+#endif
+
+    for (; i < n; i++) {
+        if ((uint32_t)(times[i] - from) < width && (productId == 0 || products[i] == productId)) {
+            transactions++;
+            units += quantities[i];
+            revenue += amounts[i];
+        }
+    }
+
+    totals->transactions = transactions;
+    totals->units = units;
+    totals->revenue = revenue;
+}
+
+static void AddSale(const SalesMirror* mirror, sqlite3_int64 i, SalesMirrorTotals* byProduct) {
+    SalesMirrorTotals* totals = &byProduct[mirror->productId[i]];
+
+    totals->transactions++;
+    totals->units += mirror->quantity[i];
+    totals->revenue += mirror->total[i];
+}
+
+// The range test runs four sales at a time; only the sales inside it are added, one by one,
+// since each goes to a different product
+void SalesMirror_ByProduct(const SalesMirror* mirror, uint32_t from, uint32_t to, SalesMirrorTotals* byProduct) {
+    const uint32_t* times = mirror->time;
+    sqlite3_int64 n = mirror->count;
+    sqlite3_int64 i = 0;
+    uint32_t width = to - from;
+
+    if (to <= from) {
+        return;
+    }
+
+#ifdef SALES_MIRROR_SSE2
+    {
+        const __m128i bias = _mm_set1_epi32(INT32_MIN);
+        const __m128i first = _mm_set1_epi32((int32_t)from);
+        const __m128i limit = _mm_xor_si128(_mm_set1_epi32((int32_t)width), bias);
+
+        for (; i + 4 <= n; i += 4) {
+            __m128i time = _mm_loadu_si128((const __m128i*)(times + i));
+            __m128i in = _mm_cmplt_epi32(_mm_xor_si128(_mm_sub_epi32(time, first), bias), limit);
+            int mask = _mm_movemask_ps(_mm_castsi128_ps(in));
+
+            if (mask == 0xF) {
+                AddSale(mirror, i, byProduct);
+                AddSale(mirror, i + 1, byProduct);
+                AddSale(mirror, i + 2, byProduct);
+                AddSale(mirror, i + 3, byProduct);
+            } else if (mask) {
+                int lane;
+                for (lane = 0; lane < 4; lane++) {
+                    if (mask & (1 << lane)) {
+                        AddSale(mirror, i + lane, byProduct);
+                    }
+                }
+            }
+        }
+    }
+#endif
+
+    for (; i < n; i++) {
+        if ((uint32_t)(times[i] - from) < width) {
+            AddSale(mirror, i, byProduct);
+        }
+    }
+}
@@ -0,0 +1,62 @@
+/*
+ * In-memory sales mirror
+ * The sales columns the reports aggregate, each in its own array (structure of arrays), so a
+ * report reads only the bytes it sums and the kernels test four sales per instruction.
+ * Sales are only ever appended, so the mirror is kept current by reading the ids after the
+ * newest one it holds.
+ */
+
+#ifndef SALES_MIRROR_H
+#define SALES_MIRROR_H
+
+#include <stdint.h>
+#include <sqlite3.h>
+#include "money.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SALES_MIRROR_MIN_CAPACITY 65536
+// Bytes held per sale, for sizing: product, quantity, time and total
+#define SALES_MIRROR_BYTES_PER_SALE (4 + 4 + 4 + 8)
+
+typedef struct {
+    int32_t* productId;
+    int32_t* quantity;
+    uint32_t* time;             // Unix seconds of sale_date
+    Money* total;
+    sqlite3_int64 count;
+    sqlite3_int64 capacity;
+    sqlite3_int64 lastId;       // newest sale held
+    int32_t maxProductId;       // by-product results need maxProductId + 1 entries
+    uint32_t maxTime;
+} SalesMirror;
+
+typedef struct {
+    sqlite3_int64 transactions;
+    sqlite3_int64 units;
+    Money revenue;
+} SalesMirrorTotals;
+
+// Appends the sales after mirror->lastId, oldest first; loading an empty mirror is the same
+// call. afterId is SQL_SALES_MIRROR_AFTER_ID prepared on any connection, and is reset after.
+// Returns SQLITE_OK, SQLITE_NOMEM, SQLITE_RANGE for a product id or time the columns cannot
+// hold, or the first SQLite error. Sales read before an error stay in the mirror.
+int SalesMirror_CatchUp(SalesMirror* mirror, sqlite3_stmt* afterId);
+void SalesMirror_Free(SalesMirror* mirror);
+
+// Count, units and revenue of the sales with from <= time < to, of one product or of all when
+// productId is 0: SQL_SALES_TOTALS_SCAN and SQL_SALES_PRODUCT_TOTALS
+void SalesMirror_Totals(const SalesMirror* mirror, uint32_t from, uint32_t to, int32_t productId,
+                        SalesMirrorTotals* totals);
+
+// Adds each sale with from <= time < to to byProduct[its product id], which the caller sizes
+// to maxProductId + 1 entries and zeroes: SQL_SALES_BY_PRODUCT
+void SalesMirror_ByProduct(const SalesMirror* mirror, uint32_t from, uint32_t to, SalesMirrorTotals* byProduct);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,444 @@
+/*
+ * Parallel sales reports
+ * A thread's run of ranges is one 64-bit word, the next range in the low half and the end in
+ * the high half. The owner takes from the front and others from the back, each with one
+ * compare-and-swap, so a steal never waits for the owner. Threads are CreateThread on Windows
+ * and pthreads elsewhere; the calling thread works as thread 0.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "sales_report.h"
+#include "db_queries.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+#define REPORT_TABLE_MIN_SLOTS 1024
+
+// Partial aggregate: rows in arrival order, found by an open-addressing index over them
+typedef struct {
+    SalesReportRow* rows;
+    sqlite3_int64 count;
+    sqlite3_int64 capacity;
+    sqlite3_int64* slots;       // row index + 1, 0 when free
+    sqlite3_int64 slotMask;
+} ReportTable;
+
+typedef struct ReportRun ReportRun;
+
+typedef struct {
+    ReportRun* run;
+    int index;
+    uint64_t ranges;            // next range | end << 32, see TakeFront and TakeBack
+    ReportTable table;
+    int stolen;
+    int rc;
+#ifdef _WIN32
+    HANDLE thread;
+#else
+    pthread_t thread;
+#endif
+} ReportWorker;
+
+struct ReportRun {
+    const char* path;
+    const PragmaProfile* profile;
+    const char* sql;
+    const char* from;
+    const char* to;
+    sqlite3_int64 firstId;
+    sqlite3_int64 lastId;
+    int rangeCount;
+    int threads;
+    int failed;                 // set by the first worker to fail, so the others stop early
+    ReportWorker workers[SALES_REPORT_MAX_THREADS];
+};
+
+static uint64_t HashRow(sqlite3_int64 productId, const char* day) {
+    uint64_t hash = 14695981039346656037ULL ^ (uint64_t)productId;
+
+    hash *= 1099511628211ULL;
+    while (*day) {
+        hash = (hash ^ (unsigned char)*day++) * 1099511628211ULL;
+    }
+    return hash ^ (hash >> 32);
+}
+
+static int ReportTable_Grow(ReportTable* table) {
+    sqlite3_int64 slotCount = table->slots ? (table->slotMask + 1) * 2 : REPORT_TABLE_MIN_SLOTS;
+    sqlite3_int64* slots = (sqlite3_int64*)calloc((size_t)slotCount, sizeof(sqlite3_int64));
+    SalesReportRow* rows = (SalesReportRow*)realloc(table->rows, (size_t)(slotCount / 2) * sizeof(SalesReportRow));
+    sqlite3_int64 i;
+
+    if (rows) {
+        table->rows = rows;
+    }
+    if (!slots || !rows) {
+        free(slots);
+        return 0;
+    }
+
+    // Half full at most, so a probe ends soon at a free slot
+    for (i = 0; i < table->count; i++) {
+        sqlite3_int64 slot = (sqlite3_int64)(HashRow(rows[i].productId, rows[i].day) & (uint64_t)(slotCount - 1));
+        while (slots[slot]) {
+            slot = (slot + 1) & (slotCount - 1);
+        }
+        slots[slot] = i + 1;
+    }
+    free(table->slots);
+    table->slots = slots;
+    table->slotMask = slotCount - 1;
+    table->capacity = slotCount / 2;
+    return 1;
+}
+
+// The row of productId on day, added with zero totals if new. NULL when out of memory.
+static SalesReportRow* ReportTable_Find(ReportTable* table, sqlite3_int64 productId, const char* day) {
+    sqlite3_int64 slot;
+    SalesReportRow* row;
+
+    if (table->count == table->capacity && !ReportTable_Grow(table)) {
+        return NULL;
+    }
+
+    slot = (sqlite3_int64)(HashRow(productId, day) & (uint64_t)table->slotMask);
+    while (table->slots[slot]) {
+        row = &table->rows[table->slots[slot] - 1];
+        if (row->productId == productId && strcmp(row->day, day) == 0) {
+            return row;
+        }
+        slot = (slot + 1) & table->slotMask;
+    }
+
+    row = &table->rows[table->count];
+    memset(row, 0, sizeof(*row));
+    row->productId = productId;
+    strncpy(row->day, day, sizeof(row->day) - 1);
+    table->slots[slot] = ++table->count;
+    return row;
+}
+
+static int ReportTable_Add(ReportTable* table, const SalesReportRow* partial) {
+    SalesReportRow* row = ReportTable_Find(table, partial->productId, partial->day);
+
+    if (!row) {
+        return 0;
+    }
+    row->transactions += partial->transactions;
+    row->units += partial->units;
+    row->revenue += partial->revenue;
+    return 1;
+}
+
+static void ReportTable_Free(ReportTable* table) {
+    free(table->rows);
+    free(table->slots);
+    memset(table, 0, sizeof(*table));
+}
+
+static int TakeFront(uint64_t* ranges, int* range) {
+    uint64_t old = __atomic_load_n(ranges, __ATOMIC_ACQUIRE);
+
+    while ((uint32_t)old < (uint32_t)(old >> 32)) {
+        if (__atomic_compare_exchange_n(ranges, &old, old + 1, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            *range = (int)(uint32_t)old;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int TakeBack(uint64_t* ranges, int* range) {
+    uint64_t old = __atomic_load_n(ranges, __ATOMIC_ACQUIRE);
+
+    while ((uint32_t)old < (uint32_t)(old >> 32)) {
+        if (__atomic_compare_exchange_n(ranges, &old, old - ((uint64_t)1 << 32), 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            *range = (int)(uint32_t)(old >> 32) - 1;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// A range from the thread with the most left, or 0 once every run is empty
+static int Steal(ReportRun* run, int self, int* range) {
+    for (;;) {
+        int victim = -1;
+        uint32_t most = 0;
+        int i;
+
+        for (i = 0; i < run->threads; i++) {
+            uint64_t ranges = __atomic_load_n(&run->workers[i].ranges, __ATOMIC_ACQUIRE);
+            uint32_t left = (uint32_t)(ranges >> 32) - (uint32_t)ranges;
+
+            if (i != self && (uint32_t)ranges < (uint32_t)(ranges >> 32) && left > most) {
+                victim = i;
+                most = left;
+            }
+        }
+        if (victim < 0) {
+            return 0;
+        }
+        if (TakeBack(&run->workers[victim].ranges, range)) {
+            return 1;
+        }
+    }
+}
+
+// Ids first + span * range / count onwards, without overflowing for any id
+static sqlite3_int64 RangeStart(const ReportRun* run, int range) {
+    sqlite3_uint64 span = (sqlite3_uint64)(run->lastId - run->firstId) + 1;
+    sqlite3_uint64 step = span / (sqlite3_uint64)run->rangeCount;
+    sqlite3_uint64 extra = span % (sqlite3_uint64)run->rangeCount;
+    sqlite3_uint64 offset = step * (sqlite3_uint64)range + ((sqlite3_uint64)range < extra ? (sqlite3_uint64)range : extra);
+
+    return (sqlite3_int64)((sqlite3_uint64)run->firstId + offset);
+}
+
+static int RunRange(ReportWorker* worker, sqlite3_stmt* stmt, int range) {
+    ReportRun* run = worker->run;
+    int rc;
+
+    sqlite3_bind_int64(stmt, 1, RangeStart(run, range));
+    sqlite3_bind_int64(stmt, 2, range + 1 < run->rangeCount ? RangeStart(run, range + 1) - 1 : run->lastId);
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        const char* day = (const char*)sqlite3_column_text(stmt, 1);
+        SalesReportRow* row = ReportTable_Find(&worker->table, sqlite3_column_int64(stmt, 0), day ? day : "");
+
+        if (!row) {
+            rc = SQLITE_NOMEM;
+            break;
+        }
+        row->transactions += sqlite3_column_int64(stmt, 2);
+        row->units += sqlite3_column_int64(stmt, 3);
+        row->revenue += sqlite3_column_int64(stmt, 4);
+    }
+    sqlite3_reset(stmt);
+    return rc == SQLITE_DONE ? SQLITE_OK : rc;
+}
+
+static void ReportWorker_Run(ReportWorker* worker) {
+    ReportRun* run = worker->run;
+    sqlite3* conn = NULL;
+    sqlite3_stmt* stmt = NULL;
+    int range;
+
+    worker->rc = OpenReadConnection(run->path, run->profile, &conn);
+    if (worker->rc == SQLITE_OK) {
+        worker->rc = sqlite3_prepare_v2(conn, run->sql, -1, &stmt, NULL);
+    }
+    if (worker->rc == SQLITE_OK) {
+        // An open end of the range is a bound every timestamp falls within. Both must stay
+        // text: sale_date has numeric affinity, so "9999" would compare as a number.
+        sqlite3_bind_text(stmt, 3, run->from ? run->from : "", -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 4, run->to ? run->to : "9999-12-31", -1, SQLITE_STATIC);
+    }
+
+    while (worker->rc == SQLITE_OK && !__atomic_load_n(&run->failed, __ATOMIC_RELAXED)) {
+        if (!TakeFront(&worker->ranges, &range)) {
+            if (!Steal(run, worker->index, &range)) {
+                break;
+            }
+            worker->stolen++;
+        }
+        worker->rc = RunRange(worker, stmt, range);
+    }
+    if (worker->rc != SQLITE_OK) {
+        __atomic_store_n(&run->failed, 1, __ATOMIC_RELAXED);
+    }
+
+    sqlite3_finalize(stmt);
+    sqlite3_close(conn);
+}
+
+#ifdef _WIN32
+static DWORD WINAPI ReportWorkerThread(LPVOID param) {
+    ReportWorker_Run((ReportWorker*)param);
+    return 0;
+}
+
+static int ReportWorker_Start(ReportWorker* worker) {
+    worker->thread = CreateThread(NULL, 0, ReportWorkerThread, worker, 0, NULL);
+    return worker->thread != NULL;
+}
+
+static void ReportWorker_Join(ReportWorker* worker) {
+    WaitForSingleObject(worker->thread, INFINITE);
+    CloseHandle(worker->thread);
+}
+#else
+static void* ReportWorkerThread(void* param) {
+    ReportWorker_Run((ReportWorker*)param);
+    return NULL;
+}
+
+static int ReportWorker_Start(ReportWorker* worker) {
+    return pthread_create(&worker->thread, NULL, ReportWorkerThread, worker) == 0;
+}
+
+static void ReportWorker_Join(ReportWorker* worker) {
+    pthread_join(worker->thread, NULL);
+}
+#endif
+
+// The newest id is read once, here, and bounds every range
+static int ReadIdBounds(ReportRun* run) {
+    sqlite3* conn = NULL;
+    sqlite3_stmt* stmt = NULL;
+    int rc = OpenReadConnection(run->path, run->profile, &conn);
+
+    if (rc == SQLITE_OK) {
+        rc = sqlite3_prepare_v2(conn, SQL_SALES_ID_BOUNDS, -1, &stmt, NULL);
+    }
+    if (rc == SQLITE_OK) {
+        rc = sqlite3_step(stmt);
+        if (rc == SQLITE_ROW) {
+            run->firstId = sqlite3_column_int64(stmt, 0);
+            run->lastId = sqlite3_column_type(stmt, 1) == SQLITE_NULL ? run->firstId - 1 : sqlite3_column_int64(stmt, 1);
+            rc = SQLITE_OK;
+        }
+    }
+    sqlite3_finalize(stmt);
+    sqlite3_close(conn);
+    return rc;
+}
+
+static int RunReport(const char* path, const PragmaProfile* profile, int threads, const char* sql,
+                     const char* from, const char* to, SalesReport* report) {
+    ReportRun* run = (ReportRun*)calloc(1, sizeof(ReportRun));
+    sqlite3_uint64 span;
+    int rc, i, started = 1;
+
+    memset(report, 0, sizeof(*report));
+    if (!run) {
+        return SQLITE_NOMEM;
+    }
+    run->path = path;
+    run->profile = profile;
+    run->sql = sql;
+    run->from = from;
+    run->to = to;
+    run->threads = threads < 1 ? 1 : threads > SALES_REPORT_MAX_THREADS ? SALES_REPORT_MAX_THREADS : threads;
+
+    rc = ReadIdBounds(run);
+    if (rc != SQLITE_OK || run->lastId < run->firstId) {
+        free(run);
+        return rc;
+    }
+
+    span = (sqlite3_uint64)(run->lastId - run->firstId) + 1;
+    run->rangeCount = run->threads * SALES_REPORT_RANGES_PER_THREAD;
+    if (span / SALES_REPORT_MIN_RANGE < (sqlite3_uint64)run->rangeCount) {
+        run->rangeCount = (int)(span / SALES_REPORT_MIN_RANGE) + 1;
+    }
+    if (run->threads > run->rangeCount) {
+        run->threads = run->rangeCount;
+    }
+
+    // Each thread is dealt an equal run of neighbouring ranges, so it reads on through the table
+    for (i = 0; i < run->threads; i++) {
+        ReportWorker* worker = &run->workers[i];
+        uint64_t first = (uint64_t)run->rangeCount * i / run->threads;
+        uint64_t end = (uint64_t)run->rangeCount * (i + 1) / run->threads;
+
+        worker->run = run;
+        worker->index = i;
+        worker->ranges = first | end << 32;
+    }
+    // A thread that cannot start leaves its run to be stolen
+    while (started < run->threads && ReportWorker_Start(&run->workers[started])) {
+        started++;
+    }
+    ReportWorker_Run(&run->workers[0]);
+    for (i = 1; i < started; i++) {
+        ReportWorker_Join(&run->workers[i]);
+    }
+
+    for (i = 0; i < run->threads; i++) {
+        ReportWorker* worker = &run->workers[i];
+
+        if (rc == SQLITE_OK && i < started) {
+            rc = worker->rc;
+        }
+        report->stolen += worker->stolen;
+    }
+
+    // The merge grows thread 0's table by the others'
+    for (i = 1; i < started && rc == SQLITE_OK; i++) {
+        const ReportTable* partial = &run->workers[i].table;
+        sqlite3_int64 r;
+
+        for (r = 0; r < partial->count && rc == SQLITE_OK; r++) {
+            if (!ReportTable_Add(&run->workers[0].table, &partial->rows[r])) {
+                rc = SQLITE_NOMEM;
+            }
+        }
+    }
+
+    if (rc == SQLITE_OK) {
+        report->rows = run->workers[0].table.rows;
+        report->count = run->workers[0].table.count;
+        run->workers[0].table.rows = NULL;
+    }
+    report->threads = started;
+    report->ranges = run->rangeCount;
+    for (i = 0; i < run->threads; i++) {
+        ReportTable_Free(&run->workers[i].table);
+    }
+    free(run);
+    return rc;
+}
+
+static int CompareProductDays(const void* a, const void* b) {
+    const SalesReportRow* left = (const SalesReportRow*)a;
+    const SalesReportRow* right = (const SalesReportRow*)b;
+    int order = strcmp(left->day, right->day);
+
+    if (order != 0) {
+        return order;
+    }
+    return left->productId < right->productId ? -1 : left->productId > right->productId;
+}
+
+static int CompareRevenueDescending(const void* a, const void* b) {
+    const SalesReportRow* left = (const SalesReportRow*)a;
+    const SalesReportRow* right = (const SalesReportRow*)b;
+
+    if (left->revenue != right->revenue) {
+        return left->revenue < right->revenue ? 1 : -1;
+    }
+    return left->productId < right->productId ? -1 : left->productId > right->productId;
+}
+
+int SalesReport_ProductDays(const char* path, const PragmaProfile* profile, int threads,
+                            const char* from, const char* to, SalesReport* report) {
+    int rc = RunReport(path, profile, threads, SQL_SALES_RANGE_PRODUCT_DAYS, from, to, report);
+
+    if (rc == SQLITE_OK) {
+        qsort(report->rows, (size_t)report->count, sizeof(SalesReportRow), CompareProductDays);
+    }
+    return rc;
+}
+
+int SalesReport_TopProducts(const char* path, const PragmaProfile* profile, int threads,
+                            const char* from, const char* to, int limit, SalesReport* report) {
+    int rc = RunReport(path, profile, threads, SQL_SALES_RANGE_PRODUCTS, from, to, report);
+
+    if (rc == SQLITE_OK) {
+        qsort(report->rows, (size_t)report->count, sizeof(SalesReportRow), CompareRevenueDescending);
+        if (report->count > limit) {
+            report->count = limit < 0 ? 0 : limit;
+        }
+    }
+    return rc;
+}
+
+void SalesReport_Free(SalesReport* report) {
+    free(report->rows);
+    memset(report, 0, sizeof(*report));
+}
@@ -0,0 +1,60 @@
+/*
+ * Parallel sales reports
+ * SQLite runs a statement on one core. Here a report is cut into ranges of sales ids, and
+ * threads, each with its own read-only connection, aggregate the ranges into private tables
+ * that are merged once every range is done. Each thread is dealt a run of ranges; one that
+ * finishes early takes ranges from the back of the longest run left.
+ * Sales are only appended, so bounding the ranges by the newest id at the start gives every
+ * connection the same rows, although their read transactions begin at different times.
+ */
+
+#ifndef SALES_REPORT_H
+#define SALES_REPORT_H
+
+#include <stdint.h>
+#include <sqlite3.h>
+#include "db_profiles.h"
+#include "money.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SALES_REPORT_MAX_THREADS 64
+#define SALES_REPORT_RANGES_PER_THREAD 16   // spare ranges for threads that finish early
+#define SALES_REPORT_MIN_RANGE 4096         // sales ids per range, at least
+
+typedef struct {
+    sqlite3_int64 productId;
+    char day[11];               // 'YYYY-MM-DD'; empty in product totals
+    sqlite3_int64 transactions;
+    sqlite3_int64 units;
+    Money revenue;
+} SalesReportRow;
+
+typedef struct {
+    SalesReportRow* rows;
+    sqlite3_int64 count;
+    int threads;
+    int ranges;
+    int stolen;                 // ranges run by a thread other than the one dealt them
+} SalesReport;
+
+// Transactions, units and revenue of each product on each day over [from, to), as
+// 'YYYY-MM-DD' or NULL for an open end, by day then product. path must be in WAL mode, see
+// OpenReadConnection; threads is clamped to 1-SALES_REPORT_MAX_THREADS.
+// Returns SQLITE_OK, SQLITE_NOMEM, SQLITE_CANTOPEN for a connection, or the first SQLite error.
+int SalesReport_ProductDays(const char* path, const PragmaProfile* profile, int threads,
+                            const char* from, const char* to, SalesReport* report);
+
+// The limit products with the most revenue over [from, to), highest first; otherwise as above
+int SalesReport_TopProducts(const char* path, const PragmaProfile* profile, int threads,
+                            const char* from, const char* to, int limit, SalesReport* report);
+
+void SalesReport_Free(SalesReport* report);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
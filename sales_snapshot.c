@@ -0,0 +1,517 @@
+/*
+ * Columnar sales snapshot
+ * The writer buffers one block of rows from SQLite, encodes each column with the narrowest bit
+ * width that holds it and appends the block; the reader decodes straight from the mapped file
+ */
+
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200112L     // mmap in strict C modes
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sales_snapshot.h"
+#include "db_queries.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define SNAPSHOT_MAX_PACKED_WIDTH 56   // a value plus its bit offset within a byte fits one word
+
+typedef struct {
+    FILE* file;
+    int64_t offset;                 // bytes written so far
+    int64_t* dictionary;
+    int64_t dictionarySize;
+    SalesSnapshotBlock* blocks;     // the directory, written last
+    int64_t blockCount;
+    int64_t blockCapacity;
+    int64_t values[SNAPSHOT_COLUMNS][SALES_SNAPSHOT_BLOCK_ROWS];
+    uint64_t codes[SALES_SNAPSHOT_BLOCK_ROWS];
+    uint64_t packed[SALES_SNAPSHOT_BLOCK_ROWS + 1];
+    int failed;
+} SnapshotWriter;
+
+// Bytes of a column: whole words for the values plus one word of padding
+static size_t ColumnBytes(uint32_t rows, unsigned width) {
+    return (size_t)(((uint64_t)rows * width + 63) / 64 + 1) * 8;
+}
+
+static unsigned WidthOf(uint64_t largest) {
+    unsigned width = 0;
+
+    while (width < 64 && (largest >> width) != 0) {
+        width++;
+    }
+    return width > SNAPSHOT_MAX_PACKED_WIDTH ? 64 : width;
+}
+
+static uint64_t Unpack(const unsigned char* column, unsigned width, uint32_t index) {
+    uint64_t bit = (uint64_t)index * width;
+    uint64_t word;
+
+    if (width == 64) {
+        memcpy(&word, column + (size_t)index * 8, 8);
+        return word;
+    }
+    memcpy(&word, column + (bit >> 3), 8);
+    return (word >> (bit & 7)) & (((uint64_t)1 << width) - 1);
+}
+
+static void SnapshotWriter_Write(SnapshotWriter* writer, const void* data, size_t size) {
+    if (!writer->failed && fwrite(data, 1, size, writer->file) != size) {
+        writer->failed = 1;
+    }
+    writer->offset += (int64_t)size;
+}
+
+// Index of productId in the dictionary, or -1
+static int64_t FindProduct(const int64_t* dictionary, int64_t size, int64_t productId) {
+    int64_t low = 0, high = size;
+
+    while (low < high) {
+        int64_t middle = low + (high - low) / 2;
+        if (dictionary[middle] < productId) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low < size && dictionary[low] == productId ? low : -1;
+}
+
+// Packs writer->codes into one column and appends it; returns the width used
+static unsigned SnapshotWriter_Column(SnapshotWriter* writer, uint32_t rows) {
+    uint64_t largest = 0;
+    size_t bytes;
+    unsigned width;
+    uint32_t i;
+
+    for (i = 0; i < rows; i++) {
+        if (writer->codes[i] > largest) {
+            largest = writer->codes[i];
+        }
+    }
+    width = WidthOf(largest);
+    bytes = ColumnBytes(rows, width);
+    memset(writer->packed, 0, bytes);
+
+    if (width == 64) {
+        memcpy(writer->packed, writer->codes, (size_t)rows * 8);
+    } else if (width > 0) {
+        unsigned char* out = (unsigned char*)writer->packed;
+
+        for (i = 0; i < rows; i++) {
+            uint64_t bit = (uint64_t)i * width;
+            uint64_t word;
+
+            memcpy(&word, out + (bit >> 3), 8);
+            word |= writer->codes[i] << (bit & 7);
+            memcpy(out + (bit >> 3), &word, 8);
+        }
+    }
+    SnapshotWriter_Write(writer, writer->packed, bytes);
+    return width;
+}
+
+// Encodes the buffered rows as the next block and adds it to the directory
+static int SnapshotWriter_Block(SnapshotWriter* writer, uint32_t rows) {
+    SalesSnapshotBlock block;
+    int column;
+    uint32_t i;
+
+    memset(&block, 0, sizeof(block));
+    block.offset = writer->offset;
+    block.rows = rows;
+
+    for (column = 0; column < SNAPSHOT_COLUMNS; column++) {
+        const int64_t* values = writer->values[column];
+        int64_t low = values[0], high = values[0];
+
+        for (i = 1; i < rows; i++) {
+            if (values[i] < low) {
+                low = values[i];
+            } else if (values[i] > high) {
+                high = values[i];
+            }
+        }
+        block.min[column] = low;
+        block.max[column] = high;
+
+        if (column == SNAPSHOT_ID || column == SNAPSHOT_TIME) {
+            // Rows are in id order, so ids rise by a steady step and times mostly rise too.
+            // Differences wrap rather than overflow, and decoding wraps them back.
+            int64_t smallest = rows > 1 ? (int64_t)((uint64_t)values[1] - (uint64_t)values[0]) : 0;
+
+            for (i = 2; i < rows; i++) {
+                int64_t delta = (int64_t)((uint64_t)values[i] - (uint64_t)values[i - 1]);
+                if (delta < smallest) {
+                    smallest = delta;
+                }
+            }
+            block.first[column] = values[0];
+            block.base[column] = smallest;
+            writer->codes[0] = 0;
+            for (i = 1; i < rows; i++) {
+                writer->codes[i] = (uint64_t)values[i] - (uint64_t)values[i - 1] - (uint64_t)smallest;
+            }
+        } else {
+            block.base[column] = low;
+            for (i = 0; i < rows; i++) {
+                writer->codes[i] = (uint64_t)values[i] - (uint64_t)low;
+            }
+        }
+        block.width[column] = (uint8_t)SnapshotWriter_Column(writer, rows);
+    }
+
+    for (i = 0; i < rows; i++) {
+        block.units += writer->values[SNAPSHOT_QUANTITY][i];
+        block.revenue += writer->values[SNAPSHOT_TOTAL][i];
+    }
+
+    if (writer->blockCount == writer->blockCapacity) {
+        int64_t capacity = writer->blockCapacity ? writer->blockCapacity * 2 : 64;
+        SalesSnapshotBlock* blocks = (SalesSnapshotBlock*)realloc(writer->blocks, (size_t)capacity * sizeof(*blocks));
+
+        if (!blocks) {
+            return SQLITE_NOMEM;
+        }
+        writer->blocks = blocks;
+        writer->blockCapacity = capacity;
+    }
+    writer->blocks[writer->blockCount++] = block;
+    return SQLITE_OK;
+}
+
+// Every distinct product id, ascending
+static int SnapshotWriter_Dictionary(SnapshotWriter* writer, sqlite3* conn) {
+    sqlite3_stmt* stmt;
+    int64_t capacity = 0;
+    int rc = sqlite3_prepare_v2(conn, SQL_SALES_SNAPSHOT_PRODUCTS, -1, &stmt, NULL);
+
+    while (rc == SQLITE_OK) {
+        int step = sqlite3_step(stmt);
+
+        if (step != SQLITE_ROW) {
+            rc = step == SQLITE_DONE ? SQLITE_OK : step;
+            break;
+        }
+        if (writer->dictionarySize == capacity) {
+            int64_t* dictionary;
+
+            capacity = capacity ? capacity * 2 : 1024;
+            dictionary = (int64_t*)realloc(writer->dictionary, (size_t)capacity * sizeof(int64_t));
+            if (!dictionary) {
+                rc = SQLITE_NOMEM;
+                break;
+            }
+            writer->dictionary = dictionary;
+        }
+        writer->dictionary[writer->dictionarySize++] = sqlite3_column_int64(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+    return rc;
+}
+
+int SalesSnapshot_Write(sqlite3* conn, const char* path, SalesSnapshotResult* result) {
+    SnapshotWriter* writer;
+    SalesSnapshotHeader header;
+    sqlite3_stmt* stmt = NULL;
+    uint32_t rows = 0;
+    int rc;
+
+    memset(result, 0, sizeof(*result));
+
+    // A few megabytes of block buffers, so off the stack
+    writer = (SnapshotWriter*)calloc(1, sizeof(SnapshotWriter));
+    if (!writer) {
+        return SQLITE_NOMEM;
+    }
+    writer->file = fopen(path, "wb");
+    if (!writer->file) {
+        free(writer);
+        return SQLITE_CANTOPEN;
+    }
+
+    // Written again with the counts and offsets once everything else is in place
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SALES_SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SALES_SNAPSHOT_VERSION;
+    header.blockRows = SALES_SNAPSHOT_BLOCK_ROWS;
+    SnapshotWriter_Write(writer, &header, sizeof(header));
+
+    // The dictionary and the rows come from one read transaction, so every product is in it
+    rc = sqlite3_exec(conn, "BEGIN", NULL, NULL, NULL);
+    if (rc == SQLITE_OK) {
+        rc = SnapshotWriter_Dictionary(writer, conn);
+    }
+    if (rc == SQLITE_OK) {
+        rc = sqlite3_prepare_v2(conn, SQL_SALES_SNAPSHOT, -1, &stmt, NULL);
+    }
+    while (rc == SQLITE_OK && !writer->failed) {
+        int step = sqlite3_step(stmt);
+        int64_t product;
+
+        if (step != SQLITE_ROW) {
+            rc = step == SQLITE_DONE ? SQLITE_OK : step;
+            break;
+        }
+        product = FindProduct(writer->dictionary, writer->dictionarySize, sqlite3_column_int64(stmt, 2));
+        if (product < 0) {
+            rc = SQLITE_CORRUPT;
+            break;
+        }
+        writer->values[SNAPSHOT_ID][rows] = sqlite3_column_int64(stmt, 0);
+        writer->values[SNAPSHOT_TIME][rows] = sqlite3_column_int64(stmt, 1);
+        writer->values[SNAPSHOT_PRODUCT][rows] = product;
+        writer->values[SNAPSHOT_QUANTITY][rows] = sqlite3_column_int64(stmt, 3);
+        writer->values[SNAPSHOT_TOTAL][rows] = sqlite3_column_int64(stmt, 4);
+        result->rows++;
+
+        if (++rows == SALES_SNAPSHOT_BLOCK_ROWS) {
+            rc = SnapshotWriter_Block(writer, rows);
+            rows = 0;
+        }
+    }
+    sqlite3_finalize(stmt);
+    sqlite3_exec(conn, "COMMIT", NULL, NULL, NULL);
+
+    if (rc == SQLITE_OK && rows > 0) {
+        rc = SnapshotWriter_Block(writer, rows);
+    }
+    if (rc == SQLITE_OK) {
+        header.rows = result->rows;
+        header.blockCount = writer->blockCount;
+        header.dictionaryOffset = writer->offset;
+        header.dictionarySize = writer->dictionarySize;
+        SnapshotWriter_Write(writer, writer->dictionary, (size_t)writer->dictionarySize * sizeof(int64_t));
+        header.directoryOffset = writer->offset;
+        SnapshotWriter_Write(writer, writer->blocks, (size_t)writer->blockCount * sizeof(SalesSnapshotBlock));
+        result->bytes = writer->offset;
+        if (fseek(writer->file, 0, SEEK_SET) != 0 || fwrite(&header, sizeof(header), 1, writer->file) != 1) {
+            writer->failed = 1;
+        }
+    }
+
+    if (fclose(writer->file) != 0) {
+        writer->failed = 1;
+    }
+    if (rc == SQLITE_OK && writer->failed) {
+        rc = SQLITE_IOERR;
+    }
+    // Without its header and directory the file is unreadable, so none is better than part
+    if (rc != SQLITE_OK) {
+        remove(path);
+        result->bytes = 0;
+    }
+
+    result->blocks = writer->blockCount;
+    result->products = writer->dictionarySize;
+    free(writer->dictionary);
+    free(writer->blocks);
+    free(writer);
+    return rc;
+}
+
+/*
+ * Reader
+ */
+
+#ifdef _WIN32
+static const unsigned char* MapFile(const char* path, size_t* size) {
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    HANDLE mapping = NULL;
+    LARGE_INTEGER length;
+    void* view = NULL;
+
+    if (file == INVALID_HANDLE_VALUE) {
+        return NULL;
+    }
+    if (GetFileSizeEx(file, &length) && length.QuadPart > 0 && (unsigned long long)length.QuadPart <= (size_t)-1) {
+        mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    }
+    // The view keeps the file open on its own
+    if (mapping) {
+        view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        CloseHandle(mapping);
+    }
+    CloseHandle(file);
+    *size = view ? (size_t)length.QuadPart : 0;
+    return (const unsigned char*)view;
+}
+
+static void UnmapFile(const unsigned char* data, size_t size) {
+    (void)size;
+    UnmapViewOfFile(data);
+}
+#else
+static const unsigned char* MapFile(const char* path, size_t* size) {
+    struct stat info;
+    void* view = MAP_FAILED;
+    int fd = open(path, O_RDONLY);
+
+    if (fd < 0) {
+        return NULL;
+    }
+    if (fstat(fd, &info) == 0 && info.st_size > 0 && (unsigned long long)info.st_size <= (size_t)-1) {
+        view = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    // The mapping keeps the file open on its own
+    close(fd);
+    if (view == MAP_FAILED) {
+        return NULL;
+    }
+    *size = (size_t)info.st_size;
+    return (const unsigned char*)view;
+}
+
+static void UnmapFile(const unsigned char* data, size_t size) {
+    munmap((void*)data, size);
+}
+#endif
+
+// Whether a section of count items of itemSize bytes at offset lies within the file, aligned
+static int SectionFits(const SalesSnapshot* snapshot, int64_t offset, int64_t count, size_t itemSize) {
+    return offset >= (int64_t)sizeof(SalesSnapshotHeader) && offset % 8 == 0 && count >= 0 &&
+           (uint64_t)offset <= snapshot->size &&
+           (uint64_t)count <= (snapshot->size - (uint64_t)offset) / itemSize;
+}
+
+// Every offset and width is checked once here, so the scans need no bounds checks
+static int SnapshotValid(SalesSnapshot* snapshot) {
+    const SalesSnapshotHeader* header = (const SalesSnapshotHeader*)snapshot->data;
+    int64_t rows = 0;
+    int64_t b;
+
+    if (snapshot->size < sizeof(*header) || memcmp(header->magic, SALES_SNAPSHOT_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != SALES_SNAPSHOT_VERSION || header->blockRows == 0 ||
+        !SectionFits(snapshot, header->dictionaryOffset, header->dictionarySize, sizeof(int64_t)) ||
+        !SectionFits(snapshot, header->directoryOffset, header->blockCount, sizeof(SalesSnapshotBlock))) {
+        return 0;
+    }
+    snapshot->header = header;
+    snapshot->dictionary = (const int64_t*)(snapshot->data + header->dictionaryOffset);
+    snapshot->blocks = (const SalesSnapshotBlock*)(snapshot->data + header->directoryOffset);
+
+    for (b = 0; b < header->blockCount; b++) {
+        const SalesSnapshotBlock* block = &snapshot->blocks[b];
+        uint64_t bytes = 0;
+        int column;
+
+        if (block->rows > header->blockRows) {
+            return 0;
+        }
+        for (column = 0; column < SNAPSHOT_COLUMNS; column++) {
+            if (block->width[column] > SNAPSHOT_MAX_PACKED_WIDTH && block->width[column] != 64) {
+                return 0;
+            }
+            bytes += ColumnBytes(block->rows, block->width[column]);
+        }
+        if (!SectionFits(snapshot, block->offset, (int64_t)bytes, 1)) {
+            return 0;
+        }
+        rows += block->rows;
+    }
+    return rows == header->rows;
+}
+
+int SalesSnapshot_Open(SalesSnapshot* snapshot, const char* path) {
+    memset(snapshot, 0, sizeof(*snapshot));
+    snapshot->data = MapFile(path, &snapshot->size);
+    if (!snapshot->data) {
+        return 0;
+    }
+    if (!SnapshotValid(snapshot)) {
+        SalesSnapshot_Close(snapshot);
+        return 0;
+    }
+    return 1;
+}
+
+void SalesSnapshot_Close(SalesSnapshot* snapshot) {
+    if (snapshot->data) {
+        UnmapFile(snapshot->data, snapshot->size);
+    }
+    memset(snapshot, 0, sizeof(*snapshot));
+}
+
+// Decodes the time column of a block, and the product column when filtering, summing the
+// quantity and total of the rows that match. The id column is never touched.
+static void ScanBlock(const SalesSnapshot* snapshot, const SalesSnapshotBlock* block, int64_t from, int64_t to,
+                      int64_t product, SalesSnapshotTotals* totals) {
+    const unsigned char* columns[SNAPSHOT_COLUMNS];
+    const unsigned char* p = snapshot->data + block->offset;
+    unsigned timeWidth = block->width[SNAPSHOT_TIME];
+    unsigned productWidth = block->width[SNAPSHOT_PRODUCT];
+    unsigned quantityWidth = block->width[SNAPSHOT_QUANTITY];
+    unsigned totalWidth = block->width[SNAPSHOT_TOTAL];
+    uint64_t timeStep = (uint64_t)block->base[SNAPSHOT_TIME];
+    // The first row's code is 0, so starting one step back makes every row the same
+    uint64_t time = (uint64_t)block->first[SNAPSHOT_TIME] - timeStep;
+    uint64_t productCode = (uint64_t)(product - block->base[SNAPSHOT_PRODUCT]);
+    int64_t transactions = 0;
+    uint64_t units = 0, revenue = 0;
+    uint32_t i;
+    int column;
+
+    for (column = 0; column < SNAPSHOT_COLUMNS; column++) {
+        columns[column] = p;
+        p += ColumnBytes(block->rows, block->width[column]);
+    }
+
+    for (i = 0; i < block->rows; i++) {
+        time += timeStep + Unpack(columns[SNAPSHOT_TIME], timeWidth, i);
+        if ((int64_t)time < from || (int64_t)time >= to ||
+            (product >= 0 && Unpack(columns[SNAPSHOT_PRODUCT], productWidth, i) != productCode)) {
+            continue;
+        }
+        transactions++;
+        units += Unpack(columns[SNAPSHOT_QUANTITY], quantityWidth, i);
+        revenue += Unpack(columns[SNAPSHOT_TOTAL], totalWidth, i);
+    }
+
+    totals->transactions += transactions;
+    totals->units += (int64_t)units + transactions * block->base[SNAPSHOT_QUANTITY];
+    totals->revenue += (int64_t)revenue + transactions * block->base[SNAPSHOT_TOTAL];
+}
+
+void SalesSnapshot_Totals(const SalesSnapshot* snapshot, int64_t from, int64_t to, int64_t productId,
+                          SalesSnapshotTotals* totals) {
+    const SalesSnapshotHeader* header = snapshot->header;
+    int64_t product = -1;
+    int64_t b;
+
+    memset(totals, 0, sizeof(*totals));
+    if (productId != 0) {
+        product = FindProduct(snapshot->dictionary, header->dictionarySize, productId);
+        if (product < 0) {
+            totals->blocksSkipped = header->blockCount;
+            return;
+        }
+    }
+
+    for (b = 0; b < header->blockCount; b++) {
+        const SalesSnapshotBlock* block = &snapshot->blocks[b];
+        int inside = block->min[SNAPSHOT_TIME] >= from && block->max[SNAPSHOT_TIME] < to;
+
+        if (block->rows == 0 || block->max[SNAPSHOT_TIME] < from || block->min[SNAPSHOT_TIME] >= to ||
+            (product >= 0 && (product < block->min[SNAPSHOT_PRODUCT] || product > block->max[SNAPSHOT_PRODUCT]))) {
+            totals->blocksSkipped++;
+        } else if (inside && (product < 0 || block->min[SNAPSHOT_PRODUCT] == block->max[SNAPSHOT_PRODUCT])) {
+            totals->transactions += block->rows;
+            totals->units += block->units;
+            totals->revenue += block->revenue;
+            totals->blocksSummed++;
+        } else {
+            ScanBlock(snapshot, block, from, to, product, totals);
+            totals->blocksScanned++;
+        }
+    }
+}
@@ -0,0 +1,109 @@
+/*
+ * Columnar sales snapshot
+ * A compact read-only copy of the sales table for analysis away from the till. The file is
+ * memory-mapped and aggregated without SQLite; only writing it needs a database connection.
+ *
+ * Layout, little-endian: SalesSnapshotHeader, the blocks, the product dictionary (ascending
+ * product ids) and the block directory (one SalesSnapshotBlock each). A block holds up to
+ * SALES_SNAPSHOT_BLOCK_ROWS sales in id order as five bit-packed columns:
+ *   id, time         deltas from the previous row, less the block's smallest delta
+ *   product          index into the dictionary, less the block's smallest
+ *   quantity, total  value less the block's minimum
+ * Each column fills whole 64-bit words plus one word of padding, so every section stays 8-byte
+ * aligned and a reader can always load a full word. Widths above 56 bits are stored as plain
+ * 64-bit values.
+ */
+
+#ifndef SALES_SNAPSHOT_H
+#define SALES_SNAPSHOT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sqlite3.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SALES_SNAPSHOT_MAGIC "IMSSNAP1"
+#define SALES_SNAPSHOT_VERSION 1
+#define SALES_SNAPSHOT_BLOCK_ROWS 65536
+
+enum {
+    SNAPSHOT_ID,
+    SNAPSHOT_TIME,          // Unix seconds of sale_date
+    SNAPSHOT_PRODUCT,
+    SNAPSHOT_QUANTITY,
+    SNAPSHOT_TOTAL,         // ngwee
+    SNAPSHOT_COLUMNS
+};
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t blockRows;
+    int64_t rows;
+    int64_t blockCount;
+    int64_t dictionaryOffset;
+    int64_t dictionarySize;         // distinct products
+    int64_t directoryOffset;
+} SalesSnapshotHeader;
+
+typedef struct {
+    int64_t offset;                 // of the block's first column
+    int64_t first[SNAPSHOT_COLUMNS]; // first row's id and time; unused for the others
+    int64_t base[SNAPSHOT_COLUMNS];  // smallest delta for id and time, minimum for the others
+    // Zone map: a block outside a query's range is skipped without being read
+    int64_t min[SNAPSHOT_COLUMNS];
+    int64_t max[SNAPSHOT_COLUMNS];  // product bounds are dictionary indexes
+    // Block totals: a block wholly inside a query's range is answered from these alone
+    int64_t units;
+    int64_t revenue;
+    uint32_t rows;
+    uint8_t width[SNAPSHOT_COLUMNS];
+    uint8_t reserved[7];
+} SalesSnapshotBlock;
+
+typedef struct {
+    const unsigned char* data;
+    size_t size;
+    const SalesSnapshotHeader* header;
+    const SalesSnapshotBlock* blocks;
+    const int64_t* dictionary;
+} SalesSnapshot;
+
+typedef struct {
+    int64_t rows;
+    int64_t blocks;
+    int64_t products;
+    int64_t bytes;
+} SalesSnapshotResult;
+
+typedef struct {
+    int64_t transactions;
+    int64_t units;
+    int64_t revenue;                // ngwee
+    int64_t blocksSkipped;          // outside the range, by zone map
+    int64_t blocksSummed;           // inside the range, from the block totals
+    int64_t blocksScanned;          // decoded row by row
+} SalesSnapshotTotals;
+
+// Writes every sale to path from one read transaction on conn. Memory use is one block plus
+// the dictionary, whatever the size of the table.
+// Returns SQLITE_OK, SQLITE_CANTOPEN or SQLITE_IOERR for the file, or the first SQLite error.
+int SalesSnapshot_Write(sqlite3* conn, const char* path, SalesSnapshotResult* result);
+
+// Maps a snapshot file read-only and checks its structure. Returns 0 if it cannot be used.
+int SalesSnapshot_Open(SalesSnapshot* snapshot, const char* path);
+void SalesSnapshot_Close(SalesSnapshot* snapshot);
+
+// Count, units and revenue of the sales with from <= time < to, in Unix seconds, of one
+// product or of all when productId is 0: SQL_SALES_TOTALS_SCAN and SQL_SALES_PRODUCT_TOTALS
+void SalesSnapshot_Totals(const SalesSnapshot* snapshot, int64_t from, int64_t to, int64_t productId,
+                          SalesSnapshotTotals* totals);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,90 @@
+/*
+ * Prepared statement cache, see stmt_cache.h
+ * Lookups compare a hash of the SQL text before the text itself, so a miss costs one
+ * integer compare per entry.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "stmt_cache.h"
+
+static unsigned int HashSql(const char* sql) {
+    unsigned int hash = 2166136261u;
+    for (; *sql; sql++) {
+        hash = (hash ^ (unsigned char)*sql) * 16777619u;
+    }
+    return hash;
+}
+
+sqlite3_stmt* StmtCache_Acquire(StatementCache* cache, const char* sql) {
+    unsigned int hash = HashSql(sql);
+    sqlite3_stmt* stmt = NULL;
+
+    for (int i = 0; i < cache->count; i++) {
+        CachedStatement* entry = &cache->entries[i];
+        if (entry->hash == hash && !entry->inUse && strcmp(entry->sql, sql) == 0) {
+            entry->inUse = 1;
+            cache->reuses++;
+            return entry->stmt;
+        }
+    }
+
+    if (sqlite3_prepare_v3(cache->conn, sql, -1, SQLITE_PREPARE_PERSISTENT, &stmt, 0) != SQLITE_OK) {
+        sqlite3_finalize(stmt);
+        return NULL;
+    }
+    cache->prepares++;
+
+    // A full cache, or a second borrower of a busy statement, gets an uncached one
+    if (cache->count < STMT_CACHE_SIZE) {
+        CachedStatement* entry = &cache->entries[cache->count];
+        entry->sql = (char*)malloc(strlen(sql) + 1);
+        if (entry->sql) {
+            strcpy(entry->sql, sql);
+            entry->hash = hash;
+            entry->stmt = stmt;
+            entry->inUse = 1;
+            cache->count++;
+        }
+    }
+    return stmt;
+}
+
+void StmtCache_Release(StatementCache* cache, sqlite3_stmt* stmt) {
+    if (!stmt) {
+        return;
+    }
+
+    for (int i = 0; i < cache->count; i++) {
+        CachedStatement* entry = &cache->entries[i];
+        if (entry->stmt == stmt) {
+            sqlite3_reset(stmt);
+            sqlite3_clear_bindings(stmt);
+            entry->inUse = 0;
+            return;
+        }
+    }
+    sqlite3_finalize(stmt);
+}
+
+int StmtCache_Exec(StatementCache* cache, const char* sql) {
+    sqlite3_stmt* stmt = StmtCache_Acquire(cache, sql);
+    int rc = SQLITE_ERROR;
+
+    if (stmt) {
+        rc = sqlite3_step(stmt);
+        if (rc == SQLITE_DONE || rc == SQLITE_ROW) {
+            rc = SQLITE_OK;
+        }
+    }
+    StmtCache_Release(cache, stmt);
+    return rc;
+}
+
+void StmtCache_Finalize(StatementCache* cache) {
+    for (int i = 0; i < cache->count; i++) {
+        sqlite3_finalize(cache->entries[i].stmt);
+        free(cache->entries[i].sql);
+    }
+    cache->count = 0;
+}
@@ -0,0 +1,46 @@
+/*
+ * Prepared statements on one connection, keyed by SQL text. Callers borrow a
+ * reset statement and hand it back instead of preparing and finalizing on
+ * every call. A cache belongs to the one thread that uses its connection.
+ */
+
+#ifndef STMT_CACHE_H
+#define STMT_CACHE_H
+
+#include <sqlite3.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define STMT_CACHE_SIZE 48
+
+typedef struct {
+    char* sql;
+    unsigned int hash;
+    sqlite3_stmt* stmt;
+    int inUse;
+} CachedStatement;
+
+typedef struct {
+    sqlite3* conn;
+    CachedStatement entries[STMT_CACHE_SIZE];
+    int count;
+    long prepares;          // statements compiled
+    long reuses;            // prepare calls avoided by handing out a cached statement
+} StatementCache;
+
+// Borrow a prepared statement for sql, ready to bind. Returns NULL if it fails to prepare.
+sqlite3_stmt* StmtCache_Acquire(StatementCache* cache, const char* sql);
+// Return a borrowed statement, NULL is ignored. Resetting it here ends its read transaction.
+void StmtCache_Release(StatementCache* cache, sqlite3_stmt* stmt);
+// Run a statement without parameters or results, such as BEGIN or COMMIT
+int StmtCache_Exec(StatementCache* cache, const char* sql);
+// Finalize every cached statement, before the connection is closed
+void StmtCache_Finalize(StatementCache* cache);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,573 @@
+/*
+ * Inventory Management System
+ * Headless tests for the portable modules main.c is built from
+ * Portable C without windows.h, like bench.c; each test works on an in-memory database, except
+ * the worker's, which shares a file between connections
+ *
+ * Usage: tests [name ...]
+ * Prints one line per test and exits nonzero if any failed.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sqlite3.h>
+#include "db_schema.h"
+#include "db_queries.h"
+#include "workload.h"
+#include "product_cache.h"
+#include "change_log.h"
+#include "stmt_cache.h"
+#include "db_worker.h"
+#include "thread_shim.h"
+
+#define TEST_PRODUCTS 100000
+#define TEST_DB_FILENAME "tests.db"
+
+typedef struct {
+    const char* name;
+    int (*run)(void);
+} Test;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            return 0; \
+        } \
+    } while (0)
+
+static void RemoveDatabase(const char* path) {
+    char name[256];
+
+    remove(path);
+    snprintf(name, sizeof(name), "%s-wal", path);
+    remove(name);
+    snprintf(name, sizeof(name), "%s-shm", path);
+    remove(name);
+}
+
+// Catalog of products with ids 1..products and no sales, in memory or in a new file
+static sqlite3* OpenTestCatalog(const char* path, sqlite3_int64 products) {
+    WorkloadSpec spec;
+    sqlite3* conn;
+
+    if (strcmp(path, ":memory:") != 0) {
+        RemoveDatabase(path);
+    }
+    if (sqlite3_open(path, &conn) != SQLITE_OK) {
+        sqlite3_close(conn);
+        return NULL;
+    }
+    Workload_Init(&spec, 1, 1);
+    spec.products = products;
+    spec.sales = 0;
+    if (sqlite3_exec(conn, SQL_CREATE_PRODUCTS SQL_CREATE_SALES, NULL, NULL, NULL) != SQLITE_OK ||
+        Workload_Generate(conn, &spec, NULL, NULL) != SQLITE_OK) {
+        fprintf(stderr, "cannot build the test catalog: %s\n", sqlite3_errmsg(conn));
+        sqlite3_close(conn);
+        return NULL;
+    }
+    return conn;
+}
+
+/*
+ * Product row cache
+ */
+
+// Filling the list reads ids only, painting a screen reads one page, and the page table
+// costs a fraction of a byte per product
+static int TestCacheFill(void) {
+    static ProductRowCache cache;
+    sqlite3* conn = OpenTestCatalog(":memory:", TEST_PRODUCTS);
+    size_t tableBytes;
+
+    CHECK(conn != NULL);
+    ProductCache_Init(&cache, conn, 0);
+    CHECK(ProductCache_Reset(&cache, NULL, NULL));
+    CHECK(cache.totalRows == TEST_PRODUCTS);
+    CHECK(cache.lastId == TEST_PRODUCTS);
+    CHECK(cache.pageCount == (TEST_PRODUCTS + PRODUCT_PAGE_SIZE - 1) / PRODUCT_PAGE_SIZE);
+    CHECK(cache.stats.scans == 1);
+    CHECK(cache.stats.idsScanned == TEST_PRODUCTS);
+    CHECK(cache.stats.rowsRead == 0);
+
+    // A visible screen of rows at the top, then at the far end of the list
+    for (int i = 0; i < 40; i++) {
+        const ProductRow* row = ProductCache_GetRow(&cache, i);
+        CHECK(row != NULL && row->id == i + 1 && row->name[0]);
+    }
+    CHECK(cache.stats.pageLoads == 1);
+    CHECK(cache.stats.rowsRead == PRODUCT_PAGE_SIZE);
+    for (int i = TEST_PRODUCTS - 40; i < TEST_PRODUCTS; i++) {
+        const ProductRow* row = ProductCache_GetRow(&cache, i);
+        CHECK(row != NULL && row->id == i + 1);
+    }
+    CHECK(cache.stats.pageLoads == 2);
+    CHECK(ProductCache_GetRow(&cache, TEST_PRODUCTS) == NULL);
+
+    // Only the page table grows with the catalog, by at most twice the anchors it holds
+    tableBytes = ProductCache_Bytes(&cache) - sizeof(cache);
+    CHECK(tableBytes <= 2 * cache.pageCount * (sizeof(ProductPage) + sizeof(int)));
+    CHECK((double)tableBytes / TEST_PRODUCTS < 1.0);
+
+    // A LIKE search reads names into the refine buffer but still no full rows
+    SearchResults results = {0};
+    sqlite3_int64 rowsRead = cache.stats.rowsRead;
+    CHECK(ProductCache_Reset(&cache, "99", &results));
+    CHECK(cache.filterMode == FILTER_LIKE && results.valid);
+    CHECK(results.count == cache.totalRows && cache.totalRows > 0);
+    CHECK(cache.stats.rowsRead == rowsRead);
+    CHECK(CanRefineSearch(&results, "999"));
+    RefineSearch(&cache, &results, "999");
+    CHECK(cache.totalRows == results.count && cache.totalRows > 0);
+    CHECK(strstr(ProductCache_GetRow(&cache, 0)->name, "999") != NULL);
+
+    SearchResults_Free(&results);
+    ProductCache_Free(&cache);
+    sqlite3_close(conn);
+    return 1;
+}
+
+// List work done by the mutations of one catalog size, counted as the product list would see it
+typedef struct {
+    int redraws;
+    int countChanges;
+    sqlite3_int64 rowsRead;
+    sqlite3_int64 scans;
+    sqlite3_int64 pageTableWrites;
+} ListWork;
+
+// Runs one mutation and applies what the update hook saw, as ApplyChanges does after a job
+static int Mutate(sqlite3* conn, ProductRowCache* cache, ChangeLog* log, const char* sql, ListWork* work) {
+    sqlite3_int64 rowsRead = cache->stats.rowsRead;
+    sqlite3_int64 scans = cache->stats.scans;
+    sqlite3_int64 writes = cache->stats.pageTableWrites;
+
+    if (sqlite3_exec(conn, sql, NULL, NULL, NULL) != SQLITE_OK) {
+        fprintf(stderr, "%s: %s\n", sql, sqlite3_errmsg(conn));
+        return 0;
+    }
+    memset(work, 0, sizeof(*work));
+    if (log->overflow) {
+        ProductCache_Rescan(cache, NULL);
+        work->countChanges++;
+    }
+    for (int i = 0; i < log->count && !log->overflow; i++) {
+        int index;
+        if (log->changes[i].isSales) {
+            continue;
+        }
+        switch (ProductCache_ApplyChange(cache, log->changes[i].op, log->changes[i].rowid, &index)) {
+            case PRODUCT_LIST_REDRAW_ROW:
+                work->redraws++;
+                break;
+            case PRODUCT_LIST_COUNT:
+                work->countChanges++;
+                break;
+        }
+    }
+    log->count = 0;
+    log->overflow = 0;
+    work->rowsRead = cache->stats.rowsRead - rowsRead;
+    work->scans = cache->stats.scans - scans;
+    work->pageTableWrites = cache->stats.pageTableWrites - writes;
+    return 1;
+}
+
+// Every list row against the ids a fresh scan would list
+static int SameAsRescan(sqlite3* conn, ProductRowCache* cache) {
+    sqlite3_stmt* stmt;
+    int index = 0, same = 1;
+
+    if (sqlite3_prepare_v2(conn, SQL_PRODUCT_IDS, -1, &stmt, NULL) != SQLITE_OK) {
+        return 0;
+    }
+    while (same && sqlite3_step(stmt) == SQLITE_ROW) {
+        const ProductRow* row = ProductCache_GetRow(cache, index++);
+        same = row && row->id == sqlite3_column_int64(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+    return same && index == cache->totalRows;
+}
+
+// A purchase, an edit, a delete and an add each cost the list a constant amount of work,
+// the same for a catalog of a thousand products and one of a hundred thousand
+static int RunCacheMutations(sqlite3_int64 products, ListWork* work) {
+    static ProductRowCache cache;
+    ChangeLog log = {0};
+    sqlite3* conn = OpenTestCatalog(":memory:", products);
+    int pages, logPages = 0;
+    char sql[256];
+
+    CHECK(conn != NULL);
+    ProductCache_Init(&cache, conn, 0);
+    CHECK(ProductCache_Reset(&cache, NULL, NULL));
+    InstallChangeHooks(conn, &log);
+    pages = cache.pageCount;
+    while ((1 << logPages) < pages) {
+        logPages++;
+    }
+
+    // The first screen is on show; no later page is cached
+    for (int i = 0; i < 40; i++) {
+        CHECK(ProductCache_GetRow(&cache, i) != NULL);
+    }
+
+    // Purchase of a visible product: its row is re-read and redrawn, nothing else
+    CHECK(Mutate(conn, &cache, &log,
+                 "BEGIN; UPDATE products SET quantity = quantity - 1 WHERE id = 5;"
+                 "INSERT INTO sales (product_id, product_name, quantity_sold, total_amount, total_cents) VALUES (5, 'x', 1, 1, 100);"
+                 "COMMIT", &work[0]));
+    CHECK(work[0].redraws == 1 && work[0].countChanges == 0);
+    CHECK(work[0].rowsRead == 1 && work[0].scans == 0);
+
+    // Edit of a product on an uncached page: nothing to redraw or read
+    snprintf(sql, sizeof(sql), "UPDATE products SET name = 'Renamed' WHERE id = %d", PRODUCT_PAGE_SIZE * 2 + 7);
+    CHECK(Mutate(conn, &cache, &log, sql, &work[1]));
+    CHECK(work[1].redraws == 0 && work[1].countChanges == 0 && work[1].rowsRead == 0);
+
+    // Delete from the visible page: the cached copy drops the row, one count change
+    CHECK(Mutate(conn, &cache, &log, "DELETE FROM products WHERE id = 3", &work[2]));
+    CHECK(work[2].countChanges == 1 && work[2].rowsRead == 0 && work[2].scans == 0);
+    CHECK(work[2].pageTableWrites <= logPages + 1);
+    CHECK(ProductCache_GetRow(&cache, 2)->id == 4);
+
+    // Emptying a whole page, a change log's worth of rows at a time, keeps it in the table
+    // and the rows after it in place
+    for (int id = PRODUCT_PAGE_SIZE + 1; id <= PRODUCT_PAGE_SIZE * 2; id += MAX_PENDING_CHANGES) {
+        snprintf(sql, sizeof(sql), "DELETE FROM products WHERE id >= %d AND id < %d", id, id + MAX_PENDING_CHANGES);
+        CHECK(Mutate(conn, &cache, &log, sql, &work[3]));
+        CHECK(work[3].countChanges == MAX_PENDING_CHANGES && work[3].scans == 0);
+    }
+    CHECK(cache.pageCount == pages);
+    CHECK(ProductCache_GetRow(&cache, PRODUCT_PAGE_SIZE - 1)->id == PRODUCT_PAGE_SIZE * 2 + 1);
+
+    // Add: the new id is above every other, so only the last page grows
+    CHECK(Mutate(conn, &cache, &log, "INSERT INTO products (name, quantity, price, price_cents) VALUES ('Added', 1, 1, 100)",
+                 &work[4]));
+    CHECK(work[4].countChanges == 1 && work[4].scans == 0 && work[4].rowsRead == 0);
+    CHECK(work[4].pageTableWrites <= logPages + 2);
+    CHECK(ProductCache_GetRow(&cache, cache.totalRows - 1)->id == products + 1);
+
+    CHECK(SameAsRescan(conn, &cache));
+    ProductCache_Free(&cache);
+    sqlite3_close(conn);
+    return 1;
+}
+
+static int TestCacheMutations(void) {
+    ListWork small[5], large[5];
+
+    CHECK(RunCacheMutations(1000, small));
+    CHECK(RunCacheMutations(TEST_PRODUCTS, large));
+    for (int i = 0; i < 5; i++) {
+        CHECK(small[i].redraws == large[i].redraws);
+        CHECK(small[i].countChanges == large[i].countChanges);
+        CHECK(small[i].rowsRead == large[i].rowsRead);
+        CHECK(small[i].scans == large[i].scans);
+    }
+    return 1;
+}
+
+/*
+ * Database worker
+ */
+
+#define STRESS_PRODUCERS 8
+#define STRESS_REQUESTS 2000        // per producer
+#define STRESS_PRODUCTS 200
+#define STRESS_STOCK 40             // per product, so purchases start failing halfway through
+
+typedef enum {
+    STRESS_PURCHASE,
+    STRESS_ADD_PRODUCT,
+    STRESS_COUNT_SALES              // not a mutation: ends the batch and runs on its own
+} StressKind;
+
+typedef struct {
+    DbWork work;                    // first: the worker queues requests through it
+    StressKind kind;
+    sqlite3_int64 productId;
+    char name[64];
+    sqlite3_int64 salesSeen;        // STRESS_COUNT_SALES: sales committed when it ran
+    sqlite3_int64 salesAcked;       // purchases acknowledged before it was
+    long completedAt;               // place in completion order, from 1
+    int completions;
+} StressRequest;
+
+typedef struct {
+    DbWorker worker;
+    StressRequest* requests;        // STRESS_REQUESTS per producer, in submission order
+    long completed;                 // worker thread only
+    sqlite3_int64 purchasesAcked;   // worker thread only
+} StressRun;
+
+typedef struct {
+    StressRun* run;
+    int index;
+} StressProducer;
+
+static StressRun g_stressRun;
+
+// A purchase of one unit, as RecordSale runs it, or a new product
+static void StressMutate(DbWorker* worker, DbWork* work) {
+    StressRequest* request = (StressRequest*)work;
+    sqlite3_stmt* stmt;
+
+    if (request->kind == STRESS_ADD_PRODUCT) {
+        stmt = StmtCache_Acquire(&worker->stmts, SQL_INSERT_PRODUCT);
+        if (stmt) {
+            sqlite3_bind_text(stmt, 1, request->name, -1, SQLITE_STATIC);
+            sqlite3_bind_int(stmt, 2, STRESS_STOCK);
+            sqlite3_bind_int64(stmt, 3, 100);
+            work->ok = sqlite3_step(stmt) == SQLITE_DONE;
+        }
+        StmtCache_Release(&worker->stmts, stmt);
+        if (!work->ok) {
+            work->error = "add failed";
+        }
+        return;
+    }
+
+    Money total = 0;
+    stmt = StmtCache_Acquire(&worker->stmts, SQL_PURCHASE_UPDATE_STOCK);
+    if (stmt) {
+        sqlite3_bind_int(stmt, 1, 1);
+        sqlite3_bind_int64(stmt, 2, request->productId);
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            total = sqlite3_column_int64(stmt, 1);
+            work->ok = sqlite3_step(stmt) == SQLITE_DONE;
+        }
+    }
+    StmtCache_Release(&worker->stmts, stmt);
+    if (!work->ok) {
+        work->error = "out of stock";
+        return;
+    }
+
+    work->ok = 0;
+    stmt = StmtCache_Acquire(&worker->stmts, SQL_PURCHASE_INSERT_SALE);
+    if (stmt) {
+        sqlite3_bind_int64(stmt, 1, request->productId);
+        sqlite3_bind_text(stmt, 2, "stress", -1, SQLITE_STATIC);
+        sqlite3_bind_int(stmt, 3, 1);
+        sqlite3_bind_int64(stmt, 4, total);
+        work->ok = sqlite3_step(stmt) == SQLITE_DONE;
+    }
+    StmtCache_Release(&worker->stmts, stmt);
+}
+
+static int StressRunJob(DbWorker* worker, DbWork* work) {
+    StressRequest* request = (StressRequest*)work;
+    sqlite3_stmt* stmt = StmtCache_Acquire(&worker->stmts, "SELECT COUNT(*) FROM sales");
+
+    if (stmt && sqlite3_step(stmt) == SQLITE_ROW) {
+        request->salesSeen = sqlite3_column_int64(stmt, 0);
+        work->ok = 1;
+    }
+    StmtCache_Release(&worker->stmts, stmt);
+    return 1;
+}
+
+static void StressDone(DbWork* work) {
+    StressRequest* request = (StressRequest*)work;
+    StressRun* run = &g_stressRun;
+
+    request->completions++;
+    request->completedAt = ++run->completed;
+    request->salesAcked = run->purchasesAcked;
+    if (request->kind == STRESS_PURCHASE && work->ok) {
+        run->purchasesAcked++;
+    }
+}
+
+// Submits every request without waiting; the worker's queue takes any number
+static void StressProducerMain(void* param) {
+    StressProducer* producer = (StressProducer*)param;
+    StressRequest* requests = producer->run->requests + producer->index * STRESS_REQUESTS;
+
+    for (int i = 0; i < STRESS_REQUESTS; i++) {
+        StressRequest* request = &requests[i];
+
+        if (i % 10 == 0) {
+            // Every fifth add repeats a name already taken, and fails alone inside its batch
+            request->kind = STRESS_ADD_PRODUCT;
+            snprintf(request->name, sizeof(request->name), "Stress %d-%d", producer->index, i % 50 == 0 ? 0 : i);
+        } else if (i % 25 == 7) {
+            request->kind = STRESS_COUNT_SALES;
+        } else {
+            request->kind = STRESS_PURCHASE;
+            request->productId = (producer->index * 7919 + i * 31) % STRESS_PRODUCTS + 1;
+        }
+        request->work.mutation = request->kind != STRESS_COUNT_SALES;
+        DbWorker_Submit(&producer->run->worker, &request->work);
+    }
+}
+
+static sqlite3_int64 QueryInt64(sqlite3* conn, const char* sql, sqlite3_int64 param) {
+    sqlite3_stmt* stmt;
+    sqlite3_int64 value = -1;
+
+    if (sqlite3_prepare_v2(conn, sql, -1, &stmt, NULL) == SQLITE_OK) {
+        sqlite3_bind_int64(stmt, 1, param);
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            value = sqlite3_column_int64(stmt, 0);
+        }
+    }
+    sqlite3_finalize(stmt);
+    return value;
+}
+
+// Eight threads submit purchases, adds and reads at once. Each request completes once, after
+// the COMMIT that holds it and in the order its thread submitted it; a failed mutation fails
+// alone; a read sees exactly the sales acknowledged before it; stock and sales agree.
+static int TestWorkerStress(void) {
+    StressRun* run = &g_stressRun;
+    StressProducer producers[STRESS_PRODUCERS];
+    ShimThread* threads[STRESS_PRODUCERS];
+    sqlite3_int64 bought[STRESS_PRODUCTS + 1] = {0};
+    sqlite3_int64 mutations = 0, purchases = 0;
+    long lastCompleted[STRESS_PRODUCERS];
+    char sql[64];
+    sqlite3* conn = OpenTestCatalog(TEST_DB_FILENAME, STRESS_PRODUCTS);
+
+    CHECK(conn != NULL);
+    CHECK(ApplyPragmaProfile(conn, FindPragmaProfile("bulk")) == SQLITE_OK);
+    snprintf(sql, sizeof(sql), "UPDATE products SET quantity = %d", STRESS_STOCK);
+    CHECK(sqlite3_exec(conn, sql, NULL, NULL, NULL) == SQLITE_OK);
+
+    memset(run, 0, sizeof(*run));
+    run->requests = (StressRequest*)calloc(STRESS_PRODUCERS * STRESS_REQUESTS, sizeof(StressRequest));
+    CHECK(run->requests != NULL);
+    run->worker.mutate = StressMutate;
+    run->worker.run = StressRunJob;
+    run->worker.done = StressDone;
+    run->worker.groupCommitMs = 1;
+    CHECK(DbWorker_Start(&run->worker, TEST_DB_FILENAME, FindPragmaProfile("bulk")));
+
+    for (int p = 0; p < STRESS_PRODUCERS; p++) {
+        producers[p].run = run;
+        producers[p].index = p;
+        threads[p] = ShimThread_Start(StressProducerMain, &producers[p]);
+        CHECK(threads[p] != NULL);
+    }
+    for (int p = 0; p < STRESS_PRODUCERS; p++) {
+        ShimThread_Join(threads[p]);
+    }
+    DbWorker_Stop(&run->worker);
+
+    CHECK(run->completed == STRESS_PRODUCERS * STRESS_REQUESTS);
+    for (int p = 0; p < STRESS_PRODUCERS; p++) {
+        lastCompleted[p] = 0;
+    }
+    for (int r = 0; r < STRESS_PRODUCERS * STRESS_REQUESTS; r++) {
+        StressRequest* request = &run->requests[r];
+        int p = r / STRESS_REQUESTS, i = r % STRESS_REQUESTS;
+
+        CHECK(request->completions == 1);
+        CHECK(request->completedAt > lastCompleted[p]);
+        lastCompleted[p] = request->completedAt;
+
+        switch (request->kind) {
+            case STRESS_PURCHASE:
+                mutations++;
+                if (request->work.ok) {
+                    CHECK(request->work.changes.count == 2 && !request->work.changes.overflow);
+                    bought[request->productId]++;
+                    purchases++;
+                } else {
+                    CHECK(request->work.error != NULL && request->work.changes.count == 0);
+                    // Stock only goes down, so a product that ran out stays out
+                    CHECK(QueryInt64(conn, "SELECT quantity FROM products WHERE id = ?", request->productId) == 0);
+                }
+                break;
+            case STRESS_ADD_PRODUCT:
+                mutations++;
+                CHECK(request->work.ok == (i == 0 || i % 50 != 0));
+                CHECK(request->work.changes.count == (request->work.ok ? 1 : 0));
+                break;
+            case STRESS_COUNT_SALES:
+                CHECK(request->work.ok && request->salesSeen == request->salesAcked);
+                break;
+        }
+    }
+
+    for (int id = 1; id <= STRESS_PRODUCTS; id++) {
+        CHECK(QueryInt64(conn, "SELECT quantity FROM products WHERE id = ?", id) == STRESS_STOCK - bought[id]);
+        CHECK(QueryInt64(conn, "SELECT COUNT(*) FROM sales WHERE product_id = ?", id) == bought[id]);
+    }
+    CHECK(QueryInt64(conn, "SELECT COUNT(*) FROM sales WHERE id > ?", 0) == purchases);
+    CHECK(purchases < mutations);
+    // Mutations queued together shared a COMMIT
+    CHECK(run->worker.commits > 0 && run->worker.commits < mutations);
+
+    free(run->requests);
+    sqlite3_close(conn);
+    RemoveDatabase(TEST_DB_FILENAME);
+    return 1;
+}
+
+/*
+ * Daily sales rollup
+ */
+
+// Deleting or moving a day's last sale removes its rollup rows instead of leaving them at zero
+static int TestRollupDeletes(void) {
+    sqlite3* conn = OpenTestCatalog(":memory:", 2);
+
+    CHECK(conn != NULL);
+    CHECK(sqlite3_exec(conn, SQL_CREATE_SALES_DAILY SQL_CREATE_SALES_DAILY_TRIGGERS
+                       "INSERT INTO sales (product_id, product_name, quantity_sold, total_amount, sale_date, total_cents) VALUES "
+                       "(1, 'a', 2, 2.0, '2024-03-01 10:00:00', 200),"
+                       "(2, 'b', 1, 5.0, '2024-03-01 11:00:00', 500),"
+                       "(1, 'a', 1, 1.0, '2024-03-02 09:00:00', 100);",
+                       NULL, NULL, NULL) == SQLITE_OK);
+    CHECK(QueryInt64(conn, "SELECT COUNT(*) FROM sales_daily WHERE product_id > ?", 0) == 3);
+
+    CHECK(sqlite3_exec(conn, "DELETE FROM sales WHERE product_id = 2", NULL, NULL, NULL) == SQLITE_OK);
+    CHECK(QueryInt64(conn, "SELECT COUNT(*) FROM sales_daily WHERE product_id = ?", 2) == 0);
+    CHECK(QueryInt64(conn, "SELECT revenue_cents FROM sales_daily_totals WHERE day = '2024-03-01' AND ?", 1) == 200);
+
+    // The last sale of 2024-03-02 moves to 2024-03-01
+    CHECK(sqlite3_exec(conn, "UPDATE sales SET sale_date = '2024-03-01 12:00:00' WHERE sale_date LIKE '2024-03-02%'",
+                       NULL, NULL, NULL) == SQLITE_OK);
+    CHECK(QueryInt64(conn, "SELECT COUNT(*) FROM sales_daily_totals WHERE transactions > ?", 0) == 1);
+    CHECK(QueryInt64(conn, "SELECT transactions FROM sales_daily WHERE product_id = ?", 1) == 2);
+
+    CHECK(sqlite3_exec(conn, "DELETE FROM sales", NULL, NULL, NULL) == SQLITE_OK);
+    CHECK(QueryInt64(conn, "SELECT COUNT(*) FROM sales_daily WHERE product_id > ?", 0) == 0);
+    CHECK(QueryInt64(conn, "SELECT COUNT(*) FROM sales_daily_totals WHERE transactions >= ?", 0) == 0);
+
+    sqlite3_close(conn);
+    return 1;
+}
+
+static const Test g_tests[] = {
+    { "cache_fill", TestCacheFill },
+    { "cache_mutations", TestCacheMutations },
+    { "worker_stress", TestWorkerStress },
+    { "rollup_deletes", TestRollupDeletes },
+};
+
+#define TEST_COUNT ((int)(sizeof(g_tests) / sizeof(g_tests[0])))
+
+int main(int argc, char** argv) {
+    int failed = 0;
+
+    for (int i = 0; i < TEST_COUNT; i++) {
+        int selected = argc < 2;
+        for (int a = 1; a < argc; a++) {
+            selected = selected || strcmp(argv[a], g_tests[i].name) == 0;
+        }
+        if (!selected) {
+            continue;
+        }
+
+        int ok = g_tests[i].run();
+        printf("%s %s\n", ok ? "PASS" : "FAIL", g_tests[i].name);
+        fflush(stdout);
+        failed += !ok;
+    }
+    return failed ? 1 : 0;
+}
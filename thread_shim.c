@@ -0,0 +1,206 @@
+/*
+ * Threads, a lock with one condition variable, and a monotonic clock
+ * The only file the database worker and the tests need windows.h or pthread.h for
+ */
+
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200112L     // clock_gettime and pthread_condattr_setclock in strict C modes
+#endif
+
+#include <stdlib.h>
+#include "thread_shim.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <time.h>
+#endif
+
+struct ShimThread {
+    void (*run)(void* param);
+    void* param;
+#ifdef _WIN32
+    HANDLE handle;
+#else
+    pthread_t handle;
+#endif
+};
+
+struct ShimMonitor {
+#ifdef _WIN32
+    CRITICAL_SECTION lock;
+    CONDITION_VARIABLE wake;
+#else
+    pthread_mutex_t lock;
+    pthread_cond_t wake;        // timed waits measure CLOCK_MONOTONIC, like Shim_NowMs
+#endif
+};
+
+#ifdef _WIN32
+static DWORD WINAPI ShimThread_Main(LPVOID param) {
+    ShimThread* thread = (ShimThread*)param;
+    thread->run(thread->param);
+    return 0;
+}
+
+ShimThread* ShimThread_Start(void (*run)(void* param), void* param) {
+    ShimThread* thread = (ShimThread*)malloc(sizeof(ShimThread));
+
+    if (!thread) {
+        return NULL;
+    }
+    thread->run = run;
+    thread->param = param;
+    thread->handle = CreateThread(NULL, 0, ShimThread_Main, thread, 0, NULL);
+    if (!thread->handle) {
+        free(thread);
+        return NULL;
+    }
+    return thread;
+}
+
+void ShimThread_Join(ShimThread* thread) {
+    WaitForSingleObject(thread->handle, INFINITE);
+    CloseHandle(thread->handle);
+    free(thread);
+}
+
+ShimMonitor* ShimMonitor_Create(void) {
+    ShimMonitor* monitor = (ShimMonitor*)malloc(sizeof(ShimMonitor));
+
+    if (monitor) {
+        InitializeCriticalSection(&monitor->lock);
+        InitializeConditionVariable(&monitor->wake);
+    }
+    return monitor;
+}
+
+void ShimMonitor_Enter(ShimMonitor* monitor) {
+    EnterCriticalSection(&monitor->lock);
+}
+
+void ShimMonitor_Leave(ShimMonitor* monitor) {
+    LeaveCriticalSection(&monitor->lock);
+}
+
+void ShimMonitor_Wait(ShimMonitor* monitor, int timeoutMs) {
+    SleepConditionVariableCS(&monitor->wake, &monitor->lock, timeoutMs < 0 ? INFINITE : (DWORD)timeoutMs);
+}
+
+void ShimMonitor_Wake(ShimMonitor* monitor) {
+    WakeConditionVariable(&monitor->wake);
+}
+
+void ShimMonitor_WakeAll(ShimMonitor* monitor) {
+    WakeAllConditionVariable(&monitor->wake);
+}
+
+void ShimMonitor_Free(ShimMonitor* monitor) {
+    if (monitor) {
+        DeleteCriticalSection(&monitor->lock);
+        free(monitor);
+    }
+}
+
+unsigned long long Shim_NowMs(void) {
+    return GetTickCount64();
+}
+#else
+static void* ShimThread_Main(void* param) {
+    ShimThread* thread = (ShimThread*)param;
+    thread->run(thread->param);
+    return NULL;
+}
+
+ShimThread* ShimThread_Start(void (*run)(void* param), void* param) {
+    ShimThread* thread = (ShimThread*)malloc(sizeof(ShimThread));
+
+    if (!thread) {
+        return NULL;
+    }
+    thread->run = run;
+    thread->param = param;
+    if (pthread_create(&thread->handle, NULL, ShimThread_Main, thread) != 0) {
+        free(thread);
+        return NULL;
+    }
+    return thread;
+}
+
+void ShimThread_Join(ShimThread* thread) {
+    pthread_join(thread->handle, NULL);
+    free(thread);
+}
+
+ShimMonitor* ShimMonitor_Create(void) {
+    ShimMonitor* monitor = (ShimMonitor*)malloc(sizeof(ShimMonitor));
+    pthread_condattr_t attr;
+
+    if (!monitor) {
+        return NULL;
+    }
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    if (pthread_mutex_init(&monitor->lock, NULL) != 0) {
+        pthread_condattr_destroy(&attr);
+        free(monitor);
+        return NULL;
+    }
+    if (pthread_cond_init(&monitor->wake, &attr) != 0) {
+        pthread_mutex_destroy(&monitor->lock);
+        pthread_condattr_destroy(&attr);
+        free(monitor);
+        return NULL;
+    }
+    pthread_condattr_destroy(&attr);
+    return monitor;
+}
+
+void ShimMonitor_Enter(ShimMonitor* monitor) {
+    pthread_mutex_lock(&monitor->lock);
+}
+
+void ShimMonitor_Leave(ShimMonitor* monitor) {
+    pthread_mutex_unlock(&monitor->lock);
+}
+
+void ShimMonitor_Wait(ShimMonitor* monitor, int timeoutMs) {
+    struct timespec until;
+
+    if (timeoutMs < 0) {
+        pthread_cond_wait(&monitor->wake, &monitor->lock);
+        return;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &until);
+    until.tv_sec += timeoutMs / 1000;
+    until.tv_nsec += (long)(timeoutMs % 1000) * 1000000L;
+    if (until.tv_nsec >= 1000000000L) {
+        until.tv_sec++;
+        until.tv_nsec -= 1000000000L;
+    }
+    pthread_cond_timedwait(&monitor->wake, &monitor->lock, &until);
+}
+
+void ShimMonitor_Wake(ShimMonitor* monitor) {
+    pthread_cond_signal(&monitor->wake);
+}
+
+void ShimMonitor_WakeAll(ShimMonitor* monitor) {
+    pthread_cond_broadcast(&monitor->wake);
+}
+
+void ShimMonitor_Free(ShimMonitor* monitor) {
+    if (monitor) {
+        pthread_cond_destroy(&monitor->wake);
+        pthread_mutex_destroy(&monitor->lock);
+        free(monitor);
+    }
+}
+
+unsigned long long Shim_NowMs(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long long)now.tv_sec * 1000 + (unsigned long long)(now.tv_nsec / 1000000);
+}
+#endif
@@ -0,0 +1,41 @@
+/*
+ * Threads, a lock with one condition variable, and a monotonic clock
+ * CreateThread, CRITICAL_SECTION and CONDITION_VARIABLE on Windows, pthreads elsewhere. The
+ * handles are opaque, so a header that includes this one never pulls in windows.h.
+ */
+
+#ifndef THREAD_SHIM_H
+#define THREAD_SHIM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SHIM_WAIT_FOREVER (-1)
+
+typedef struct ShimThread ShimThread;
+typedef struct ShimMonitor ShimMonitor;
+
+// Runs run(param) on a new thread. NULL if the thread cannot be created.
+ShimThread* ShimThread_Start(void (*run)(void* param), void* param);
+// Waits for the thread to return and releases the handle
+void ShimThread_Join(ShimThread* thread);
+
+ShimMonitor* ShimMonitor_Create(void);
+void ShimMonitor_Enter(ShimMonitor* monitor);
+void ShimMonitor_Leave(ShimMonitor* monitor);
+// Entered only. Leaves, sleeps until woken or for timeoutMs, SHIM_WAIT_FOREVER for no limit,
+// and enters again. Wakes can be spurious, so callers wait for a condition in a loop.
+void ShimMonitor_Wait(ShimMonitor* monitor, int timeoutMs);
+void ShimMonitor_Wake(ShimMonitor* monitor);
+void ShimMonitor_WakeAll(ShimMonitor* monitor);
+void ShimMonitor_Free(ShimMonitor* monitor);
+
+// Milliseconds from an arbitrary start; never goes back
+unsigned long long Shim_NowMs(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
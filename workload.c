@@ -0,0 +1,319 @@
+/*
+ * Synthetic inventory workload
+ * Everything derives from the seed, so the same spec always builds the same database
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "workload.h"
+
+#define WORKLOAD_DEFAULT_DAYS 365
+#define WORKLOAD_DEFAULT_END_TIME 1735689600LL   // 2025-01-01 00:00:00 UTC
+#define WORKLOAD_DEFAULT_BATCH 100000
+
+typedef struct {
+    const char* name;
+    sqlite3_int64 basePrice;    // typical price in ngwee
+} WorkloadCategory;
+
+static const char* g_brands[] = {
+    "Samsung", "HP", "Dell", "Lenovo", "Logitech", "Apple", "Sony", "Xiaomi", "Tecno", "Infinix",
+    "Huawei", "Anker", "JBL", "Canon", "Epson", "TP-Link", "Kingston", "SanDisk", "Seagate", "Philips",
+    "Acer", "Asus", "Microsoft", "Nokia", "Oraimo", "Hisense", "LG", "Belkin", "Razer", "Generic"
+};
+
+static const char* g_adjectives[] = {
+    "Wireless", "Portable", "Pro", "Mini", "Ultra", "Slim", "Smart", "Rechargeable",
+    "Compact", "Premium", "Gaming", "Bluetooth", "Fast", "Heavy Duty", "Classic", "Max"
+};
+
+static const WorkloadCategory g_categories[] = {
+    { "Laptop", 850000 }, { "Smartphone", 450000 }, { "Tablet", 300000 }, { "Monitor", 220000 },
+    { "Printer", 150000 }, { "Router", 60000 }, { "Keyboard", 45000 }, { "Mouse", 25000 },
+    { "Headphones", 38000 }, { "Earbuds", 30000 }, { "Speaker", 55000 }, { "Webcam", 32000 },
+    { "USB-C Hub", 18000 }, { "Power Bank", 28000 }, { "Charger", 15000 }, { "USB Cable", 6000 },
+    { "HDMI Cable", 8000 }, { "Flash Drive", 12000 }, { "Memory Card", 14000 }, { "External Drive", 65000 },
+    { "SSD", 90000 }, { "Phone Case", 6500 }, { "Screen Protector", 4500 }, { "Mouse Pad", 8500 },
+    { "Smartwatch", 120000 }, { "Television", 600000 }, { "Ink Cartridge", 22000 }, { "Extension Cord", 16000 },
+    { "Surge Protector", 24000 }, { "Desk Lamp", 19000 }, { "Microphone", 45000 }, { "Projector", 400000 }
+};
+
+#define COUNT_OF(a) ((int)(sizeof(a) / sizeof((a)[0])))
+
+// splitmix64: a good 64-bit mix that also serves as a stateless hash of (seed, index)
+static unsigned long long Mix64(unsigned long long x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+static unsigned long long NextRandom(unsigned long long* state) {
+    *state += 0x9E3779B97F4A7C15ULL;
+    return Mix64(*state);
+}
+
+// Uniform in [0, 1)
+static double RandomUnit(unsigned long long* state) {
+    return (NextRandom(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// Zipf over 1..n by rejection-inversion (Hoermann and Derflinger), O(1) per sample
+typedef struct {
+    double n, s;
+    double hIntegralX1, hIntegralN, threshold;
+} ZipfSampler;
+
+static double ZipfHelper1(double x) {
+    return fabs(x) > 1e-8 ? log1p(x) / x : 1.0 - x * (0.5 - x * (1.0 / 3.0 - 0.25 * x));
+}
+
+static double ZipfHelper2(double x) {
+    return fabs(x) > 1e-8 ? expm1(x) / x : 1.0 + x * 0.5 * (1.0 + x * (1.0 / 3.0) * (1.0 + 0.25 * x));
+}
+
+static double ZipfH(const ZipfSampler* z, double x) {
+    return exp(-z->s * log(x));
+}
+
+static double ZipfHIntegral(const ZipfSampler* z, double x) {
+    double logX = log(x);
+    return ZipfHelper2((1.0 - z->s) * logX) * logX;
+}
+
+static double ZipfHIntegralInverse(const ZipfSampler* z, double x) {
+    double t = x * (1.0 - z->s);
+    if (t < -1.0) {
+        t = -1.0;
+    }
+    return exp(ZipfHelper1(t) * x);
+}
+
+static void ZipfInit(ZipfSampler* z, sqlite3_int64 n, double s) {
+    z->n = (double)n;
+    z->s = s;
+    z->hIntegralX1 = ZipfHIntegral(z, 1.5) - 1.0;
+    z->hIntegralN = ZipfHIntegral(z, z->n + 0.5);
+    z->threshold = 2.0 - ZipfHIntegralInverse(z, ZipfHIntegral(z, 2.5) - ZipfH(z, 2.0));
+}
+
+static sqlite3_int64 ZipfSample(const ZipfSampler* z, unsigned long long* state) {
+    for (;;) {
+        double u = z->hIntegralN + RandomUnit(state) * (z->hIntegralX1 - z->hIntegralN);
+        double x = ZipfHIntegralInverse(z, u);
+        double k = floor(x + 0.5);
+
+        if (k < 1.0) {
+            k = 1.0;
+        } else if (k > z->n) {
+            k = z->n;
+        }
+        if (k - x <= z->threshold || u >= ZipfHIntegral(z, k + 0.5) - ZipfH(z, k)) {
+            return (sqlite3_int64)k;
+        }
+    }
+}
+
+// Civil date from days since 1970-01-01 (Howard Hinnant's algorithm), avoids gmtime and time_t limits
+static void FormatTimestamp(sqlite3_int64 unixTime, char* buffer) {
+    sqlite3_int64 days = unixTime / 86400;
+    int secs = (int)(unixTime % 86400);
+    sqlite3_int64 era, z;
+    unsigned doe, yoe, doy, mp, day, month;
+    sqlite3_int64 year;
+
+    if (secs < 0) {
+        secs += 86400;
+        days--;
+    }
+    z = days + 719468;
+    era = (z >= 0 ? z : z - 146096) / 146097;
+    doe = (unsigned)(z - era * 146097);
+    yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    year = (sqlite3_int64)yoe + era * 400;
+    doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    mp = (5 * doy + 2) / 153;
+    day = doy - (153 * mp + 2) / 5 + 1;
+    month = mp < 10 ? mp + 3 : mp - 9;
+    if (month <= 2) {
+        year++;
+    }
+    sprintf(buffer, "%04lld-%02u-%02u %02d:%02d:%02d", (long long)year, month, day,
+            secs / 3600, secs / 60 % 60, secs % 60);
+}
+
+// Brands and categories are skewed toward the front of their lists, like a real catalogue
+static int SkewedIndex(unsigned long long* state, int count) {
+    double u = RandomUnit(state);
+    return (int)(u * u * count);
+}
+
+// Name and price of product number index; unique because the model number is the index
+static sqlite3_int64 DescribeProduct(const WorkloadSpec* spec, sqlite3_int64 index, char* name, size_t nameSize) {
+    unsigned long long state = Mix64(spec->seed ^ Mix64((unsigned long long)index));
+    const char* brand = g_brands[SkewedIndex(&state, COUNT_OF(g_brands))];
+    const WorkloadCategory* category = &g_categories[SkewedIndex(&state, COUNT_OF(g_categories))];
+    const char* adjective = RandomUnit(&state) < 0.6 ? g_adjectives[NextRandom(&state) % COUNT_OF(g_adjectives)] : NULL;
+    char series = (char)('A' + NextRandom(&state) % 26);
+    // Log-normal spread around the category price, rounded to 50 ngwee
+    double normal = RandomUnit(&state) + RandomUnit(&state) + RandomUnit(&state) + RandomUnit(&state) - 2.0;
+    sqlite3_int64 price = (sqlite3_int64)(category->basePrice * exp(0.6 * normal) / 50.0 + 0.5) * 50;
+
+    snprintf(name, nameSize, "%s%s%s %s %c%lld", brand, adjective ? " " : "", adjective ? adjective : "",
+             category->name, series, (long long)index + 1);
+    return price < 100 ? 100 : price;
+}
+
+static int StepAndReset(sqlite3_stmt* stmt) {
+    int rc = sqlite3_step(stmt);
+    sqlite3_reset(stmt);
+    return rc == SQLITE_DONE ? SQLITE_OK : rc;
+}
+
+// Commits the open batch and starts the next one
+static int NextBatch(sqlite3* conn) {
+    int rc = sqlite3_exec(conn, "COMMIT", NULL, NULL, NULL);
+    return rc == SQLITE_OK ? sqlite3_exec(conn, "BEGIN", NULL, NULL, NULL) : rc;
+}
+
+void Workload_Init(WorkloadSpec* spec, int scale, unsigned long long seed) {
+    memset(spec, 0, sizeof(*spec));
+    spec->products = (sqlite3_int64)scale * WORKLOAD_PRODUCTS_PER_SCALE;
+    spec->sales = (sqlite3_int64)scale * WORKLOAD_SALES_PER_SCALE;
+    spec->seed = seed;
+    spec->zipfExponent = 1.0;
+    spec->days = WORKLOAD_DEFAULT_DAYS;
+    spec->endTime = WORKLOAD_DEFAULT_END_TIME;
+    spec->batchRows = WORKLOAD_DEFAULT_BATCH;
+}
+
+int Workload_Generate(sqlite3* conn, const WorkloadSpec* spec, WorkloadProgress progress, void* context) {
+    const char* productSql = "INSERT INTO products (id, name, quantity, price, price_cents, created_at) "
+                             "VALUES (?1, ?2, ?3, ?4 / 100.0, ?4, ?5)";
+    const char* saleSql = "INSERT INTO sales (product_id, product_name, quantity_sold, total_amount, total_cents, sale_date) "
+                          "VALUES (?1, ?2, ?3, ?4 / 100.0, ?4, ?5)";
+    sqlite3_stmt* productStmt = NULL;
+    sqlite3_stmt* saleStmt = NULL;
+    sqlite3_stmt* stmt;
+    sqlite3_int64* prices = NULL;
+    sqlite3_int64 firstId = 1;
+    sqlite3_int64 total = spec->products + spec->sales;
+    sqlite3_int64 window = (sqlite3_int64)spec->days * 86400;
+    sqlite3_int64 startTime = spec->endTime - window;
+    sqlite3_int64 stride = 0;
+    sqlite3_int64 i;
+    unsigned long long state = spec->seed;
+    ZipfSampler zipf;
+    char name[128];
+    char stamp[32];
+    int batch = spec->batchRows > 0 ? spec->batchRows : WORKLOAD_DEFAULT_BATCH;
+    int rc;
+
+    if (spec->products <= 0 || spec->sales < 0 || spec->days <= 0) {
+        return SQLITE_MISUSE;
+    }
+
+    // Generated ids follow whatever is already in the table
+    rc = sqlite3_prepare_v2(conn, "SELECT COALESCE(MAX(id), 0) + 1 FROM products", -1, &stmt, NULL);
+    if (rc != SQLITE_OK) {
+        return rc;
+    }
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        firstId = sqlite3_column_int64(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+
+    prices = (sqlite3_int64*)malloc((size_t)spec->products * sizeof(sqlite3_int64));
+    if (!prices) {
+        return SQLITE_NOMEM;
+    }
+
+    rc = sqlite3_prepare_v2(conn, productSql, -1, &productStmt, NULL);
+    if (rc == SQLITE_OK) {
+        rc = sqlite3_prepare_v2(conn, saleSql, -1, &saleStmt, NULL);
+    }
+    if (rc == SQLITE_OK) {
+        rc = sqlite3_exec(conn, "BEGIN", NULL, NULL, NULL);
+    }
+
+    // Products were listed during the month before the sales window
+    for (i = 0; rc == SQLITE_OK && i < spec->products; i++) {
+        unsigned long long extra = Mix64(spec->seed + 0x5bd1e995ULL * (unsigned long long)i);
+        double u = (extra >> 11) * (1.0 / 9007199254740992.0);
+
+        prices[i] = DescribeProduct(spec, i, name, sizeof(name));
+        FormatTimestamp(startTime - 30 * 86400 + (sqlite3_int64)(extra % (30 * 86400)), stamp);
+
+        sqlite3_bind_int64(productStmt, 1, firstId + i);
+        sqlite3_bind_text(productStmt, 2, name, -1, SQLITE_STATIC);
+        sqlite3_bind_int(productStmt, 3, (int)(u * u * u * 500));  // most shelves hold a few units
+        sqlite3_bind_int64(productStmt, 4, prices[i]);
+        sqlite3_bind_text(productStmt, 5, stamp, -1, SQLITE_STATIC);
+        rc = StepAndReset(productStmt);
+
+        if (rc == SQLITE_OK && (i + 1) % batch == 0) {
+            rc = NextBatch(conn);
+            if (progress) {
+                progress(context, i + 1, total);
+            }
+        }
+    }
+
+    // Popularity rank r maps to product (r * stride) mod n, so best sellers are scattered over the id range
+    for (stride = (sqlite3_int64)(spec->products * 0.6180339887) | 1; stride > 1; stride += 2) {
+        sqlite3_int64 a = spec->products, b = stride;
+        while (b) {
+            sqlite3_int64 t = a % b;
+            a = b;
+            b = t;
+        }
+        if (a == 1) {
+            break;
+        }
+    }
+    ZipfInit(&zipf, spec->products, spec->zipfExponent);
+
+    // Sales are spaced evenly with jitter, so ids and timestamps increase together
+    for (i = 0; rc == SQLITE_OK && i < spec->sales; i++) {
+        sqlite3_int64 rank = ZipfSample(&zipf, &state) - 1;
+        sqlite3_int64 index = (rank * stride) % spec->products;
+        sqlite3_int64 slot = startTime + i * window / spec->sales;
+        sqlite3_int64 width = window / spec->sales;
+        unsigned long long r = NextRandom(&state);
+        int quantity = (r & 0xff) < 200 ? 1 : (int)((r >> 8) % 5) + 2;
+
+        DescribeProduct(spec, index, name, sizeof(name));
+        FormatTimestamp(slot + (width > 0 ? (sqlite3_int64)((r >> 16) % (unsigned long long)width) : 0), stamp);
+
+        sqlite3_bind_int64(saleStmt, 1, firstId + index);
+        sqlite3_bind_text(saleStmt, 2, name, -1, SQLITE_STATIC);
+        sqlite3_bind_int(saleStmt, 3, quantity);
+        sqlite3_bind_int64(saleStmt, 4, prices[index] * quantity);
+        sqlite3_bind_text(saleStmt, 5, stamp, -1, SQLITE_STATIC);
+        rc = StepAndReset(saleStmt);
+
+        if (rc == SQLITE_OK && (i + 1) % batch == 0) {
+            rc = NextBatch(conn);
+            if (progress) {
+                progress(context, spec->products + i + 1, total);
+            }
+        }
+    }
+
+    if (rc == SQLITE_OK) {
+        rc = sqlite3_exec(conn, "COMMIT", NULL, NULL, NULL);
+        if (progress) {
+            progress(context, total, total);
+        }
+    }
+    if (rc != SQLITE_OK && !sqlite3_get_autocommit(conn)) {
+        sqlite3_exec(conn, "ROLLBACK", NULL, NULL, NULL);
+    }
+
+    sqlite3_finalize(productStmt);
+    sqlite3_finalize(saleStmt);
+    free(prices);
+    return rc;
+}
@@ -0,0 +1,43 @@
+/*
+ * Synthetic inventory workload
+ * Deterministic products and Zipf-distributed sales for reproducing production-scale databases
+ */
+
+#ifndef WORKLOAD_H
+#define WORKLOAD_H
+
+#include <sqlite3.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Scale factor 1 is 10,000 products and 1,000,000 sales; 100 gives 1M products and 100M sales
+#define WORKLOAD_PRODUCTS_PER_SCALE 10000
+#define WORKLOAD_SALES_PER_SCALE 1000000
+
+typedef struct {
+    sqlite3_int64 products;
+    sqlite3_int64 sales;
+    unsigned long long seed;
+    double zipfExponent;        // skew of product popularity, 1.0 is classic Zipf
+    int days;                   // sales are spread evenly over this many days
+    sqlite3_int64 endTime;      // Unix time of the newest sale; fixed so runs are reproducible
+    int batchRows;              // rows per transaction
+} WorkloadSpec;
+
+// done counts products then sales, total is products + sales
+typedef void (*WorkloadProgress)(void* context, sqlite3_int64 done, sqlite3_int64 total);
+
+void Workload_Init(WorkloadSpec* spec, int scale, unsigned long long seed);
+
+// Appends spec->products products and spec->sales sales to the products and sales tables.
+// The caller picks the pragmas; a bulk load is several times faster with synchronous=OFF.
+// Returns SQLITE_OK, or the first error; rows from already committed batches remain.
+int Workload_Generate(sqlite3* conn, const WorkloadSpec* spec, WorkloadProgress progress, void* context);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif